@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglarcs.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+static const char *vertexShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec4 arc;\n"
+    "in float along;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform float radius;\n"
+    "void main() {\n"
+    "   float angle = mix(arc.z, arc.w, along);\n"
+    "   vec2 point = arc.xy + radius * vec2(cos(angle), sin(angle));\n"
+    "   gl_Position = projMatrix * mvMatrix * vec4(point, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "uniform vec4 colourVector;\n"
+    "out highp vec4 fragColor;\n"
+    "void main() {\n"
+    "   fragColor = colourVector;\n"
+    "}\n";
+
+static const char *vertexShaderSource = // auto-format hack
+    "attribute vec4 arc;\n"
+    "attribute float along;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform float radius;\n"
+    "void main() {\n"
+    "   float angle = mix(arc.z, arc.w, along);\n"
+    "   vec2 point = arc.xy + radius * vec2(cos(angle), sin(angle));\n"
+    "   gl_Position = projMatrix * mvMatrix * vec4(point, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSource = // auto-format hack
+    "uniform highp vec4 colourVector;\n"
+    "void main() {\n"
+    "   gl_FragColor = colourVector;\n"
+    "}\n";
+
+static const GLuint ARC_LOCATION = 0;
+static const GLuint ALONG_LOCATION = 1;
+
+bool AGLArcs::instancingSupport() {
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    const QSurfaceFormat &format = context->format();
+    if (context->isOpenGLES())
+        return format.majorVersion() >= 3;
+    return format.version() >= qMakePair(3, 3);
+}
+
+AGLArcs::AGLArcs() : m_program(0) {}
+
+void AGLArcs::init(size_t arcCount) {
+    m_built = false;
+    m_arcs.clear();
+    m_arcs.reserve(static_cast<qsizetype>(arcCount));
+}
+
+void AGLArcs::addArc(const Point2f &centre, float fromAngle, float toAngle) {
+    m_arcs.append(QVector4D(localX(centre.x), localY(centre.y), fromAngle, toAngle));
+}
+
+void AGLArcs::setColour(const QColor &colour) {
+    m_colour = QVector4D(static_cast<float>(colour.redF()), static_cast<float>(colour.greenF()),
+                         static_cast<float>(colour.blueF()), static_cast<float>(colour.alphaF()));
+}
+
+void AGLArcs::uploadArcs() {
+    m_arcVbo.bind();
+    if (m_instanced) {
+        m_arcVbo.allocate(m_arcs.constData(), static_cast<int>(m_arcs.size()) *
+                                                  static_cast<int>(sizeof(QVector4D)));
+    } else {
+        // (arc, along) for both ends of each segment of each arc
+        QVector<GLfloat> vertices;
+        vertices.reserve(m_arcs.size() * ARC_SEGMENTS * 2 * 5);
+        for (const QVector4D &arc : m_arcs) {
+            for (int segment = 0; segment < ARC_SEGMENTS; ++segment) {
+                for (int end = 0; end < 2; ++end) {
+                    vertices << arc.x() << arc.y() << arc.z() << arc.w()
+                             << static_cast<GLfloat>(segment + end) / ARC_SEGMENTS;
+                }
+            }
+        }
+        m_arcVbo.allocate(vertices.constData(), static_cast<int>(vertices.size()) *
+                                                    static_cast<int>(sizeof(GLfloat)));
+    }
+    m_arcVbo.release();
+}
+
+void AGLArcs::setupVertexAttribs() {
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glEnableVertexAttribArray(ARC_LOCATION);
+    f->glEnableVertexAttribArray(ALONG_LOCATION);
+    if (m_instanced) {
+        QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
+        m_arcVbo.bind();
+        f->glVertexAttribPointer(ARC_LOCATION, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        ef->glVertexAttribDivisor(ARC_LOCATION, 1);
+        m_arcVbo.release();
+        m_stripVbo.bind();
+        f->glVertexAttribPointer(ALONG_LOCATION, 1, GL_FLOAT, GL_FALSE, 0, 0);
+        m_stripVbo.release();
+    } else {
+        GLsizei stride = 5 * static_cast<GLsizei>(sizeof(GLfloat));
+        m_arcVbo.bind();
+        f->glVertexAttribPointer(ARC_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, 0);
+        f->glVertexAttribPointer(ALONG_LOCATION, 1, GL_FLOAT, GL_FALSE, stride,
+                                 reinterpret_cast<void *>(4 * sizeof(GLfloat)));
+        m_arcVbo.release();
+    }
+}
+
+void AGLArcs::initializeGL(bool core) {
+    if (m_arcs.size() == 0)
+        return;
+    m_instanced = instancingSupport();
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex,
+                                       core ? vertexShaderSourceCore : vertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                       core ? fragmentShaderSourceCore : fragmentShaderSource);
+    m_program->bindAttributeLocation("arc", ARC_LOCATION);
+    m_program->bindAttributeLocation("along", ALONG_LOCATION);
+    m_program->link();
+
+    m_program->bind();
+    m_projMatrixLoc = m_program->uniformLocation("projMatrix");
+    m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+    m_radiusLoc = m_program->uniformLocation("radius");
+    m_colourVectorLoc = m_program->uniformLocation("colourVector");
+
+    m_vao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    if (m_instanced) {
+        GLfloat along[ARC_SEGMENTS + 1];
+        for (int i = 0; i <= ARC_SEGMENTS; ++i) {
+            along[i] = static_cast<GLfloat>(i) / ARC_SEGMENTS;
+        }
+        m_stripVbo.create();
+        m_stripVbo.bind();
+        m_stripVbo.allocate(along, static_cast<int>(sizeof(along)));
+        m_stripVbo.release();
+    }
+    m_arcVbo.create();
+    uploadArcs();
+    setupVertexAttribs();
+
+    m_program->release();
+    m_built = true;
+}
+
+void AGLArcs::updateGL(bool core) {
+    if (m_program == 0) {
+        // has not been initialised yet, do that instead
+        initializeGL(core);
+    } else {
+        QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+        uploadArcs();
+        m_built = true;
+    }
+}
+
+void AGLArcs::cleanup() {
+    if (!m_built)
+        return;
+    m_arcVbo.destroy();
+    m_stripVbo.destroy();
+    delete m_program;
+    m_program = 0;
+}
+
+void AGLArcs::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView, const QMatrix4x4 &mModel) {
+    if (!m_built || m_arcs.isEmpty())
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_projMatrixLoc, mProj);
+    m_program->setUniformValue(m_mvMatrixLoc, mView * mModel);
+    m_program->setUniformValue(m_radiusLoc, m_radius);
+    m_program->setUniformValue(
+        m_colourVectorLoc, QVector4D(m_colour.toVector3D(), m_colour.w() * m_opacity));
+
+    if (m_instanced) {
+        QOpenGLContext::currentContext()->extraFunctions()->glDrawArraysInstanced(
+            GL_LINE_STRIP, 0, ARC_SEGMENTS + 1, static_cast<GLsizei>(m_arcs.size()));
+    } else {
+        QOpenGLContext::currentContext()->functions()->glDrawArrays(
+            GL_LINES, 0, static_cast<GLsizei>(m_arcs.size()) * ARC_SEGMENTS * 2);
+    }
+
+    m_program->release();
+}
+
+bool AGLArcs::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    if (!cache.read(key, m_arcs))
+        return false;
+    m_built = false;
+    return true;
+}
+
+void AGLArcs::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    cache.write(key, m_arcs.constData(), m_arcs.size());
+}
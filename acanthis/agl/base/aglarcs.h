@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "aglobject.h"
+
+#include "../func/aglvertexbuffercache.h"
+
+#include "genlib/p2dpoly.h"
+
+#include <QColor>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QVector4D>
+#include <QVector>
+
+/**
+ * @brief Circular arcs of a common radius and colour, generated in the vertex shader from
+ * one (centre x, centre y, from angle, to angle) per arc. Where instancing is available each
+ * arc is an instance of a line strip of ARC_SEGMENTS segments, otherwise the parameters are
+ * repeated for each vertex on upload and the arcs are drawn as line pairs.
+ */
+class AGLArcs : public AGLObject {
+  public:
+    static const int ARC_SEGMENTS = 16;
+
+    /** @brief Whether the current context can draw instanced arrays */
+    static bool instancingSupport();
+
+    AGLArcs();
+    void init(size_t arcCount);
+    /** @brief Angles in radians, the arc goes from fromAngle to toAngle */
+    void addArc(const Point2f &centre, float fromAngle, float toAngle);
+    void setRadius(float radius) { m_radius = radius; }
+    void setColour(const QColor &colour);
+    /** @brief Scales the alpha of the colour when drawing, to fade the arcs in and out */
+    void setOpacity(float opacity) { m_opacity = opacity; }
+    void paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                 const QMatrix4x4 &mModel) override;
+    void initializeGL(bool core) override;
+    void updateGL(bool core) override;
+    void cleanup() override;
+    size_t arcCount() const { return static_cast<size_t>(m_arcs.size()); }
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
+    AGLArcs(const AGLArcs &) = delete;
+    AGLArcs &operator=(const AGLArcs &) = delete;
+
+  private:
+    void uploadArcs();
+    void setupVertexAttribs();
+
+    QVector<QVector4D> m_arcs;
+    float m_radius = 1.0f;
+    QVector4D m_colour = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+    float m_opacity = 1.0f;
+    bool m_instanced = false;
+    bool m_built = false;
+
+    QOpenGLVertexArrayObject m_vao;
+    // the arc parameters, per instance or per vertex
+    QOpenGLBuffer m_arcVbo;
+    // the position along the arc of each vertex of the strip, only used when instanced
+    QOpenGLBuffer m_stripVbo;
+    QOpenGLShaderProgram *m_program;
+    int m_projMatrixLoc;
+    int m_mvMatrixLoc;
+    int m_radiusLoc;
+    int m_colourVectorLoc;
+};
@@ -0,0 +1,360 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglbasemap.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QSqlDatabase>
+#include <QThread>
+#include <QVariant>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+static const char *vertexShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec4 vertex;\n"
+    "out vec2 texc;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "void main() {\n"
+    "   gl_Position = projMatrix * mvMatrix * vec4(vertex.xy, 0.0, 1.0);\n"
+    "   texc = vertex.zw;\n"
+    "}\n";
+
+static const char *fragmentShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "uniform sampler2D atlas;\n"
+    "in vec2 texc;\n"
+    "out highp vec4 fragColor;\n"
+    "void main() {\n"
+    "   fragColor = texture(atlas, texc);\n"
+    "}\n";
+
+static const char *vertexShaderSource = // auto-format hack
+    "attribute highp vec4 vertex;\n"
+    "varying mediump vec2 texc;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "void main() {\n"
+    "   gl_Position = projMatrix * mvMatrix * vec4(vertex.xy, 0.0, 1.0);\n"
+    "   texc = vertex.zw;\n"
+    "}\n";
+
+static const char *fragmentShaderSource = // auto-format hack
+    "uniform sampler2D atlas;\n"
+    "varying mediump vec2 texc;\n"
+    "void main() {\n"
+    "   gl_FragColor = texture2D(atlas, texc);\n"
+    "}\n";
+
+AGLBasemap::AGLBasemap() : m_atlas(QOpenGLTexture::Target2D) {
+    m_readPool.setMaxThreadCount(1);
+    m_readPool.setExpiryTimeout(-1);
+    m_decodePool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+}
+
+AGLBasemap::~AGLBasemap() { close(); }
+
+bool AGLBasemap::open(const QString &filename) {
+    close();
+    m_connectionName = QString("acanthis-basemap-%1").arg(reinterpret_cast<quintptr>(this));
+    bool opened = false;
+    // the connection may only be used by the thread that made it
+    m_readPool.start([this, &filename, &opened]() {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+        database.setDatabaseName(filename);
+        database.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (!database.open())
+            return;
+        // the zoom levels in the metadata are optional, take them from the tiles instead
+        QSqlQuery zoomQuery("SELECT MIN(zoom_level), MAX(zoom_level) FROM tiles", database);
+        if (!zoomQuery.next() || zoomQuery.value(0).isNull())
+            return;
+        m_minZoom = zoomQuery.value(0).toInt();
+        m_maxZoom = zoomQuery.value(1).toInt();
+        m_tileQuery = std::make_unique<QSqlQuery>(database);
+        opened = m_tileQuery->prepare("SELECT tile_data FROM tiles WHERE zoom_level = ? AND "
+                                      "tile_column = ? AND tile_row = ?");
+    });
+    m_readPool.waitForDone();
+    m_open = opened && m_minZoom >= 0 && m_maxZoom < 24;
+    if (!m_open)
+        close();
+    return m_open;
+}
+
+void AGLBasemap::close() {
+    m_open = false;
+    m_readPool.clear();
+    m_readPool.waitForDone();
+    m_decodePool.clear();
+    m_decodePool.waitForDone();
+    if (!m_connectionName.isEmpty()) {
+        m_readPool.start([this]() {
+            m_tileQuery.reset();
+            QSqlDatabase::database(m_connectionName, false).close();
+            QSqlDatabase::removeDatabase(m_connectionName);
+        });
+        m_readPool.waitForDone();
+        m_connectionName.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_decodedMutex);
+        m_decoded.clear();
+    }
+    m_requested.clear();
+    m_missing.clear();
+    m_resident.clear();
+    m_lru.clear();
+    m_freeSlots.clear();
+    for (int slot = ATLAS_SLOTS - 1; slot >= 0; --slot) {
+        m_freeSlots.push_back(slot);
+    }
+}
+
+QByteArray AGLBasemap::readTile(int zoom, int column, int row) {
+    if (!m_tileQuery)
+        return QByteArray();
+    m_tileQuery->bindValue(0, zoom);
+    m_tileQuery->bindValue(1, column);
+    m_tileQuery->bindValue(2, row);
+    QByteArray data;
+    if (m_tileQuery->exec() && m_tileQuery->next())
+        data = m_tileQuery->value(0).toByteArray();
+    m_tileQuery->finish();
+    return data;
+}
+
+void AGLBasemap::pushDecoded(uint64_t key, QImage image) {
+    std::lock_guard<std::mutex> lock(m_decodedMutex);
+    m_decoded.push_back(DecodedTile{key, std::move(image)});
+}
+
+void AGLBasemap::requestTile(int zoom, int column, int row) {
+    uint64_t key = tileKey(zoom, column, row);
+    if (m_requested.size() >= MAX_PENDING_TILES || m_missing.count(key) != 0 ||
+        !m_requested.insert(key).second)
+        return;
+    m_readPool.start([this, key, zoom, column, row]() {
+        QByteArray data = readTile(zoom, column, row);
+        if (data.isEmpty()) {
+            pushDecoded(key, QImage());
+            return;
+        }
+        // keep the single read thread free for the next tile
+        m_decodePool.start([this, key, data]() {
+            QImage image = QImage::fromData(data);
+            if (!image.isNull()) {
+                if (image.width() != TILE_SIZE || image.height() != TILE_SIZE)
+                    image = image.scaled(TILE_SIZE, TILE_SIZE, Qt::IgnoreAspectRatio,
+                                         Qt::SmoothTransformation);
+                image = image.convertToFormat(QImage::Format_RGBA8888);
+            }
+            pushDecoded(key, std::move(image));
+        });
+    });
+}
+
+void AGLBasemap::initializeGL(bool core) {
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex,
+                                       core ? vertexShaderSourceCore : vertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                       core ? fragmentShaderSourceCore : fragmentShaderSource);
+    m_program->bindAttributeLocation("vertex", 0);
+    m_program->link();
+
+    m_program->bind();
+    m_projMatrixLoc = m_program->uniformLocation("projMatrix");
+    m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+    m_textureSamplerLoc = m_program->uniformLocation("atlas");
+    m_program->setUniformValue(m_textureSamplerLoc, 0);
+
+    // no mipmaps, they would bleed the slots into each other
+    m_atlas.setSize(ATLAS_SIZE, ATLAS_SIZE);
+    m_atlas.setFormat(QOpenGLTexture::RGBA8_UNorm);
+    m_atlas.setMinificationFilter(QOpenGLTexture::Linear);
+    m_atlas.setMagnificationFilter(QOpenGLTexture::Linear);
+    m_atlas.setWrapMode(QOpenGLTexture::ClampToEdge);
+    m_atlas.allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+
+    m_vao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_vbo.create();
+    m_vbo.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    m_vbo.bind();
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glEnableVertexAttribArray(0);
+    f->glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(4 * sizeof(GLfloat)),
+                             0);
+    m_vbo.release();
+
+    m_program->release();
+
+    // the atlas starts empty
+    m_resident.clear();
+    m_lru.clear();
+    m_freeSlots.clear();
+    for (int slot = ATLAS_SLOTS - 1; slot >= 0; --slot) {
+        m_freeSlots.push_back(slot);
+    }
+}
+
+void AGLBasemap::updateGL() {
+    std::vector<DecodedTile> decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_decodedMutex);
+        decoded.swap(m_decoded);
+    }
+    const int slotsPerRow = ATLAS_SIZE / TILE_SIZE;
+    for (DecodedTile &tile : decoded) {
+        m_requested.erase(tile.key);
+        if (tile.image.isNull()) {
+            m_missing.insert(tile.key);
+            continue;
+        }
+        if (!m_atlas.isStorageAllocated() || m_resident.count(tile.key) != 0)
+            continue;
+        int slot;
+        if (!m_freeSlots.empty()) {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        } else {
+            auto evicted = m_resident.find(m_lru.back());
+            slot = evicted->second.slot;
+            m_resident.erase(evicted);
+            m_lru.pop_back();
+        }
+        m_atlas.setData((slot % slotsPerRow) * TILE_SIZE, (slot / slotsPerRow) * TILE_SIZE, 0,
+                        TILE_SIZE, TILE_SIZE, 1, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8,
+                        tile.image.constBits());
+        m_lru.push_front(tile.key);
+        m_resident[tile.key] = ResidentTile{slot, m_lru.begin()};
+    }
+}
+
+void AGLBasemap::cleanup() {
+    m_resident.clear();
+    m_lru.clear();
+    m_freeSlots.clear();
+    m_requested.clear();
+    if (m_program == nullptr)
+        return;
+    m_atlas.destroy();
+    m_vbo.destroy();
+    m_vao.destroy();
+    delete m_program;
+    m_program = nullptr;
+}
+
+void AGLBasemap::addQuad(std::vector<GLfloat> &vertices, int zoom, int column, int row,
+                         const ResidentTile &tile) const {
+    double tileSize = 2.0 * MERCATOR_EXTENT / static_cast<double>(1 << zoom);
+    double left = -MERCATOR_EXTENT - m_viewCentre.x;
+    double bottom = -MERCATOR_EXTENT - m_viewCentre.y;
+    float x0 = static_cast<float>(left + column * tileSize);
+    float y0 = static_cast<float>(bottom + row * tileSize);
+    float x1 = static_cast<float>(left + (column + 1) * tileSize);
+    float y1 = static_cast<float>(bottom + (row + 1) * tileSize);
+
+    // the first image row (north) is at the top of the slot, the coordinates are kept half a
+    // texel in so that the neighbouring slots do not bleed in
+    const int slotsPerRow = ATLAS_SIZE / TILE_SIZE;
+    double slotLeft = (tile.slot % slotsPerRow) * TILE_SIZE;
+    double top = (tile.slot / slotsPerRow) * TILE_SIZE;
+    float u0 = static_cast<float>((slotLeft + 0.5) / ATLAS_SIZE);
+    float u1 = static_cast<float>((slotLeft + TILE_SIZE - 0.5) / ATLAS_SIZE);
+    float vNorth = static_cast<float>((top + 0.5) / ATLAS_SIZE);
+    float vSouth = static_cast<float>((top + TILE_SIZE - 0.5) / ATLAS_SIZE);
+
+    const GLfloat quad[] = {x0, y0, u0, vSouth, x1, y0, u1, vSouth, x1, y1, u1, vNorth,
+                            x0, y0, u0, vSouth, x1, y1, u1, vNorth, x0, y1, u0, vNorth};
+    vertices.insert(vertices.end(), std::begin(quad), std::end(quad));
+}
+
+void AGLBasemap::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                         const QMatrix4x4 &mModel, double eyePosX, double eyePosY) {
+    if (!m_open || m_program == nullptr)
+        return;
+    m_viewCentre = Point2f(-eyePosX, -eyePosY);
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    QMatrix4x4 mvp = mProj * mView * mModel;
+    GLint viewport[4];
+    f->glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // the zoom at which a tile pixel is closest to a framebuffer pixel
+    double pixelsPerUnit = std::abs(mvp(1, 1)) * viewport[3] * 0.5;
+    int zoom = static_cast<int>(
+        std::lround(std::log2(2.0 * MERCATOR_EXTENT * pixelsPerUnit / TILE_SIZE)));
+    zoom = std::clamp(zoom, m_minZoom, m_maxZoom);
+
+    QMatrix4x4 inverse = mvp.inverted();
+    QVector3D corner0 = inverse.map(QVector3D(-1.0f, -1.0f, 0.0f));
+    QVector3D corner1 = inverse.map(QVector3D(1.0f, 1.0f, 0.0f));
+    int tileCount = 1 << zoom;
+    double tileSize = 2.0 * MERCATOR_EXTENT / tileCount;
+    // TMS rows count from the south like the world y does
+    auto tileIndex = [&](double world) {
+        return std::clamp(static_cast<int>(std::floor((world + MERCATOR_EXTENT) / tileSize)), 0,
+                          tileCount - 1);
+    };
+    double minWorldX = m_viewCentre.x + std::min(corner0.x(), corner1.x());
+    double maxWorldX = m_viewCentre.x + std::max(corner0.x(), corner1.x());
+    double minWorldY = m_viewCentre.y + std::min(corner0.y(), corner1.y());
+    double maxWorldY = m_viewCentre.y + std::max(corner0.y(), corner1.y());
+    if (maxWorldX < -MERCATOR_EXTENT || minWorldX > MERCATOR_EXTENT ||
+        maxWorldY < -MERCATOR_EXTENT || minWorldY > MERCATOR_EXTENT)
+        return;
+    int minColumn = tileIndex(minWorldX);
+    int maxColumn = tileIndex(maxWorldX);
+    int minRow = tileIndex(minWorldY);
+    int maxRow = tileIndex(maxWorldY);
+    if ((maxColumn - minColumn + 1) * (maxRow - minRow + 1) > MAX_VISIBLE_TILES)
+        return;
+
+    // stand-ins go first so that the tiles at the right zoom are drawn over them
+    std::vector<GLfloat> standInVertices;
+    std::vector<GLfloat> tileVertices;
+    std::set<uint64_t> standInsUsed;
+    for (int column = minColumn; column <= maxColumn; ++column) {
+        for (int row = minRow; row <= maxRow; ++row) {
+            auto resident = m_resident.find(tileKey(zoom, column, row));
+            if (resident != m_resident.end()) {
+                m_lru.splice(m_lru.begin(), m_lru, resident->second.lruPosition);
+                addQuad(tileVertices, zoom, column, row, resident->second);
+                continue;
+            }
+            requestTile(zoom, column, row);
+            for (int up = 1; up <= MAX_ANCESTOR_LEVELS && zoom - up >= m_minZoom; ++up) {
+                auto ancestor = m_resident.find(tileKey(zoom - up, column >> up, row >> up));
+                if (ancestor == m_resident.end())
+                    continue;
+                m_lru.splice(m_lru.begin(), m_lru, ancestor->second.lruPosition);
+                // the whole ancestor once, rather than its part under each missing tile
+                if (standInsUsed.insert(ancestor->first).second)
+                    addQuad(standInVertices, zoom - up, column >> up, row >> up, ancestor->second);
+                break;
+            }
+        }
+    }
+    standInVertices.insert(standInVertices.end(), tileVertices.begin(), tileVertices.end());
+    if (standInVertices.empty())
+        return;
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_projMatrixLoc, mProj);
+    m_program->setUniformValue(m_mvMatrixLoc, mView * mModel);
+    m_vbo.bind();
+    m_vbo.allocate(standInVertices.data(),
+                   static_cast<int>(standInVertices.size() * sizeof(GLfloat)));
+    m_vbo.release();
+    m_atlas.bind(0);
+    f->glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(standInVertices.size() / 4));
+    m_atlas.release(0);
+    m_program->release();
+}
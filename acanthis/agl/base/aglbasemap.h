@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "genlib/p2dpoly.h"
+
+#include <QByteArray>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+#include <QSqlQuery>
+#include <QThreadPool>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief An underlay read from a local MBTiles file (an SQLite database of Web Mercator
+ * tiles in TMS order), drawn with the world coordinates taken as Web Mercator metres.
+ *
+ * Tiles are read by one thread that owns the database connection and decoded on a pool,
+ * then copied into slots of one fixed-size atlas texture, the least recently drawn giving
+ * up its slot first. Tiles not in the atlas yet are covered by the closest ancestor that is.
+ */
+class AGLBasemap {
+  public:
+    static const int TILE_SIZE = 256;
+    static const int ATLAS_SIZE = 4096;
+    static const int ATLAS_SLOTS = (ATLAS_SIZE / TILE_SIZE) * (ATLAS_SIZE / TILE_SIZE);
+    static const size_t MAX_PENDING_TILES = 64;
+    static const int MAX_VISIBLE_TILES = 512;
+    // how far up to look for a tile to stand in for one not loaded yet
+    static const int MAX_ANCESTOR_LEVELS = 4;
+    static constexpr double MERCATOR_EXTENT = 20037508.342789244;
+
+    AGLBasemap();
+    ~AGLBasemap();
+
+    /** @brief Opens the file, returns false if it can not be read as MBTiles */
+    bool open(const QString &filename);
+    void close();
+    bool isOpen() const { return m_open; }
+
+    void initializeGL(bool core);
+    /** @brief Copies the tiles decoded since the last call into the atlas */
+    void updateGL();
+    void cleanup();
+    /**
+     * @brief Draws the tiles in view. The matrices leave out the camera position, the tiles
+     * are placed relative to it in double precision as they are far from (0, 0)
+     */
+    void paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView, const QMatrix4x4 &mModel,
+                 double eyePosX, double eyePosY);
+    /** @brief Whether tiles are being read, to keep drawing until they are in */
+    bool hasPendingTiles() const { return !m_requested.empty(); }
+
+    AGLBasemap(const AGLBasemap &) = delete;
+    AGLBasemap &operator=(const AGLBasemap &) = delete;
+
+  private:
+    struct DecodedTile {
+        uint64_t key;
+        // null for tiles not in the file
+        QImage image;
+    };
+    struct ResidentTile {
+        int slot;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    static uint64_t tileKey(int zoom, int column, int row) {
+        return (static_cast<uint64_t>(zoom) << 48) | (static_cast<uint64_t>(column) << 24) |
+               static_cast<uint64_t>(row);
+    }
+    void requestTile(int zoom, int column, int row);
+    /** @brief Reads the encoded tile, only on the read thread */
+    QByteArray readTile(int zoom, int column, int row);
+    void pushDecoded(uint64_t key, QImage image);
+    /** @brief Adds the two triangles of the tile, relative to the view centre, to the atlas */
+    void addQuad(std::vector<GLfloat> &vertices, int zoom, int column, int row,
+                 const ResidentTile &tile) const;
+
+    QString m_connectionName;
+    bool m_open = false;
+    int m_minZoom = 0;
+    int m_maxZoom = 0;
+    // the world point at the centre of the view being drawn
+    Point2f m_viewCentre;
+
+    // one thread that never expires, as the database connection belongs to it
+    QThreadPool m_readPool;
+    QThreadPool m_decodePool;
+    // used on the read thread only
+    std::unique_ptr<QSqlQuery> m_tileQuery;
+
+    std::mutex m_decodedMutex;
+    std::vector<DecodedTile> m_decoded;
+
+    // render thread only
+    std::set<uint64_t> m_requested;
+    std::set<uint64_t> m_missing;
+    std::unordered_map<uint64_t, ResidentTile> m_resident;
+    std::list<uint64_t> m_lru;
+    std::vector<int> m_freeSlots;
+
+    QOpenGLTexture m_atlas;
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vbo;
+    QOpenGLShaderProgram *m_program = nullptr;
+    int m_projMatrixLoc;
+    int m_mvMatrixLoc;
+    int m_textureSamplerLoc;
+};
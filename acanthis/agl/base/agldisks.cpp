@@ -0,0 +1,245 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "agldisks.h"
+
+#include "aglarcs.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+#include <cmath>
+
+static const char *vertexShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec2 centre;\n"
+    "in vec2 corner;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform float radius;\n"
+    "void main() {\n"
+    "   gl_Position = projMatrix * mvMatrix * vec4(centre + radius * corner, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "uniform vec4 colourVector;\n"
+    "out highp vec4 fragColor;\n"
+    "void main() {\n"
+    "   fragColor = colourVector;\n"
+    "}\n";
+
+static const char *vertexShaderSource = // auto-format hack
+    "attribute vec2 centre;\n"
+    "attribute vec2 corner;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform float radius;\n"
+    "void main() {\n"
+    "   gl_Position = projMatrix * mvMatrix * vec4(centre + radius * corner, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSource = // auto-format hack
+    "uniform highp vec4 colourVector;\n"
+    "void main() {\n"
+    "   gl_FragColor = colourVector;\n"
+    "}\n";
+
+static const GLuint CENTRE_LOCATION = 0;
+static const GLuint CORNER_LOCATION = 1;
+
+// the centre of the unit circle followed by the points around it, the last repeating the
+// first to close the fan
+static QVector<QVector2D> unitCircle() {
+    QVector<QVector2D> circle;
+    circle.reserve(AGLDisks::DISK_SEGMENTS + 2);
+    circle.append(QVector2D(0.0f, 0.0f));
+    for (int i = 0; i <= AGLDisks::DISK_SEGMENTS; ++i) {
+        double angle = 2.0 * M_PI * (i % AGLDisks::DISK_SEGMENTS) / AGLDisks::DISK_SEGMENTS;
+        circle.append(QVector2D(static_cast<float>(std::cos(angle)),
+                                static_cast<float>(std::sin(angle))));
+    }
+    return circle;
+}
+
+AGLDisks::AGLDisks() : m_program(0) {}
+
+void AGLDisks::init(size_t diskCount) {
+    m_built = false;
+    m_centres.clear();
+    m_centres.reserve(static_cast<qsizetype>(diskCount));
+}
+
+void AGLDisks::addDisk(const Point2f &centre) {
+    m_centres.append(QVector2D(localX(centre.x), localY(centre.y)));
+}
+
+QVector4D AGLDisks::colourVector(const QColor &colour) {
+    return QVector4D(static_cast<float>(colour.redF()), static_cast<float>(colour.greenF()),
+                     static_cast<float>(colour.blueF()), static_cast<float>(colour.alphaF()));
+}
+
+void AGLDisks::setColours(const QColor &fillColour, const QColor &outlineColour) {
+    m_fillColour = colourVector(fillColour);
+    m_outlineColour = colourVector(outlineColour);
+}
+
+void AGLDisks::uploadCentres() {
+    m_centreVbo.bind();
+    if (m_instanced) {
+        m_centreVbo.allocate(m_centres.constData(), static_cast<int>(m_centres.size()) *
+                                                        static_cast<int>(sizeof(QVector2D)));
+    } else {
+        // (centre, corner) for the triangles of all the disks, then for the line pairs of
+        // all the outlines
+        const QVector<QVector2D> circle = unitCircle();
+        QVector<GLfloat> vertices;
+        vertices.reserve(m_centres.size() * DISK_SEGMENTS * (3 + 2) * 4);
+        auto addVertex = [&vertices](const QVector2D &centre, const QVector2D &corner) {
+            vertices << centre.x() << centre.y() << corner.x() << corner.y();
+        };
+        for (const QVector2D &centre : m_centres) {
+            for (int segment = 1; segment <= DISK_SEGMENTS; ++segment) {
+                addVertex(centre, circle[0]);
+                addVertex(centre, circle[segment]);
+                addVertex(centre, circle[segment + 1]);
+            }
+        }
+        for (const QVector2D &centre : m_centres) {
+            for (int segment = 1; segment <= DISK_SEGMENTS; ++segment) {
+                addVertex(centre, circle[segment]);
+                addVertex(centre, circle[segment + 1]);
+            }
+        }
+        m_centreVbo.allocate(vertices.constData(), static_cast<int>(vertices.size()) *
+                                                       static_cast<int>(sizeof(GLfloat)));
+    }
+    m_centreVbo.release();
+}
+
+void AGLDisks::setupVertexAttribs() {
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glEnableVertexAttribArray(CENTRE_LOCATION);
+    f->glEnableVertexAttribArray(CORNER_LOCATION);
+    if (m_instanced) {
+        QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
+        m_centreVbo.bind();
+        f->glVertexAttribPointer(CENTRE_LOCATION, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        ef->glVertexAttribDivisor(CENTRE_LOCATION, 1);
+        m_centreVbo.release();
+        m_circleVbo.bind();
+        f->glVertexAttribPointer(CORNER_LOCATION, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        m_circleVbo.release();
+    } else {
+        GLsizei stride = 4 * static_cast<GLsizei>(sizeof(GLfloat));
+        m_centreVbo.bind();
+        f->glVertexAttribPointer(CENTRE_LOCATION, 2, GL_FLOAT, GL_FALSE, stride, 0);
+        f->glVertexAttribPointer(CORNER_LOCATION, 2, GL_FLOAT, GL_FALSE, stride,
+                                 reinterpret_cast<void *>(2 * sizeof(GLfloat)));
+        m_centreVbo.release();
+    }
+}
+
+void AGLDisks::initializeGL(bool core) {
+    if (m_centres.size() == 0)
+        return;
+    m_instanced = AGLArcs::instancingSupport();
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex,
+                                       core ? vertexShaderSourceCore : vertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                       core ? fragmentShaderSourceCore : fragmentShaderSource);
+    m_program->bindAttributeLocation("centre", CENTRE_LOCATION);
+    m_program->bindAttributeLocation("corner", CORNER_LOCATION);
+    m_program->link();
+
+    m_program->bind();
+    m_projMatrixLoc = m_program->uniformLocation("projMatrix");
+    m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+    m_radiusLoc = m_program->uniformLocation("radius");
+    m_colourVectorLoc = m_program->uniformLocation("colourVector");
+
+    m_vao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    if (m_instanced) {
+        const QVector<QVector2D> circle = unitCircle();
+        m_circleVbo.create();
+        m_circleVbo.bind();
+        m_circleVbo.allocate(circle.constData(), static_cast<int>(circle.size()) *
+                                                     static_cast<int>(sizeof(QVector2D)));
+        m_circleVbo.release();
+    }
+    m_centreVbo.create();
+    uploadCentres();
+    setupVertexAttribs();
+
+    m_program->release();
+    m_built = true;
+}
+
+void AGLDisks::updateGL(bool core) {
+    if (m_program == 0) {
+        // has not been initialised yet, do that instead
+        initializeGL(core);
+    } else {
+        QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+        uploadCentres();
+        m_built = true;
+    }
+}
+
+void AGLDisks::cleanup() {
+    if (!m_built)
+        return;
+    m_centreVbo.destroy();
+    m_circleVbo.destroy();
+    delete m_program;
+    m_program = 0;
+}
+
+void AGLDisks::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                       const QMatrix4x4 &mModel) {
+    if (!m_built || m_centres.isEmpty())
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_projMatrixLoc, mProj);
+    m_program->setUniformValue(m_mvMatrixLoc, mView * mModel);
+    m_program->setUniformValue(m_radiusLoc, m_radius);
+
+    GLsizei diskCount = static_cast<GLsizei>(m_centres.size());
+    // the outline first, half of its width is then covered by the fill
+    m_program->setUniformValue(m_colourVectorLoc, QVector4D(m_outlineColour.toVector3D(),
+                                                            m_outlineColour.w() * m_opacity));
+    if (m_instanced) {
+        QOpenGLContext::currentContext()->extraFunctions()->glDrawArraysInstanced(
+            GL_LINE_LOOP, 1, DISK_SEGMENTS, diskCount);
+    } else {
+        QOpenGLContext::currentContext()->functions()->glDrawArrays(
+            GL_LINES, diskCount * DISK_SEGMENTS * 3, diskCount * DISK_SEGMENTS * 2);
+    }
+    m_program->setUniformValue(m_colourVectorLoc, QVector4D(m_fillColour.toVector3D(),
+                                                            m_fillColour.w() * m_opacity));
+    if (m_instanced) {
+        QOpenGLContext::currentContext()->extraFunctions()->glDrawArraysInstanced(
+            GL_TRIANGLE_FAN, 0, DISK_SEGMENTS + 2, diskCount);
+    } else {
+        QOpenGLContext::currentContext()->functions()->glDrawArrays(GL_TRIANGLES, 0,
+                                                                    diskCount * DISK_SEGMENTS * 3);
+    }
+
+    m_program->release();
+}
+
+bool AGLDisks::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    if (!cache.read(key, m_centres))
+        return false;
+    m_built = false;
+    return true;
+}
+
+void AGLDisks::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    cache.write(key, m_centres.constData(), m_centres.size());
+}
@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "aglobject.h"
+
+#include "../func/aglvertexbuffercache.h"
+
+#include "genlib/p2dpoly.h"
+
+#include <QColor>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QVector2D>
+#include <QVector4D>
+#include <QVector>
+
+/**
+ * @brief Filled and outlined disks of a common radius and colours, generated in the vertex
+ * shader from one centre per disk. Where instancing is available each disk is an instance
+ * of a fan (and a loop for the outline) of DISK_SEGMENTS segments around the unit circle,
+ * otherwise the centres are repeated for each vertex on upload and the disks are drawn as
+ * triangles and line pairs. As AGLArcs.
+ */
+class AGLDisks : public AGLObject {
+  public:
+    static const int DISK_SEGMENTS = 32;
+
+    AGLDisks();
+    void init(size_t diskCount);
+    void addDisk(const Point2f &centre);
+    void setRadius(float radius) { m_radius = radius; }
+    void setColours(const QColor &fillColour, const QColor &outlineColour);
+    /** @brief Scales the alpha of the colours when drawing, to fade the disks in and out */
+    void setOpacity(float opacity) { m_opacity = opacity; }
+    void paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                 const QMatrix4x4 &mModel) override;
+    void initializeGL(bool core) override;
+    void updateGL(bool core) override;
+    void cleanup() override;
+    size_t diskCount() const { return static_cast<size_t>(m_centres.size()); }
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
+    AGLDisks(const AGLDisks &) = delete;
+    AGLDisks &operator=(const AGLDisks &) = delete;
+
+  private:
+    static QVector4D colourVector(const QColor &colour);
+    void uploadCentres();
+    void setupVertexAttribs();
+
+    QVector<QVector2D> m_centres;
+    float m_radius = 1.0f;
+    QVector4D m_fillColour = QVector4D(0.0f, 0.0f, 0.0f, 1.0f);
+    QVector4D m_outlineColour = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+    float m_opacity = 1.0f;
+    bool m_instanced = false;
+    bool m_built = false;
+
+    QOpenGLVertexArrayObject m_vao;
+    // the centres, per instance or per vertex
+    QOpenGLBuffer m_centreVbo;
+    // the centre and the points around the unit circle, only used when instanced
+    QOpenGLBuffer m_circleVbo;
+    QOpenGLShaderProgram *m_program;
+    int m_projMatrixLoc;
+    int m_mvMatrixLoc;
+    int m_radiusLoc;
+    int m_colourVectorLoc;
+};
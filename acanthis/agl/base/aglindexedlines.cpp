@@ -0,0 +1,290 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglindexedlines.h"
+
+#include <QOpenGLContext>
+
+#ifndef GL_PRIMITIVE_RESTART
+#define GL_PRIMITIVE_RESTART 0x8F9D
+#endif
+#ifndef GL_PRIMITIVE_RESTART_FIXED_INDEX
+#define GL_PRIMITIVE_RESTART_FIXED_INDEX 0x8D69
+#endif
+
+typedef void(QOPENGLF_APIENTRYP PrimitiveRestartIndexFunction)(GLuint);
+
+static const char *vertexShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec4 vertex;\n"
+    "in vec4 colour;\n"
+    "in float filterValue;\n"
+    "in float selected;\n"
+    "out vec4 col;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform vec2 filterRange;\n"
+    "uniform vec4 selectionColour;\n"
+    "void main() {\n"
+    "   col = selected > 0.5 ? selectionColour : colour;\n"
+    "   gl_Position = projMatrix * mvMatrix * vertex;\n"
+    "   if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+    "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec4 col;\n"
+    "out highp vec4 fragColor;\n"
+    "void main() {\n"
+    "   fragColor = col;\n"
+    "}\n";
+
+static const char *vertexShaderSource = // auto-format hack
+    "attribute vec4 vertex;\n"
+    "attribute vec4 colour;\n"
+    "attribute float filterValue;\n"
+    "attribute float selected;\n"
+    "varying vec4 col;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform vec2 filterRange;\n"
+    "uniform vec4 selectionColour;\n"
+    "void main() {\n"
+    "   col = selected > 0.5 ? selectionColour : colour;\n"
+    "   gl_Position = projMatrix * mvMatrix * vertex;\n"
+    "   if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+    "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSource = // auto-format hack
+    "varying highp vec4 col;\n"
+    "void main() {\n"
+    "   gl_FragColor = col;\n"
+    "}\n";
+
+AGLIndexedLines::StripSupport AGLIndexedLines::stripSupport() {
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    const QSurfaceFormat &format = context->format();
+    if (context->isOpenGLES())
+        return format.majorVersion() >= 3 ? StripSupport::FIXED_RESTART_INDEX : StripSupport::NONE;
+    if (format.version() >= qMakePair(4, 3))
+        return StripSupport::FIXED_RESTART_INDEX;
+    if (format.version() >= qMakePair(3, 1) &&
+        context->getProcAddress("glPrimitiveRestartIndex") != nullptr)
+        return StripSupport::RESTART_INDEX;
+    return StripSupport::NONE;
+}
+
+QVector<GLuint> AGLIndexedLines::stripsToLines(const QVector<GLuint> &strips) {
+    QVector<GLuint> lines;
+    lines.reserve(strips.size() * 2);
+    for (qsizetype i = 1; i < strips.size(); ++i) {
+        if (strips[i - 1] == RESTART_INDEX || strips[i] == RESTART_INDEX)
+            continue;
+        lines.append(strips[i - 1]);
+        lines.append(strips[i]);
+    }
+    return lines;
+}
+
+void AGLIndexedLines::drawStrips(StripSupport support, GLsizei count) {
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QOpenGLFunctions *glFuncs = context->functions();
+    switch (support) {
+    case StripSupport::FIXED_RESTART_INDEX:
+        glFuncs->glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+        glFuncs->glDrawElements(GL_LINE_STRIP, count, GL_UNSIGNED_INT, 0);
+        glFuncs->glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+        break;
+    case StripSupport::RESTART_INDEX: {
+        PrimitiveRestartIndexFunction primitiveRestartIndex =
+            reinterpret_cast<PrimitiveRestartIndexFunction>(
+                context->getProcAddress("glPrimitiveRestartIndex"));
+        glFuncs->glEnable(GL_PRIMITIVE_RESTART);
+        primitiveRestartIndex(RESTART_INDEX);
+        glFuncs->glDrawElements(GL_LINE_STRIP, count, GL_UNSIGNED_INT, 0);
+        glFuncs->glDisable(GL_PRIMITIVE_RESTART);
+        break;
+    }
+    case StripSupport::NONE:
+        glFuncs->glDrawElements(GL_LINES, count, GL_UNSIGNED_INT, 0);
+        break;
+    }
+}
+
+AGLIndexedLines::AGLIndexedLines() : m_program(0) {}
+
+void AGLIndexedLines::init(size_t vertexCount, size_t stripCount) {
+    m_built = false;
+    m_data.clear();
+    m_indices.clear();
+    m_filterValues.clear();
+    m_selectionFlags.clear();
+    m_data.reserve(static_cast<qsizetype>(vertexCount));
+    m_indices.reserve(static_cast<qsizetype>(vertexCount + 2 * stripCount));
+}
+
+void AGLIndexedLines::addStrip(const std::vector<Point2f> &points, const QRgb &colour,
+                               bool closed) {
+    addStrip(points, colour, closed, 0.0f);
+}
+
+void AGLIndexedLines::addStrip(const std::vector<Point2f> &points, const QRgb &colour, bool closed,
+                               float filterValue) {
+    if (appendStrip(points, colour, closed))
+        m_filterValues.append(filterValue, points.size());
+}
+
+bool AGLIndexedLines::appendStrip(const std::vector<Point2f> &points, const QRgb &colour,
+                                  bool closed) {
+    if (points.size() < 2)
+        return false;
+    if (!m_indices.isEmpty())
+        m_indices.append(RESTART_INDEX);
+    GLuint first = static_cast<GLuint>(m_data.size());
+    for (const Point2f &point : points) {
+        m_indices.append(static_cast<GLuint>(m_data.size()));
+        m_data.append(AGLColouredVertex(localX(point.x), localY(point.y), colour));
+    }
+    if (closed)
+        m_indices.append(first);
+    return true;
+}
+
+void AGLIndexedLines::setupVertexAttribs() {
+    m_vbo.bind();
+    AGLColouredVertex::setupVertexAttribs(QOpenGLContext::currentContext()->functions());
+    m_vbo.release();
+}
+
+void AGLIndexedLines::uploadIndices() {
+    if (m_stripSupport == StripSupport::NONE) {
+        QVector<GLuint> lines = stripsToLines(m_indices);
+        m_ibo.allocate(lines.constData(),
+                       static_cast<int>(lines.size() * static_cast<qsizetype>(sizeof(GLuint))));
+        m_drawCount = static_cast<GLsizei>(lines.size());
+    } else {
+        m_ibo.allocate(m_indices.constData(),
+                       static_cast<int>(m_indices.size() * static_cast<qsizetype>(sizeof(GLuint))));
+        m_drawCount = static_cast<GLsizei>(m_indices.size());
+    }
+}
+
+void AGLIndexedLines::initializeGL(bool core) {
+    if (m_data.size() == 0)
+        return;
+    m_stripSupport = stripSupport();
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex,
+                                       core ? vertexShaderSourceCore : vertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                       core ? fragmentShaderSourceCore : fragmentShaderSource);
+    m_program->bindAttributeLocation("vertex", 0);
+    m_program->bindAttributeLocation("colour", 1);
+    m_program->bindAttributeLocation("filterValue", AGLShapeValues::FILTER_LOCATION);
+    m_program->bindAttributeLocation("selected", AGLShapeValues::SELECTION_LOCATION);
+    m_program->link();
+
+    m_program->bind();
+    m_projMatrixLoc = m_program->uniformLocation("projMatrix");
+    m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+    m_filterRangeLoc = m_program->uniformLocation("filterRange");
+    m_selectionColourLoc = m_program->uniformLocation("selectionColour");
+
+    m_vao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    m_vbo.create();
+    m_vbo.bind();
+    m_vbo.allocate(m_data.constData(),
+                   static_cast<int>(m_data.size()) * static_cast<int>(sizeof(AGLColouredVertex)));
+
+    setupVertexAttribs();
+    m_filterValues.initializeGL();
+    m_selectionFlags.initializeGL();
+
+    m_ibo.create();
+    m_ibo.bind();
+    uploadIndices();
+
+    m_program->release();
+    m_built = true;
+}
+
+void AGLIndexedLines::updateGL(bool core) {
+    if (m_program == 0) {
+        // has not been initialised yet, do that instead
+        initializeGL(core);
+    } else {
+        QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+        m_vbo.bind();
+        m_vbo.allocate(m_data.constData(), static_cast<int>(m_data.size()) *
+                                               static_cast<int>(sizeof(AGLColouredVertex)));
+        m_vbo.release();
+        m_filterValues.updateGL();
+        m_selectionFlags.updateGL();
+        m_ibo.bind();
+        uploadIndices();
+        m_built = true;
+    }
+}
+
+void AGLIndexedLines::updateSelectionGL() {
+    if (m_program == 0)
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_selectionFlags.updateGL();
+}
+
+void AGLIndexedLines::cleanup() {
+    if (!m_built)
+        return;
+    m_vbo.destroy();
+    m_ibo.destroy();
+    m_filterValues.cleanup();
+    m_selectionFlags.cleanup();
+    delete m_program;
+    m_program = 0;
+}
+
+void AGLIndexedLines::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                              const QMatrix4x4 &mModel) {
+    if (!m_built || m_drawCount == 0)
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_projMatrixLoc, mProj);
+    m_program->setUniformValue(m_mvMatrixLoc, mView * mModel);
+    m_program->setUniformValue(m_filterRangeLoc, m_filterRange);
+    m_program->setUniformValue(m_selectionColourLoc, m_selectionColour);
+    m_filterValues.bindForPaint();
+    m_selectionFlags.bindForPaint();
+
+    m_ibo.bind();
+    drawStrips(m_stripSupport, m_drawCount);
+    m_ibo.release();
+
+    m_program->release();
+}
+
+bool AGLIndexedLines::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    QVector<AGLColouredVertex> data;
+    QVector<GLuint> indices;
+    if (!cache.read(key + ".indices", indices) || !cache.read(key, data) ||
+        !AGLVertexBufferCache::indicesInRange(indices, data.size(), RESTART_INDEX) ||
+        !m_filterValues.loadFromCache(cache, key) || m_filterValues.vertexCount() != data.size())
+        return false;
+    m_data = std::move(data);
+    m_indices = std::move(indices);
+    m_built = false;
+    m_selectionFlags.clear();
+    return true;
+}
+
+void AGLIndexedLines::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    cache.write(key + ".indices", m_indices.constData(), m_indices.size());
+    cache.write(key, m_data.constData(), m_data.size());
+    m_filterValues.storeToCache(cache, key);
+}
@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "aglshapevalues.h"
+#include "aglobject.h"
+#include "aglvertex.h"
+
+#include "../func/aglvertexbuffercache.h"
+
+#include "genlib/p2dpoly.h"
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QRgb>
+#include <QVector4D>
+#include <QVector>
+
+/**
+ * @brief Polylines stored as runs of unique vertices with an index buffer. Each run is drawn
+ * as a line strip, separated from the next by RESTART_INDEX. Where the context does not
+ * support primitive restart the strips are expanded to indexed line pairs on upload, which
+ * still avoids duplicating the vertices.
+ */
+class AGLIndexedLines : public AGLObject {
+  public:
+    static const GLuint RESTART_INDEX = 0xFFFFFFFF;
+
+    enum class StripSupport { FIXED_RESTART_INDEX, RESTART_INDEX, NONE };
+    /** @brief How RESTART_INDEX-separated strips can be drawn in the current context */
+    static StripSupport stripSupport();
+    /** @brief Converts RESTART_INDEX-separated strips to line pairs */
+    static QVector<GLuint> stripsToLines(const QVector<GLuint> &strips);
+    /** @brief Draws the currently bound strip index buffer, count is after any conversion */
+    static void drawStrips(StripSupport support, GLsizei count);
+
+    AGLIndexedLines();
+    void init(size_t vertexCount, size_t stripCount);
+    void addStrip(const std::vector<Point2f> &points, const QRgb &colour, bool closed);
+    /** @brief Adds a strip along with its filter value, 0 when not given */
+    void addStrip(const std::vector<Point2f> &points, const QRgb &colour, bool closed,
+                  float filterValue);
+    void paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                 const QMatrix4x4 &mModel) override;
+    void initializeGL(bool core) override;
+    void updateGL(bool core) override;
+    void cleanup() override;
+    int vertexCount() const { return static_cast<int>(m_data.size()); }
+    void setFilterRange(const QVector2D &filterRange) { m_filterRange = filterRange; }
+    /** @brief One flag per shape in the order they were added, 1 draws it as selected */
+    void setSelectedShapes(const std::vector<float> &flags) {
+        m_selectionFlags.assign(flags, m_filterValues.getShapeVertexCounts());
+    }
+    /** @brief Uploads the selection flags alone, the vertices are left as they are */
+    void updateSelectionGL();
+    size_t shapeCount() const { return m_filterValues.shapeCount(); }
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
+    AGLIndexedLines(const AGLIndexedLines &) = delete;
+    AGLIndexedLines &operator=(const AGLIndexedLines &) = delete;
+
+  private:
+    bool appendStrip(const std::vector<Point2f> &points, const QRgb &colour, bool closed);
+    void setupVertexAttribs();
+    void uploadIndices();
+
+    QVector<AGLColouredVertex> m_data;
+    AGLShapeValues m_filterValues{AGLShapeValues::FILTER_LOCATION};
+    AGLShapeValues m_selectionFlags{AGLShapeValues::SELECTION_LOCATION,
+                                    AGLShapeValues::Type::FLAG};
+    QVector2D m_filterRange = AGLShapeValues::unfilteredRange();
+    QVector4D m_selectionColour = QVector4D(1.0f, 1.0f, 0.0f, 1.0f);
+    QVector<GLuint> m_indices;
+    GLsizei m_drawCount = 0;
+    StripSupport m_stripSupport = StripSupport::NONE;
+    bool m_built = false;
+
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vbo;
+    QOpenGLBuffer m_ibo = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    QOpenGLShaderProgram *m_program;
+    int m_projMatrixLoc;
+    int m_mvMatrixLoc;
+    int m_filterRangeLoc;
+    int m_selectionColourLoc;
+};
@@ -11,38 +11,50 @@
 static const char *vertexShaderSourceCore = //
     "#version 150\n"
     "in vec4 vertex;\n"
-    "in vec3 colour;\n"
-    "out vec3 col;\n"
+    "in vec4 colour;\n"
+    "in float filterValue;\n"
+    "in float selected;\n"
+    "out vec4 col;\n"
     "uniform mat4 projMatrix;\n"
     "uniform mat4 mvMatrix;\n"
+    "uniform vec2 filterRange;\n"
+    "uniform vec4 selectionColour;\n"
     "void main() {\n"
-    "   col = colour.xyz;\n"
+    "   col = selected > 0.5 ? selectionColour : colour;\n"
     "   gl_Position = projMatrix * mvMatrix * vertex;\n"
+    "   if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+    "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
     "}\n";
 
 static const char *fragmentShaderSourceCore = //
     "#version 150\n"
-    "in vec3 col;\n"
-    "out highp vec3 fragColor;\n"
+    "in vec4 col;\n"
+    "out highp vec4 fragColor;\n"
     "void main() {\n"
     "   fragColor = col;\n"
     "}\n";
 
 static const char *vertexShaderSource = //
     "attribute vec4 vertex;\n"
-    "attribute vec3 colour;\n"
-    "varying vec3 col;\n"
+    "attribute vec4 colour;\n"
+    "attribute float filterValue;\n"
+    "attribute float selected;\n"
+    "varying vec4 col;\n"
     "uniform mat4 projMatrix;\n"
     "uniform mat4 mvMatrix;\n"
+    "uniform vec2 filterRange;\n"
+    "uniform vec4 selectionColour;\n"
     "void main() {\n"
-    "   col = colour.xyz;\n"
+    "   col = selected > 0.5 ? selectionColour : colour;\n"
     "   gl_Position = projMatrix * mvMatrix * vertex;\n"
+    "   if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+    "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
     "}\n";
 
 static const char *fragmentShaderSource = //
-    "varying highp vec3 col;\n"
+    "varying highp vec4 col;\n"
     "void main() {\n"
-    "   gl_FragColor = vec4(col, 1.0);\n"
+    "   gl_FragColor = col;\n"
     "}\n";
 
 /**
@@ -52,35 +64,34 @@ static const char *fragmentShaderSource = //
 
 AGLLines::AGLLines() : m_count(0), m_program(0) {}
 
-void AGLLines::loadLineData(const std::vector<std::pair<SimpleLine, PafColor>> &colouredLines) {
+void AGLLines::loadLineData(const std::vector<std::pair<SimpleLine, PafColor>> &colouredLines,
+                            const std::vector<float> &filterValues) {
     m_built = false;
 
     m_count = 0;
-    m_data.resize(
-        static_cast<qsizetype>(colouredLines.size() * 2 * static_cast<size_t>(DATA_DIMENSIONS)));
+    m_data.resize(static_cast<qsizetype>(colouredLines.size() * 2));
+    m_filterValues.clear();
+    m_selectionFlags.clear();
+    // values are kept even when not given, they also mark out the shapes for selection
+    bool hasFilterValues = filterValues.size() == colouredLines.size();
+    m_filterValues.reserve(colouredLines.size());
+    for (size_t lineIndex = 0; lineIndex < colouredLines.size(); ++lineIndex) {
+        m_filterValues.append(hasFilterValues ? filterValues[lineIndex] : 0.0f, 2);
+    }
 
     for (auto &colouredLine : colouredLines) {
         const SimpleLine &line = colouredLine.first;
         const PafColor &colour = colouredLine.second;
 
-        QVector3D colourVector(colour.redf(), colour.greenf(), colour.bluef());
-        add(QVector3D(static_cast<float>(line.start().x), static_cast<float>(line.start().y), 0.0f),
-            colourVector);
-        add(QVector3D(static_cast<float>(line.end().x), static_cast<float>(line.end().y), 0.0f),
-            colourVector);
+        QRgb rgb = qRgb(colour.redb(), colour.greenb(), colour.blueb());
+        add(line.start(), rgb);
+        add(line.end(), rgb);
     }
 }
 
 void AGLLines::setupVertexAttribs() {
     m_vbo.bind();
-    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
-    f->glEnableVertexAttribArray(0);
-    f->glEnableVertexAttribArray(1);
-    f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-                             DATA_DIMENSIONS * static_cast<GLsizei>(sizeof(GLfloat)), 0);
-    f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-                             DATA_DIMENSIONS * static_cast<GLsizei>(sizeof(GLfloat)),
-                             reinterpret_cast<void *>(3 * sizeof(GLfloat)));
+    AGLColouredVertex::setupVertexAttribs(QOpenGLContext::currentContext()->functions());
     m_vbo.release();
 }
 
@@ -94,11 +105,15 @@ void AGLLines::initializeGL(bool core) {
                                        core ? fragmentShaderSourceCore : fragmentShaderSource);
     m_program->bindAttributeLocation("vertex", 0);
     m_program->bindAttributeLocation("colour", 1);
+    m_program->bindAttributeLocation("filterValue", AGLShapeValues::FILTER_LOCATION);
+    m_program->bindAttributeLocation("selected", AGLShapeValues::SELECTION_LOCATION);
     m_program->link();
 
     m_program->bind();
     m_projMatrixLoc = m_program->uniformLocation("projMatrix");
     m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+    m_filterRangeLoc = m_program->uniformLocation("filterRange");
+    m_selectionColourLoc = m_program->uniformLocation("selectionColour");
 
     // Create a vertex array object. In OpenGL ES 2.0 and OpenGL 2.x
     // implementations this is optional and support may not be present
@@ -110,10 +125,12 @@ void AGLLines::initializeGL(bool core) {
     // Setup our vertex buffer object.
     m_vbo.create();
     m_vbo.bind();
-    m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(GLfloat)));
+    m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(AGLColouredVertex)));
 
     // Store the vertex attribute bindings for the program.
     setupVertexAttribs();
+    m_filterValues.initializeGL();
+    m_selectionFlags.initializeGL();
     m_program->release();
     m_built = true;
 }
@@ -125,16 +142,27 @@ void AGLLines::updateGL(bool core) {
     } else {
         QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
         m_vbo.bind();
-        m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(GLfloat)));
+        m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(AGLColouredVertex)));
         m_vbo.release();
+        m_filterValues.updateGL();
+        m_selectionFlags.updateGL();
         m_built = true;
     }
 }
 
+void AGLLines::updateSelectionGL() {
+    if (m_program == 0)
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_selectionFlags.updateGL();
+}
+
 void AGLLines::cleanup() {
     if (!m_built)
         return;
     m_vbo.destroy();
+    m_filterValues.cleanup();
+    m_selectionFlags.cleanup();
     delete m_program;
     m_program = 0;
 }
@@ -146,6 +174,10 @@ void AGLLines::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView, const Q
     m_program->bind();
     m_program->setUniformValue(m_projMatrixLoc, mProj);
     m_program->setUniformValue(m_mvMatrixLoc, mView * mModel);
+    m_program->setUniformValue(m_filterRangeLoc, m_filterRange);
+    m_program->setUniformValue(m_selectionColourLoc, m_selectionColour);
+    m_filterValues.bindForPaint();
+    m_selectionFlags.bindForPaint();
 
     QOpenGLFunctions *glFuncs = QOpenGLContext::currentContext()->functions();
     glFuncs->glDrawArrays(GL_LINES, 0, vertexCount());
@@ -153,13 +185,22 @@ void AGLLines::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView, const Q
     m_program->release();
 }
 
-void AGLLines::add(const QVector3D &v, const QVector3D &c) {
-    GLfloat *p = m_data.data() + m_count;
-    *p++ = v.x();
-    *p++ = v.y();
-    *p++ = v.z();
-    *p++ = c.x();
-    *p++ = c.y();
-    *p++ = c.z();
-    m_count += DATA_DIMENSIONS;
+void AGLLines::add(const Point2f &v, const QRgb &c) {
+    m_data[m_count] = AGLColouredVertex(localX(v.x), localY(v.y), c);
+    m_count++;
+}
+
+bool AGLLines::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    if (!cache.read(key, m_data) || !m_filterValues.loadFromCache(cache, key) ||
+        m_filterValues.vertexCount() != m_data.size())
+        return false;
+    m_built = false;
+    m_selectionFlags.clear();
+    m_count = static_cast<int>(m_data.size());
+    return true;
+}
+
+void AGLLines::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    cache.write(key, m_data.constData(), m_count);
+    m_filterValues.storeToCache(cache, key);
 }
@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include "aglshapevalues.h"
 #include "aglobject.h"
+#include "aglvertex.h"
+
+#include "../func/aglvertexbuffercache.h"
 
 #include "salalib/pafcolor.h"
 
@@ -15,7 +19,7 @@
 #include <QOpenGLShaderProgram>
 #include <QOpenGLVertexArrayObject>
 #include <QRgb>
-#include <QVector3D>
+#include <QVector4D>
 #include <QVector>
 
 class AGLLines : public AGLObject {
@@ -23,23 +27,39 @@ class AGLLines : public AGLObject {
 
   public:
     AGLLines();
-    void loadLineData(const std::vector<std::pair<SimpleLine, PafColor>> &colouredLines);
+    /** @brief filterValues are optional, with one value per line */
+    void loadLineData(const std::vector<std::pair<SimpleLine, PafColor>> &colouredLines,
+                      const std::vector<float> &filterValues = std::vector<float>());
     void paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
                  const QMatrix4x4 &mModel) override;
     void initializeGL(bool core) override;
     void updateGL(bool core) override;
     void cleanup() override;
-    int vertexCount() const { return m_count / DATA_DIMENSIONS; }
+    int vertexCount() const { return m_count; }
+    void setFilterRange(const QVector2D &filterRange) { m_filterRange = filterRange; }
+    /** @brief One flag per shape in the order they were added, 1 draws it as selected */
+    void setSelectedShapes(const std::vector<float> &flags) {
+        m_selectionFlags.assign(flags, m_filterValues.getShapeVertexCounts());
+    }
+    /** @brief Uploads the selection flags alone, the vertices are left as they are */
+    void updateSelectionGL();
+    size_t shapeCount() const { return m_filterValues.shapeCount(); }
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
     AGLLines(const AGLLines &) = delete;
     AGLLines &operator=(const AGLLines &) = delete;
 
   private:
-    const int DATA_DIMENSIONS = 6;
     void setupVertexAttribs();
-    const GLfloat *constData() const { return m_data.constData(); }
-    void add(const QVector3D &v, const QVector3D &c);
+    const AGLColouredVertex *constData() const { return m_data.constData(); }
+    void add(const Point2f &v, const QRgb &c);
 
-    QVector<GLfloat> m_data;
+    QVector<AGLColouredVertex> m_data;
+    AGLShapeValues m_filterValues{AGLShapeValues::FILTER_LOCATION};
+    AGLShapeValues m_selectionFlags{AGLShapeValues::SELECTION_LOCATION,
+                                    AGLShapeValues::Type::FLAG};
+    QVector2D m_filterRange = AGLShapeValues::unfilteredRange();
+    QVector4D m_selectionColour = QVector4D(1.0f, 1.0f, 0.0f, 1.0f);
     int m_count;
     bool m_built = false;
 
@@ -48,4 +68,6 @@ class AGLLines : public AGLObject {
     QOpenGLShaderProgram *m_program;
     int m_projMatrixLoc;
     int m_mvMatrixLoc;
+    int m_filterRangeLoc;
+    int m_selectionColourLoc;
 };
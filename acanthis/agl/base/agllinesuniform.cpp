@@ -51,9 +51,8 @@ void AGLLinesUniform::loadLineData(const std::vector<SimpleLine> &lines, const Q
     m_data.resize(static_cast<qsizetype>(lines.size() * 2 * static_cast<size_t>(DATA_DIMENSIONS)));
 
     for (auto &line : lines) {
-        add(QVector3D(static_cast<float>(line.start().x), static_cast<float>(line.start().y),
-                      0.0f));
-        add(QVector3D(static_cast<float>(line.end().x), static_cast<float>(line.end().y), 0.0f));
+        add(QVector3D(localX(line.start().x), localY(line.start().y), 0.0f));
+        add(QVector3D(localX(line.end().x), localY(line.end().y), 0.0f));
     }
     m_colour.setX(lineColour.redF());
     m_colour.setY(lineColour.greenF());
@@ -142,6 +141,8 @@ void AGLLinesUniform::paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mVi
     m_program->bind();
     m_program->setUniformValue(m_projMatrixLoc, m_mProj);
     m_program->setUniformValue(m_mvMatrixLoc, m_mView * m_mModel);
+    m_program->setUniformValue(
+        m_colourVectorLoc, QVector4D(m_colour.toVector3D(), m_colour.w() * m_opacity));
 
     QOpenGLFunctions *glFuncs = QOpenGLContext::currentContext()->functions();
     glFuncs->glDrawArrays(GL_LINES, 0, vertexCount());
@@ -156,3 +157,19 @@ void AGLLinesUniform::add(const QVector3D &v) {
     *p++ = v.z();
     m_count += DATA_DIMENSIONS;
 }
+
+bool AGLLinesUniform::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    QVector<GLfloat> colour;
+    if (!cache.read(key + ".colour", colour) || colour.size() != 4 || !cache.read(key, m_data))
+        return false;
+    m_built = false;
+    m_count = static_cast<int>(m_data.size());
+    m_colour = QVector4D(colour[0], colour[1], colour[2], colour[3]);
+    return true;
+}
+
+void AGLLinesUniform::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    const GLfloat colour[4] = {m_colour.x(), m_colour.y(), m_colour.z(), m_colour.w()};
+    cache.write(key + ".colour", colour, 4);
+    cache.write(key, m_data.constData(), m_count);
+}
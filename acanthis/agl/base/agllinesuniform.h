@@ -6,6 +6,8 @@
 
 #include "aglobject.h"
 
+#include "../func/aglvertexbuffercache.h"
+
 #include "genlib/p2dpoly.h"
 
 #include <QColor>
@@ -26,7 +28,11 @@ class AGLLinesUniform : public AGLObject {
     void updateGL(bool core) override;
     void cleanup() override;
     void updateColour(const QColor &lineColour);
+    /** @brief Scales the alpha of the colour when drawing, to fade the object in and out */
+    void setOpacity(float opacity) { m_opacity = opacity; }
     int vertexCount() const { return m_count / DATA_DIMENSIONS; }
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
     AGLLinesUniform(const AGLLinesUniform &) = delete;
     AGLLinesUniform &operator=(const AGLLinesUniform &) = delete;
 
@@ -40,6 +46,7 @@ class AGLLinesUniform : public AGLObject {
     int m_count;
     bool m_built = false;
     QVector4D m_colour = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+    float m_opacity = 1.0f;
 
     QOpenGLVertexArrayObject m_vao;
     QOpenGLBuffer m_vbo;
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "genlib/p2dpoly.h"
+
 #include <QMatrix4x4>
 
 class AGLObject {
@@ -15,5 +17,18 @@ class AGLObject {
     virtual void cleanup() = 0;
     virtual void paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView,
                          const QMatrix4x4 &m_mModel) = 0;
+    /**
+     * @brief Positions are stored as floats relative to the origin, so that they keep their
+     * precision far away from (0, 0), and the model matrix given to paintGL has to move them
+     * back. Set before loading any data.
+     */
+    virtual void setOrigin(const Point2f &origin) { m_origin = origin; }
+    const Point2f &getOrigin() const { return m_origin; }
     virtual ~AGLObject(){};
+
+  protected:
+    float localX(double x) const { return static_cast<float>(x - m_origin.x); }
+    float localY(double y) const { return static_cast<float>(y - m_origin.y); }
+
+    Point2f m_origin;
 };
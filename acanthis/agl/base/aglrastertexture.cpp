@@ -22,10 +22,18 @@ static const char *vertexShaderSourceCore = // auto-format hack
 static const char *fragmentShaderSourceCore = // auto-format hack
     "#version 150\n"
     "uniform sampler2D texture;\n"
+    "uniform sampler2D filterTexture;\n"
+    "uniform vec2 filterRange;\n"
+    "uniform vec4 selectionColour;\n"
     "in mediump vec4 texc;\n"
     "void main(void)\n"
     "{\n"
-    "    gl_FragColor = texture2D(texture, texc.st);\n"
+    "    vec4 filterTexel = texture2D(filterTexture, texc.st);\n"
+    "    float filterValue = filterTexel.a > 0.5\n"
+    "        ? (filterTexel.r * 65280.0 + filterTexel.g * 255.0) / 65535.0 : -1.0;\n"
+    "    if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+    "        discard;\n"
+    "    gl_FragColor = filterTexel.b > 0.5 ? selectionColour : texture2D(texture, texc.st);\n"
     "}\n";
 
 static const char *vertexShaderSource = // auto-format hack
@@ -42,16 +50,29 @@ static const char *vertexShaderSource = // auto-format hack
 
 static const char *fragmentShaderSource = // auto-format hack
     "uniform sampler2D texture;\n"
+    "uniform sampler2D filterTexture;\n"
+    "uniform highp vec2 filterRange;\n"
+    "uniform highp vec4 selectionColour;\n"
     "varying mediump vec4 texc;\n"
     "void main(void)\n"
     "{\n"
-    "    gl_FragColor = texture2D(texture, texc.st);\n"
+    "    highp vec4 filterTexel = texture2D(filterTexture, texc.st);\n"
+    "    highp float filterValue = filterTexel.a > 0.5\n"
+    "        ? (filterTexel.r * 65280.0 + filterTexel.g * 255.0) / 65535.0 : -1.0;\n"
+    "    if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+    "        discard;\n"
+    "    gl_FragColor = filterTexel.b > 0.5 ? selectionColour : texture2D(texture, texc.st);\n"
     "}\n";
 
 AGLRasterTexture::AGLRasterTexture()
-    : m_count(0), m_program(0), m_texture(QOpenGLTexture::Target2D) {}
-void AGLRasterTexture::loadRegionData(float minX, float minY, float maxX, float maxY) {
+    : m_count(0), m_program(0), m_texture(QOpenGLTexture::Target2D),
+      m_filterTexture(QOpenGLTexture::Target2D) {}
+void AGLRasterTexture::loadRegionData(const QtRegion &region) {
     m_built = false;
+    float minX = localX(region.bottom_left.x);
+    float minY = localY(region.bottom_left.y);
+    float maxX = localX(region.top_right.x);
+    float maxY = localY(region.top_right.y);
 
     m_count = 0;
     m_data.resize(4 * DATA_DIMENSIONS);
@@ -91,6 +112,9 @@ void AGLRasterTexture::initializeGL(bool coreProfile) {
     m_projMatrixLoc = m_program->uniformLocation("projMatrix");
     m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
     m_textureSamplerLoc = m_program->uniformLocation("texture");
+    m_filterTextureSamplerLoc = m_program->uniformLocation("filterTexture");
+    m_filterRangeLoc = m_program->uniformLocation("filterRange");
+    m_selectionColourLoc = m_program->uniformLocation("selectionColour");
 
     m_vao.create();
     QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
@@ -104,6 +128,7 @@ void AGLRasterTexture::initializeGL(bool coreProfile) {
     setupVertexAttribs();
 
     m_program->setUniformValue(m_textureSamplerLoc, 0);
+    m_program->setUniformValue(m_filterTextureSamplerLoc, 1);
 
     m_program->release();
     m_built = true;
@@ -132,11 +157,38 @@ void AGLRasterTexture::loadPixelData(QImage &data) {
     m_program->release();
 }
 
+void AGLRasterTexture::loadFilterData(QImage &data) {
+    if (!m_built)
+        return;
+    m_program->bind();
+    if (m_filterTexture.isCreated()) {
+        m_filterTexture.destroy();
+    }
+    // no mipmaps or interpolation, neighbouring values must not be mixed
+    m_filterTexture.setData(data, QOpenGLTexture::DontGenerateMipMaps);
+    m_filterTexture.setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+    m_program->release();
+}
+
+void AGLRasterTexture::updateFilterData(QImage &data) {
+    if (!m_built)
+        return;
+    if (!m_filterTexture.isCreated() || m_filterTexture.width() != data.width() ||
+        m_filterTexture.height() != data.height()) {
+        loadFilterData(data);
+        return;
+    }
+    // same size, write over the existing storage instead of recreating the texture
+    m_filterTexture.setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8,
+                            data.convertToFormat(QImage::Format_RGBA8888).constBits());
+}
+
 void AGLRasterTexture::cleanup() {
     if (!m_built)
         return;
     m_vbo.destroy();
     m_texture.destroy();
+    m_filterTexture.destroy();
     delete m_program;
     m_program = 0;
 }
@@ -149,7 +201,11 @@ void AGLRasterTexture::paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mV
     m_program->bind();
     m_program->setUniformValue(m_projMatrixLoc, m_mProj);
     m_program->setUniformValue(m_mvMatrixLoc, m_mView * m_mModel);
+    m_program->setUniformValue(m_filterRangeLoc, m_filterRange);
+    m_program->setUniformValue(m_selectionColourLoc, m_selectionColour);
 
+    if (m_filterTexture.isCreated())
+        m_filterTexture.bind(1, QOpenGLTexture::ResetTextureUnit);
     m_texture.bind();
     QOpenGLFunctions *glFuncs = QOpenGLContext::currentContext()->functions();
     glFuncs->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "aglshapevalues.h"
 #include "aglobject.h"
 
 #include <QOpenGLBuffer>
@@ -11,13 +12,23 @@
 #include <QOpenGLTexture>
 #include <QOpenGLVertexArrayObject>
 #include <QVector3D>
+#include <QVector4D>
 #include <QVector>
 
 class AGLRasterTexture : public AGLObject {
   public:
     AGLRasterTexture();
-    void loadRegionData(float minX, float minY, float maxX, float maxY);
+    void loadRegionData(const QtRegion &region);
     void loadPixelData(QImage &data);
+    /**
+     * @brief The filter value of each pixel, between 0 and 1 and packed into 16 bits with
+     * the high byte in red and the low byte in green. Pixels with an alpha of 0 have no value.
+     * Pixels with a blue over half are drawn in the selection colour
+     */
+    void loadFilterData(QImage &data);
+    /** @brief As loadFilterData, reusing the texture when the size has not changed */
+    void updateFilterData(QImage &data);
+    void setFilterRange(const QVector2D &filterRange) { m_filterRange = filterRange; }
     void paintGL(const QMatrix4x4 &m_proj, const QMatrix4x4 &m_camera,
                  const QMatrix4x4 &m_mModel) override;
     void initializeGL(bool coreProfile) override;
@@ -44,6 +55,12 @@ class AGLRasterTexture : public AGLObject {
     int m_projMatrixLoc;
     int m_mvMatrixLoc;
     int m_textureSamplerLoc;
+    int m_filterTextureSamplerLoc;
+    int m_filterRangeLoc;
+    int m_selectionColourLoc;
+    QVector2D m_filterRange = AGLShapeValues::unfilteredRange();
+    QVector4D m_selectionColour = QVector4D(1.0f, 1.0f, 0.0f, 1.0f);
 
     QOpenGLTexture m_texture;
+    QOpenGLTexture m_filterTexture;
 };
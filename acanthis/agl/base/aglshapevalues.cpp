@@ -0,0 +1,99 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglshapevalues.h"
+
+#include <QOpenGLContext>
+#include <QVector>
+
+#include <algorithm>
+#include <limits>
+
+QVector2D AGLShapeValues::unfilteredRange() {
+    return QVector2D(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::max());
+}
+
+void AGLShapeValues::assign(const std::vector<float> &shapeValues,
+                            const std::vector<uint32_t> &shapeVertexCounts) {
+    clear();
+    if (shapeValues.size() != shapeVertexCounts.size())
+        return;
+    for (uint32_t count : shapeVertexCounts) {
+        m_vertexCount += static_cast<qsizetype>(count);
+    }
+    m_values = shapeValues;
+    m_shapeVertexCounts = shapeVertexCounts;
+}
+
+template <typename T> void AGLShapeValues::allocateExpanded() {
+    // the shaders read the values per vertex, so they are only repeated for the upload
+    std::vector<T> expanded(static_cast<size_t>(m_vertexCount));
+    T *value = expanded.data();
+    for (size_t shape = 0; shape < m_values.size(); ++shape) {
+        value = std::fill_n(value, m_shapeVertexCounts[shape], static_cast<T>(m_values[shape]));
+    }
+    m_vbo.allocate(expanded.data(), static_cast<int>(expanded.size() * sizeof(T)));
+}
+
+void AGLShapeValues::setupVertexAttrib() {
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    if (m_values.empty()) {
+        f->glDisableVertexAttribArray(m_location);
+        return;
+    }
+    m_vbo.bind();
+    f->glEnableVertexAttribArray(m_location);
+    if (m_type == Type::FLAG) {
+        // not normalised, the shaders read 0 or 1
+        f->glVertexAttribPointer(m_location, 1, GL_UNSIGNED_BYTE, GL_FALSE,
+                                 static_cast<GLsizei>(sizeof(GLubyte)), 0);
+    } else {
+        f->glVertexAttribPointer(m_location, 1, GL_FLOAT, GL_FALSE,
+                                 static_cast<GLsizei>(sizeof(GLfloat)), 0);
+    }
+    m_vbo.release();
+}
+
+void AGLShapeValues::initializeGL() {
+    m_vbo.create();
+    updateGL();
+}
+
+void AGLShapeValues::updateGL() {
+    if (!m_vbo.isCreated())
+        return;
+    m_vbo.bind();
+    if (m_type == Type::FLAG)
+        allocateExpanded<GLubyte>();
+    else
+        allocateExpanded<GLfloat>();
+    m_vbo.release();
+    setupVertexAttrib();
+}
+
+void AGLShapeValues::cleanup() { m_vbo.destroy(); }
+
+void AGLShapeValues::bindForPaint() {
+    if (!m_values.empty())
+        return;
+    QOpenGLContext::currentContext()->functions()->glVertexAttrib1f(m_location, 0.0f);
+}
+
+bool AGLShapeValues::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    QVector<GLfloat> values;
+    QVector<uint32_t> shapeVertexCounts;
+    if (!cache.read(key + ".values", values) ||
+        !cache.read(key + ".valueCounts", shapeVertexCounts) ||
+        values.size() != shapeVertexCounts.size())
+        return false;
+    assign(std::vector<float>(values.begin(), values.end()),
+           std::vector<uint32_t>(shapeVertexCounts.begin(), shapeVertexCounts.end()));
+    return true;
+}
+
+void AGLShapeValues::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    cache.write(key + ".values", m_values.data(), static_cast<qsizetype>(m_values.size()));
+    cache.write(key + ".valueCounts", m_shapeVertexCounts.data(),
+                static_cast<qsizetype>(m_shapeVertexCounts.size()));
+}
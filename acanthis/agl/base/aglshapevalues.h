@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "../func/aglvertexbuffercache.h"
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QVector2D>
+
+#include <vector>
+
+/**
+ * @brief One value per shape of an object, repeated for each vertex of the shape only in the
+ * buffer next to the vertex data. The shaders use them to change how whole shapes are drawn
+ * without touching the vertices: filter values move the shapes outside the filter range out
+ * of the clip volume, selection flags switch shapes to the selection colour. Flags are
+ * uploaded as bytes, values as floats. The objects always record filter values (0 when not
+ * given) as they also tell how many vertices each shape has. Objects without values read 0.
+ */
+class AGLShapeValues {
+  public:
+    static const GLuint FILTER_LOCATION = 2;
+    static const GLuint SELECTION_LOCATION = 3;
+
+    enum class Type { VALUE, FLAG };
+
+    /** @brief The filter range that lets everything through, including "no value" (-1) */
+    static QVector2D unfilteredRange();
+
+    explicit AGLShapeValues(GLuint location, Type type = Type::VALUE)
+        : m_location(location), m_type(type) {}
+
+    void clear() {
+        m_values.clear();
+        m_shapeVertexCounts.clear();
+        m_vertexCount = 0;
+    }
+    void reserve(size_t shapeCount) {
+        m_values.reserve(shapeCount);
+        m_shapeVertexCounts.reserve(shapeCount);
+    }
+    /** @brief Adds the value of a shape with count vertices */
+    void append(float value, size_t count) {
+        m_values.push_back(value);
+        m_shapeVertexCounts.push_back(static_cast<uint32_t>(count));
+        m_vertexCount += static_cast<qsizetype>(count);
+    }
+    /** @brief Replaces all values, shapeVertexCounts as given by another set of values */
+    void assign(const std::vector<float> &shapeValues,
+                const std::vector<uint32_t> &shapeVertexCounts);
+    bool isEmpty() const { return m_values.empty(); }
+    size_t shapeCount() const { return m_shapeVertexCounts.size(); }
+    /** @brief Vertices of all the shapes together */
+    qsizetype vertexCount() const { return m_vertexCount; }
+    const std::vector<uint32_t> &getShapeVertexCounts() const { return m_shapeVertexCounts; }
+
+    /** @brief Creates and fills the buffer, the vertex array object must be bound */
+    void initializeGL();
+    /** @brief Refills the buffer, the vertex array object must be bound */
+    void updateGL();
+    void cleanup();
+    /** @brief Sets the constant value used when there is no buffer, call before drawing */
+    void bindForPaint();
+
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
+
+  private:
+    template <typename T> void allocateExpanded();
+    void setupVertexAttrib();
+
+    GLuint m_location;
+    Type m_type;
+    std::vector<GLfloat> m_values;
+    std::vector<uint32_t> m_shapeVertexCounts;
+    qsizetype m_vertexCount = 0;
+    QOpenGLBuffer m_vbo;
+};
@@ -0,0 +1,332 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "agltilepyramid.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include <algorithm>
+#include <cmath>
+
+static const char *vertexShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec2 vertex;\n"
+    "out vec2 texc;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform vec4 tileRegion;\n"
+    "void main() {\n"
+    "   gl_Position = projMatrix * mvMatrix * vec4(mix(tileRegion.xy, tileRegion.zw, vertex),"
+    " 0.0, 1.0);\n"
+    "   texc = vertex;\n"
+    "}\n";
+
+static const char *fragmentShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "uniform sampler2D tile;\n"
+    "in vec2 texc;\n"
+    "out highp vec4 fragColor;\n"
+    "void main() {\n"
+    "   fragColor = texture(tile, texc);\n"
+    "}\n";
+
+static const char *vertexShaderSource = // auto-format hack
+    "attribute highp vec2 vertex;\n"
+    "varying mediump vec2 texc;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform highp vec4 tileRegion;\n"
+    "void main() {\n"
+    "   gl_Position = projMatrix * mvMatrix * vec4(mix(tileRegion.xy, tileRegion.zw, vertex),"
+    " 0.0, 1.0);\n"
+    "   texc = vertex;\n"
+    "}\n";
+
+static const char *fragmentShaderSource = // auto-format hack
+    "uniform sampler2D tile;\n"
+    "varying mediump vec2 texc;\n"
+    "void main() {\n"
+    "   gl_FragColor = texture2D(tile, texc);\n"
+    "}\n";
+
+AGLTilePyramid::AGLTilePyramid(Rasteriser rasteriser) : m_rasteriser(std::move(rasteriser)) {
+    // leave most of the cores to the rest of the application
+    m_threadPool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+}
+
+AGLTilePyramid::~AGLTilePyramid() {
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+}
+
+void AGLTilePyramid::stop() {
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+    m_requested.clear();
+    // paintGL draws (and asks for) nothing until the next reset
+    m_rootSize = 0;
+}
+
+void AGLTilePyramid::reset(const QtRegion &bounds, const Point2f &origin,
+                           const QString &diskDirectory) {
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+    {
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        m_finished.clear();
+    }
+    m_requested.clear();
+    m_gpuTiles.clear();
+    m_lru.clear();
+    m_bounds = bounds;
+    m_origin = origin;
+    m_rootSize = std::max(bounds.width(), bounds.height());
+    m_diskDirectory = diskDirectory;
+    if (!diskDirectory.isEmpty())
+        m_threadPool.start([diskDirectory]() { pruneDisk(diskDirectory); });
+}
+
+void AGLTilePyramid::pruneDisk(const QString &diskDirectory) {
+    // the time of a marker file rather than of the directory, which only changes when a
+    // tile is added
+    static const QString usedMarker = ".used";
+    QDir().mkpath(diskDirectory);
+    QFile marker(diskDirectory + "/" + usedMarker);
+    if (marker.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        marker.close();
+
+    QDir parent(diskDirectory);
+    if (!parent.cdUp())
+        return;
+    QString current = QDir(diskDirectory).canonicalPath();
+    struct Sibling {
+        QDateTime used;
+        QString path;
+        qint64 bytes;
+    };
+    std::vector<Sibling> siblings;
+    qint64 totalBytes = 0;
+    for (const QFileInfo &directory : parent.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        Sibling sibling{QFileInfo(directory.filePath() + "/" + usedMarker).lastModified(),
+                        directory.canonicalFilePath(), 0};
+        if (!sibling.used.isValid())
+            sibling.used = directory.lastModified();
+        QDirIterator files(sibling.path, QDir::Files, QDirIterator::Subdirectories);
+        while (files.hasNext()) {
+            files.next();
+            sibling.bytes += files.fileInfo().size();
+        }
+        totalBytes += sibling.bytes;
+        siblings.push_back(sibling);
+    }
+    std::sort(siblings.begin(), siblings.end(),
+              [](const Sibling &a, const Sibling &b) { return a.used < b.used; });
+    for (const Sibling &sibling : siblings) {
+        if (totalBytes <= MAX_DISK_BYTES)
+            break;
+        if (sibling.path == current)
+            continue;
+        QDir(sibling.path).removeRecursively();
+        totalBytes -= sibling.bytes;
+    }
+}
+
+QtRegion AGLTilePyramid::tileRegion(int level, int x, int y) const {
+    double tileSize = m_rootSize / static_cast<double>(1 << level);
+    QtRegion region;
+    region.bottom_left = Point2f(m_bounds.bottom_left.x + x * tileSize,
+                                 m_bounds.bottom_left.y + y * tileSize);
+    region.top_right = Point2f(region.bottom_left.x + tileSize, region.bottom_left.y + tileSize);
+    return region;
+}
+
+QImage AGLTilePyramid::makeTile(int level, int x, int y, const QString &diskDirectory) const {
+    QString filename;
+    if (!diskDirectory.isEmpty()) {
+        filename = diskDirectory + QString("/%1/%2_%3.png").arg(level).arg(x).arg(y);
+        QImage image(filename);
+        if (!image.isNull())
+            return image;
+    }
+
+    QImage image(TILE_SIZE, TILE_SIZE, QImage::Format_RGBA8888_Premultiplied);
+    image.fill(Qt::transparent);
+    QtRegion region = tileRegion(level, x, y);
+    bool drawn;
+    {
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        // world to image, the first row of the image is the bottom of the tile as that is the
+        // first row of the texture
+        double scale = TILE_SIZE / region.width();
+        painter.scale(scale, scale);
+        painter.translate(-region.bottom_left.x, -region.bottom_left.y);
+        drawn = m_rasteriser(painter, region);
+    }
+    if (!drawn)
+        return QImage();
+    if (!filename.isEmpty()) {
+        QDir().mkpath(diskDirectory + "/" + QString::number(level));
+        image.save(filename);
+    }
+    return image;
+}
+
+void AGLTilePyramid::requestTile(int level, int x, int y) {
+    uint64_t key = tileKey(level, x, y);
+    if (!m_requested.insert(key).second)
+        return;
+    QString diskDirectory = m_diskDirectory;
+    m_threadPool.start([this, key, level, x, y, diskDirectory]() {
+        QImage image = makeTile(level, x, y, diskDirectory);
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        m_finished.push_back(FinishedTile{key, std::move(image)});
+    });
+}
+
+void AGLTilePyramid::initializeGL(bool core) {
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex,
+                                       core ? vertexShaderSourceCore : vertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                       core ? fragmentShaderSourceCore : fragmentShaderSource);
+    m_program->bindAttributeLocation("vertex", 0);
+    m_program->link();
+
+    m_program->bind();
+    m_projMatrixLoc = m_program->uniformLocation("projMatrix");
+    m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+    m_tileRegionLoc = m_program->uniformLocation("tileRegion");
+    m_textureSamplerLoc = m_program->uniformLocation("tile");
+    m_program->setUniformValue(m_textureSamplerLoc, 0);
+
+    m_vao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    // a unit square, stretched over each tile in the vertex shader
+    const GLfloat vertices[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+    m_vbo.create();
+    m_vbo.bind();
+    m_vbo.allocate(vertices, static_cast<int>(sizeof(vertices)));
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glEnableVertexAttribArray(0);
+    f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    m_vbo.release();
+
+    m_program->release();
+}
+
+void AGLTilePyramid::updateGL() {
+    std::vector<FinishedTile> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        finished.swap(m_finished);
+    }
+    for (FinishedTile &tile : finished) {
+        m_requested.erase(tile.key);
+        GPUTile &gpuTile = m_gpuTiles[tile.key];
+        if (!tile.image.isNull()) {
+            gpuTile.texture = std::make_unique<QOpenGLTexture>(tile.image);
+            gpuTile.texture->setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
+            gpuTile.texture->setMagnificationFilter(QOpenGLTexture::Linear);
+            gpuTile.texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+        }
+        m_lru.push_front(tile.key);
+        gpuTile.lruPosition = m_lru.begin();
+    }
+    while (m_gpuTiles.size() > GPU_TILE_CAPACITY) {
+        m_gpuTiles.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+}
+
+void AGLTilePyramid::cleanup() {
+    m_gpuTiles.clear();
+    m_lru.clear();
+    m_requested.clear();
+    if (m_program == nullptr)
+        return;
+    m_vbo.destroy();
+    delete m_program;
+    m_program = nullptr;
+}
+
+bool AGLTilePyramid::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                             const QMatrix4x4 &mModel) {
+    if (m_program == nullptr || m_rootSize <= 0)
+        return false;
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    QMatrix4x4 mvp = mProj * mView * mModel;
+    GLint viewport[4];
+    f->glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // the level at which a tile pixel is no bigger than a framebuffer pixel
+    double pixelsPerUnit = std::abs(mvp(1, 1)) * viewport[3] * 0.5;
+    int level = std::max(
+        0, static_cast<int>(std::ceil(std::log2(m_rootSize * pixelsPerUnit / TILE_SIZE))));
+    if (level > MAX_LEVEL)
+        return false;
+
+    // the region in view relative to the origin, from the corners of the clip volume
+    QMatrix4x4 inverse = mvp.inverted();
+    QVector3D corner0 = inverse.map(QVector3D(-1.0f, -1.0f, 0.0f));
+    QVector3D corner1 = inverse.map(QVector3D(1.0f, 1.0f, 0.0f));
+    int tileCount = 1 << level;
+    double tileSize = m_rootSize / tileCount;
+    auto tileIndex = [&](double local, double start) {
+        return std::clamp(static_cast<int>(std::floor((local - start) / tileSize)), 0,
+                          tileCount - 1);
+    };
+    double startX = m_bounds.bottom_left.x - m_origin.x;
+    double startY = m_bounds.bottom_left.y - m_origin.y;
+    int minX = tileIndex(std::min(corner0.x(), corner1.x()), startX);
+    int maxX = tileIndex(std::max(corner0.x(), corner1.x()), startX);
+    int minY = tileIndex(std::min(corner0.y(), corner1.y()), startY);
+    int maxY = tileIndex(std::max(corner0.y(), corner1.y()), startY);
+    if ((maxX - minX + 1) * (maxY - minY + 1) > MAX_VISIBLE_TILES)
+        return false;
+
+    std::vector<const GPUTile *> tiles;
+    std::vector<QtRegion> regions;
+    bool complete = true;
+    for (int x = minX; x <= maxX; ++x) {
+        for (int y = minY; y <= maxY; ++y) {
+            auto gpuTile = m_gpuTiles.find(tileKey(level, x, y));
+            if (gpuTile == m_gpuTiles.end()) {
+                requestTile(level, x, y);
+                complete = false;
+                continue;
+            }
+            m_lru.splice(m_lru.begin(), m_lru, gpuTile->second.lruPosition);
+            if (gpuTile->second.texture) {
+                tiles.push_back(&gpuTile->second);
+                regions.push_back(tileRegion(level, x, y));
+            }
+        }
+    }
+    if (!complete)
+        return false;
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_projMatrixLoc, mProj);
+    m_program->setUniformValue(m_mvMatrixLoc, mView * mModel);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        const QtRegion &region = regions[i];
+        m_program->setUniformValue(
+            m_tileRegionLoc, QVector4D(static_cast<float>(region.bottom_left.x - m_origin.x),
+                                       static_cast<float>(region.bottom_left.y - m_origin.y),
+                                       static_cast<float>(region.top_right.x - m_origin.x),
+                                       static_cast<float>(region.top_right.y - m_origin.y)));
+        tiles[i]->texture->bind(0);
+        f->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        tiles[i]->texture->release(0);
+    }
+    m_program->release();
+    return true;
+}
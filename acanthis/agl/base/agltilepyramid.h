@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "genlib/p2dpoly.h"
+
+#include <QImage>
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+#include <QPainter>
+#include <QThread>
+#include <QThreadPool>
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A layer drawn into a quadtree of raster tiles in the background, for views zoomed
+ * out far enough that drawing the geometry costs more than drawing a few textures. Level 0
+ * is one tile over the (squared) bounds of the layer and each level splits the tiles of the
+ * one above in four. Tiles are kept on the GPU up to GPU_TILE_CAPACITY, the least recently
+ * drawn going first, and on disk as PNG files when given a directory. Tiles of other looks
+ * of the layer go in sibling directories, which are removed the least recently used first
+ * once together they are over MAX_DISK_BYTES.
+ *
+ * A view is only drawn from tiles once all the tiles it needs at its level are on the GPU,
+ * until then (and when zoomed in beyond MAX_LEVEL) the owner draws the geometry instead.
+ */
+class AGLTilePyramid {
+  public:
+    static const int TILE_SIZE = 256;
+    static const int MAX_LEVEL = 12;
+    static const size_t GPU_TILE_CAPACITY = 256;
+    // views that would need more tiles than this are drawn from the geometry
+    static const int MAX_VISIBLE_TILES = 64;
+    static const qint64 MAX_DISK_BYTES = 128 * 1024 * 1024;
+
+    /**
+     * @brief Draws the part of the layer in the region with the painter, which is set up to
+     * take world coordinates. Called from the background threads. Returns false if nothing
+     * was drawn.
+     */
+    using Rasteriser = std::function<bool(QPainter &painter, const QtRegion &region)>;
+
+    explicit AGLTilePyramid(Rasteriser rasteriser);
+    ~AGLTilePyramid();
+
+    /**
+     * @brief Drops all tiles, for when what the layer looks like has changed. Waits for the
+     * tiles being made, so the rasteriser may change what it draws from after this returns.
+     * Tiles are read from and written to diskDirectory, unless empty. The matrices given to
+     * paintGL are those of vertices relative to origin, as the layer's.
+     */
+    void reset(const QtRegion &bounds, const Point2f &origin, const QString &diskDirectory);
+    /**
+     * @brief Drops the tiles not yet started and waits for the ones being made, for before
+     * what the rasteriser draws from goes away. Only reset() asks for tiles again
+     */
+    void stop();
+
+    void initializeGL(bool core);
+    /** @brief Uploads the tiles finished since the last call */
+    void updateGL();
+    void cleanup();
+    /** @brief Draws the view from tiles, returns false if the geometry has to be drawn */
+    bool paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView, const QMatrix4x4 &mModel);
+    /** @brief Whether tiles are being made, to keep drawing until they are in */
+    bool hasPendingTiles() const { return !m_requested.empty(); }
+
+    AGLTilePyramid(const AGLTilePyramid &) = delete;
+    AGLTilePyramid &operator=(const AGLTilePyramid &) = delete;
+
+  private:
+    struct GPUTile {
+        // null for tiles with nothing in them
+        std::unique_ptr<QOpenGLTexture> texture;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+    struct FinishedTile {
+        uint64_t key;
+        QImage image;
+    };
+
+    static uint64_t tileKey(int level, int x, int y) {
+        return (static_cast<uint64_t>(level) << 48) | (static_cast<uint64_t>(x) << 24) |
+               static_cast<uint64_t>(y);
+    }
+    QtRegion tileRegion(int level, int x, int y) const;
+    void requestTile(int level, int x, int y);
+    QImage makeTile(int level, int x, int y, const QString &diskDirectory) const;
+    /** @brief Marks the directory as used and removes its least recently used siblings */
+    static void pruneDisk(const QString &diskDirectory);
+
+    Rasteriser m_rasteriser;
+    QThreadPool m_threadPool;
+    QtRegion m_bounds;
+    Point2f m_origin;
+    double m_rootSize = 0;
+    QString m_diskDirectory;
+
+    // render thread only
+    std::set<uint64_t> m_requested;
+    std::unordered_map<uint64_t, GPUTile> m_gpuTiles;
+    std::list<uint64_t> m_lru;
+
+    std::mutex m_finishedMutex;
+    std::vector<FinishedTile> m_finished;
+
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vbo;
+    QOpenGLShaderProgram *m_program = nullptr;
+    int m_projMatrixLoc;
+    int m_mvMatrixLoc;
+    int m_tileRegionLoc;
+    int m_textureSamplerLoc;
+};
@@ -10,29 +10,44 @@
 static const char *vertexShaderSourceCore = // auto-format hack
         "#version 150\n"
         "in vec4 vertex;\n"
+        "in vec4 colour;\n"
+        "in float filterValue;\n"
+        "in float selected;\n"
+        "out vec4 fragColour;\n"
         "uniform mat4 projMatrix;\n"
         "uniform mat4 mvMatrix;\n"
+        "uniform vec2 filterRange;\n"
+        "uniform vec4 selectionColour;\n"
         "void main() {\n"
         "   gl_Position = projMatrix * mvMatrix * vertex;\n"
+        "   if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+        "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+        "   fragColour = selected > 0.5 ? selectionColour : colour;\n"
         "}\n";
 
 static const char *fragmentShaderSourceCore = // auto-format hack
         "#version 150\n"
-        "in vec4 colour;\n"
+        "in vec4 fragColour;\n"
         "out highp vec4 fragColor;\n"
         "void main() {\n"
-        "   fragColor = colour;\n"
+        "   fragColor = fragColour;\n"
         "}\n";
 
 static const char *vertexShaderSource = // auto-format hack
         "attribute vec4 vertex;\n"
         "attribute vec4 colour;\n"
+        "attribute float filterValue;\n"
+        "attribute float selected;\n"
         "varying vec4 fragColour;\n"
         "uniform mat4 projMatrix;\n"
         "uniform mat4 mvMatrix;\n"
+        "uniform vec2 filterRange;\n"
+        "uniform vec4 selectionColour;\n"
         "void main() {\n"
         "   gl_Position = projMatrix * mvMatrix * vertex;\n"
-        "   fragColour = colour;\n"
+        "   if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+        "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+        "   fragColour = selected > 0.5 ? selectionColour : colour;\n"
         "}\n";
 
 static const char *fragmentShaderSource = // auto-format hack
@@ -45,29 +60,23 @@ static const char *fragmentShaderSource = // auto-format hack
 void AGLTriangles::loadTriangleData(
     const std::vector<std::pair<std::vector<Point2f>, QRgb>> &triangleData) {
 
-    init(static_cast<int>(triangleData.size()));
+    size_t vertexCount = 0;
+    for (auto &triangle : triangleData) {
+        vertexCount += triangle.first.size();
+    }
+    init(static_cast<int>(vertexCount));
 
     for (auto &triangle : triangleData) {
-        float r = static_cast<float>(qRed(triangle.second)) / 255.0f;
-        float g = static_cast<float>(qGreen(triangle.second)) / 255.0f;
-        float b = static_cast<float>(qBlue(triangle.second)) / 255.0f;
         for (auto &point : triangle.first) {
-            add(QVector3D(static_cast<float>(point.x), static_cast<float>(point.y), 0.0f),
-                QVector3D(r, g, b));
+            add(point, triangle.second);
         }
+        addFilterValue(0.0f, triangle.first.size());
     }
 }
 
 void AGLTriangles::setupVertexAttribs() {
     m_vbo.bind();
-    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
-    f->glEnableVertexAttribArray(0);
-    f->glEnableVertexAttribArray(1);
-    f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-                             DATA_DIMENSIONS * static_cast<GLsizei>(sizeof(GLfloat)), 0);
-    f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-                             DATA_DIMENSIONS * static_cast<GLsizei>(sizeof(GLfloat)),
-                             (void *)(3 * sizeof(GLfloat)));
+    AGLColouredVertex::setupVertexAttribs(QOpenGLContext::currentContext()->functions());
     m_vbo.release();
 }
 
@@ -81,20 +90,26 @@ void AGLTriangles::initializeGL(bool m_core) {
                                        m_core ? fragmentShaderSourceCore : fragmentShaderSource);
     m_program->bindAttributeLocation("vertex", 0);
     m_program->bindAttributeLocation("colour", 1);
+    m_program->bindAttributeLocation("filterValue", AGLShapeValues::FILTER_LOCATION);
+    m_program->bindAttributeLocation("selected", AGLShapeValues::SELECTION_LOCATION);
     m_program->link();
 
     m_program->bind();
     m_projMatrixLoc = m_program->uniformLocation("projMatrix");
     m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+    m_filterRangeLoc = m_program->uniformLocation("filterRange");
+    m_selectionColourLoc = m_program->uniformLocation("selectionColour");
 
     m_vao.create();
     QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
 
     m_vbo.create();
     m_vbo.bind();
-    m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(GLfloat)));
+    m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(AGLColouredVertex)));
 
     setupVertexAttribs();
+    m_filterValues.initializeGL();
+    m_selectionFlags.initializeGL();
     m_program->release();
     m_built = true;
 }
@@ -104,17 +119,29 @@ void AGLTriangles::updateGL(bool m_core) {
         // has not been initialised yet, do that instead
         initializeGL(m_core);
     } else {
+        QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
         m_vbo.bind();
-        m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(GLfloat)));
+        m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(AGLColouredVertex)));
         m_vbo.release();
+        m_filterValues.updateGL();
+        m_selectionFlags.updateGL();
         m_built = true;
     }
 }
 
+void AGLTriangles::updateSelectionGL() {
+    if (m_program == 0)
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_selectionFlags.updateGL();
+}
+
 void AGLTriangles::cleanup() {
     if (!m_built)
         return;
     m_vbo.destroy();
+    m_filterValues.cleanup();
+    m_selectionFlags.cleanup();
     delete m_program;
     m_program = 0;
 }
@@ -127,6 +154,10 @@ void AGLTriangles::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &m_mView,
     m_program->bind();
     m_program->setUniformValue(m_projMatrixLoc, mProj);
     m_program->setUniformValue(m_mvMatrixLoc, m_mView * m_mModel);
+    m_program->setUniformValue(m_filterRangeLoc, m_filterRange);
+    m_program->setUniformValue(m_selectionColourLoc, m_selectionColour);
+    m_filterValues.bindForPaint();
+    m_selectionFlags.bindForPaint();
 
     QOpenGLFunctions *glFuncs = QOpenGLContext::currentContext()->functions();
     glFuncs->glDrawArrays(GL_TRIANGLES, 0, vertexCount());
@@ -134,13 +165,22 @@ void AGLTriangles::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &m_mView,
     m_program->release();
 }
 
-void AGLTriangles::add(const QVector3D &v, const QVector3D &c) {
-    GLfloat *p = m_data.data() + m_count;
-    *p++ = v.x();
-    *p++ = v.y();
-    *p++ = v.z();
-    *p++ = c.x();
-    *p++ = c.y();
-    *p++ = c.z();
-    m_count += DATA_DIMENSIONS;
+void AGLTriangles::add(const Point2f &v, const QRgb &c) {
+    m_data[m_count] = AGLColouredVertex(localX(v.x), localY(v.y), c);
+    m_count++;
+}
+
+bool AGLTriangles::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    if (!cache.read(key, m_data) || !m_filterValues.loadFromCache(cache, key) ||
+        m_filterValues.vertexCount() != m_data.size())
+        return false;
+    m_built = false;
+    m_selectionFlags.clear();
+    m_count = static_cast<int>(m_data.size());
+    return true;
+}
+
+void AGLTriangles::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    cache.write(key, m_data.constData(), m_count);
+    m_filterValues.storeToCache(cache, key);
 }
@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include "aglshapevalues.h"
 #include "aglobject.h"
+#include "aglvertex.h"
+
+#include "../func/aglvertexbuffercache.h"
 
 #include "genlib/p2dpoly.h"
 
@@ -13,7 +17,7 @@
 #include <QOpenGLShaderProgram>
 #include <QOpenGLVertexArrayObject>
 #include <QRgb>
-#include <QVector3D>
+#include <QVector4D>
 #include <QVector>
 
 /**
@@ -30,24 +34,41 @@ class AGLTriangles : public AGLObject {
     void updateGL(bool m_core) override;
     void cleanup() override;
     void updateColour(const QRgb &polyColour);
-    int vertexCount() const { return m_count / DATA_DIMENSIONS; }
+    int vertexCount() const { return m_count; }
+    void setFilterRange(const QVector2D &filterRange) { m_filterRange = filterRange; }
+    /** @brief One flag per shape in the order they were added, 1 draws it as selected */
+    void setSelectedShapes(const std::vector<float> &flags) {
+        m_selectionFlags.assign(flags, m_filterValues.getShapeVertexCounts());
+    }
+    /** @brief Uploads the selection flags alone, the vertices are left as they are */
+    void updateSelectionGL();
+    size_t shapeCount() const { return m_filterValues.shapeCount(); }
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
     AGLTriangles(const AGLTriangles &) = delete;
     AGLTriangles &operator=(const AGLTriangles &) = delete;
 
   protected:
-    void init(int numTriangles) {
+    void init(int numVertices) {
         m_built = false;
         m_count = 0;
-        m_data.resize(numTriangles * 3 * DATA_DIMENSIONS);
+        m_data.resize(numVertices);
+        m_filterValues.clear();
     }
-    void add(const QVector3D &v, const QVector3D &c);
+    void add(const Point2f &v, const QRgb &c);
+    /** @brief The filter value of the last count vertices added */
+    void addFilterValue(float value, size_t count) { m_filterValues.append(value, count); }
 
   private:
-    const int DATA_DIMENSIONS = 6;
     void setupVertexAttribs();
-    const GLfloat *constData() const { return m_data.constData(); }
+    const AGLColouredVertex *constData() const { return m_data.constData(); }
 
-    QVector<GLfloat> m_data;
+    QVector<AGLColouredVertex> m_data;
+    AGLShapeValues m_filterValues{AGLShapeValues::FILTER_LOCATION};
+    AGLShapeValues m_selectionFlags{AGLShapeValues::SELECTION_LOCATION,
+                                    AGLShapeValues::Type::FLAG};
+    QVector2D m_filterRange = AGLShapeValues::unfilteredRange();
+    QVector4D m_selectionColour = QVector4D(1.0f, 1.0f, 0.0f, 1.0f);
     int m_count;
     bool m_built = false;
     QVector4D m_colour = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
@@ -57,4 +78,6 @@ class AGLTriangles : public AGLObject {
     QOpenGLShaderProgram *m_program;
     int m_projMatrixLoc;
     int m_mvMatrixLoc;
+    int m_filterRangeLoc;
+    int m_selectionColourLoc;
 };
@@ -4,6 +4,7 @@
 
 #include "agltrianglesuniform.h"
 
+#include <algorithm>
 #include <math.h>
 
 static const char *vertexShaderSourceCore = // auto-format hack
@@ -49,16 +50,25 @@ void AGLTrianglesUniform::loadTriangleData(const std::vector<Point2f> &points,
     m_built = false;
 
     m_count = 0;
+    m_indices.clear();
     m_data.resize(static_cast<qsizetype>(points.size() * static_cast<size_t>(DATA_DIMENSIONS)));
 
     for (auto &point : points) {
-        add(QVector3D(static_cast<float>(point.x), static_cast<float>(point.y), 0.0f));
+        add(QVector3D(localX(point.x), localY(point.y), 0.0f));
     }
     m_colour.setX(static_cast<float>(qRed(polyColour)) / 255.0f);
     m_colour.setY(static_cast<float>(qGreen(polyColour)) / 255.0f);
     m_colour.setZ(static_cast<float>(qBlue(polyColour)) / 255.0f);
 }
 
+void AGLTrianglesUniform::loadTriangleData(const std::vector<Point2f> &points,
+                                           const std::vector<unsigned int> &indices,
+                                           const QRgb &polyColour) {
+    loadTriangleData(points, polyColour);
+    m_indices.resize(static_cast<qsizetype>(indices.size()));
+    std::copy(indices.begin(), indices.end(), m_indices.begin());
+}
+
 void AGLTrianglesUniform::setupVertexAttribs() {
     m_vbo.bind();
     QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
@@ -92,6 +102,14 @@ void AGLTrianglesUniform::initializeGL(bool core) {
     m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(GLfloat)));
 
     setupVertexAttribs();
+
+    if (!m_indices.isEmpty()) {
+        m_ibo.create();
+        m_ibo.bind();
+        m_ibo.allocate(m_indices.constData(),
+                       static_cast<int>(m_indices.size() * static_cast<qsizetype>(sizeof(GLuint))));
+    }
+
     m_program->setUniformValue(m_colourVectorLoc, m_colour);
     m_program->release();
     m_built = true;
@@ -105,6 +123,15 @@ void AGLTrianglesUniform::updateGL(bool m_core) {
         m_vbo.bind();
         m_vbo.allocate(constData(), m_count * static_cast<GLsizei>(sizeof(GLfloat)));
         m_vbo.release();
+        if (!m_indices.isEmpty()) {
+            if (!m_ibo.isCreated())
+                m_ibo.create();
+            m_ibo.bind();
+            m_ibo.allocate(
+                m_indices.constData(),
+                static_cast<int>(m_indices.size() * static_cast<qsizetype>(sizeof(GLuint))));
+            m_ibo.release();
+        }
         m_built = true;
     }
 }
@@ -122,6 +149,7 @@ void AGLTrianglesUniform::cleanup() {
     if (!m_built)
         return;
     m_vbo.destroy();
+    m_ibo.destroy();
     delete m_program;
     m_program = 0;
 }
@@ -134,9 +162,18 @@ void AGLTrianglesUniform::paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mVi
     m_program->bind();
     m_program->setUniformValue(m_projMatrixLoc, mProj);
     m_program->setUniformValue(m_mvMatrixLoc, mView * mModel);
+    m_program->setUniformValue(
+        m_colourVectorLoc, QVector4D(m_colour.toVector3D(), m_colour.w() * m_opacity));
 
     QOpenGLFunctions *glFuncs = QOpenGLContext::currentContext()->functions();
-    glFuncs->glDrawArrays(GL_TRIANGLES, 0, vertexCount());
+    if (m_indices.isEmpty()) {
+        glFuncs->glDrawArrays(GL_TRIANGLES, 0, vertexCount());
+    } else {
+        m_ibo.bind();
+        glFuncs->glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()),
+                                GL_UNSIGNED_INT, 0);
+        m_ibo.release();
+    }
 
     m_program->release();
 }
@@ -148,3 +185,22 @@ void AGLTrianglesUniform::add(const QVector3D &v) {
     *p++ = v.z();
     m_count += DATA_DIMENSIONS;
 }
+
+bool AGLTrianglesUniform::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    QVector<GLfloat> colour;
+    if (!cache.read(key + ".colour", colour) || colour.size() != 4 ||
+        !cache.read(key + ".indices", m_indices) || !cache.read(key, m_data) ||
+        !AGLVertexBufferCache::indicesInRange(m_indices, m_data.size()))
+        return false;
+    m_built = false;
+    m_count = static_cast<int>(m_data.size());
+    m_colour = QVector4D(colour[0], colour[1], colour[2], colour[3]);
+    return true;
+}
+
+void AGLTrianglesUniform::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    const GLfloat colour[4] = {m_colour.x(), m_colour.y(), m_colour.z(), m_colour.w()};
+    cache.write(key + ".colour", colour, 4);
+    cache.write(key + ".indices", m_indices.constData(), m_indices.size());
+    cache.write(key, m_data.constData(), m_count);
+}
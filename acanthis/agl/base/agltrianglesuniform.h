@@ -6,6 +6,8 @@
 
 #include "aglobject.h"
 
+#include "../func/aglvertexbuffercache.h"
+
 #include "genlib/p2dpoly.h"
 
 #include <QOpenGLBuffer>
@@ -17,20 +19,27 @@
 #include <QVector>
 
 /**
- * @brief General triangles representation. All same colour
+ * @brief General triangles representation. All same colour. If indices are provided the
+ * triangles are drawn through an index buffer over the (unique) points
  */
 
 class AGLTrianglesUniform : public AGLObject {
   public:
     AGLTrianglesUniform();
     void loadTriangleData(const std::vector<Point2f> &points, const QRgb &polyColour);
+    void loadTriangleData(const std::vector<Point2f> &points,
+                          const std::vector<unsigned int> &indices, const QRgb &polyColour);
     void paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
                  const QMatrix4x4 &mModel) override;
     void initializeGL(bool core) override;
     void updateGL(bool core) override;
     void cleanup() override;
     void updateColour(const QRgb &polyColour);
+    /** @brief Scales the alpha of the colour when drawing, to fade the object in and out */
+    void setOpacity(float opacity) { m_opacity = opacity; }
     int vertexCount() const { return m_count / DATA_DIMENSIONS; }
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
     AGLTrianglesUniform(const AGLTrianglesUniform &) = delete;
     AGLTrianglesUniform &operator=(const AGLTrianglesUniform &) = delete;
 
@@ -41,12 +50,15 @@ class AGLTrianglesUniform : public AGLObject {
     void add(const QVector3D &v);
 
     QVector<GLfloat> m_data;
+    QVector<GLuint> m_indices;
     int m_count;
     bool m_built = false;
     QVector4D m_colour = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+    float m_opacity = 1.0f;
 
     QOpenGLVertexArrayObject m_vao;
     QOpenGLBuffer m_vbo;
+    QOpenGLBuffer m_ibo = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
     QOpenGLShaderProgram *m_program;
     int m_projMatrixLoc;
     int m_mvMatrixLoc;
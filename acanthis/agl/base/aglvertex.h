@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QOpenGLFunctions>
+#include <QRgb>
+
+/**
+ * @brief Packed vertex with a 2D position and a normalised RGBA8 colour (12 bytes).
+ * The z coordinate is always zero for map data so it is not stored, the shaders read the
+ * position as a vec4 and get z = 0, w = 1 filled in.
+ */
+struct AGLColouredVertex {
+    GLfloat x, y;
+    GLubyte r, g, b, a;
+
+    AGLColouredVertex() = default;
+    AGLColouredVertex(GLfloat vx, GLfloat vy, const QRgb &colour)
+        : x(vx), y(vy), r(static_cast<GLubyte>(qRed(colour))),
+          g(static_cast<GLubyte>(qGreen(colour))), b(static_cast<GLubyte>(qBlue(colour))),
+          a(static_cast<GLubyte>(qAlpha(colour))) {}
+
+    /** @brief Sets up attribute 0 (position) and 1 (colour) for the currently bound buffer */
+    static void setupVertexAttribs(QOpenGLFunctions *f) {
+        f->glEnableVertexAttribArray(0);
+        f->glEnableVertexAttribArray(1);
+        f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(AGLColouredVertex), 0);
+        f->glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(AGLColouredVertex),
+                                 reinterpret_cast<void *>(2 * sizeof(GLfloat)));
+    }
+};
+
+static_assert(sizeof(AGLColouredVertex) == 12, "AGLColouredVertex is expected to be packed");
@@ -4,27 +4,9 @@
 
 #include "aglgraph.h"
 
-#include "salalib/geometrygenerators.h"
+#include <cmath>
 
 void AGLGraph::loadGLObjects() {
-
-    {
-        std::vector<Point2f> intersectionLocations;
-        for (auto &connection : m_connections) {
-            intersectionLocations.push_back(connection.second);
-        }
-
-        const std::vector<Point2f> &nodeFillTriangles =
-            GeometryGenerators::generateMultipleDiskTriangles(32, m_nodeSize,
-                                                              intersectionLocations);
-
-        m_intersectionFills.loadTriangleData(nodeFillTriangles, qRgb(0, 0, 255));
-
-        std::vector<SimpleLine> nodeEdgeLines =
-            GeometryGenerators::generateMultipleCircleLines(32, m_nodeSize, intersectionLocations);
-        m_intersectionLines.loadLineData(nodeEdgeLines, qRgb(0, 255, 255));
-    }
-
     std::vector<Point2f> nodeLocations;
     std::vector<SimpleLine> nodeEdgeLines;
 
@@ -33,6 +15,7 @@ void AGLGraph::loadGLObjects() {
         for (auto &connection : m_connections) {
             nodeLocations.push_back(connection.first.start());
             nodeLocations.push_back(connection.first.end());
+            nodeEdgeLines.push_back(connection.first);
         }
         break;
     }
@@ -40,7 +23,6 @@ void AGLGraph::loadGLObjects() {
     case GraphDisplay::CORNERARC: {
         for (auto &connection : m_connections) {
             const Point2f &intp = connection.second;
-            intp.angle();
 
             Point2f intFrom = (connection.first.start() - intp).normalise();
             intFrom.x *= m_graphCornerRadius;
@@ -55,105 +37,83 @@ void AGLGraph::loadGLObjects() {
             if (m_graphDisplay == GraphDisplay::CORNERLINE)
                 nodeEdgeLines.push_back(SimpleLine(intFrom.x, intFrom.y, intTo.x, intTo.y));
         }
-
         break;
     }
     };
 
-    const std::vector<Point2f> &nodeFillTriangles =
-        GeometryGenerators::generateMultipleDiskTriangles(32, m_nodeSize, nodeLocations);
-
-    {
-        std::vector<SimpleLine> nodePetrimeters =
-            GeometryGenerators::generateMultipleCircleLines(32, m_nodeSize, nodeLocations);
-        nodeEdgeLines.insert(nodeEdgeLines.end(), nodePetrimeters.begin(), nodePetrimeters.end());
-    }
-
-    switch (m_graphDisplay) {
-    case GraphDisplay::CORNERLINE: {
-        break;
-    }
-    case GraphDisplay::MIDPOINT: {
-        for (auto &connection : m_connections)
-            nodeEdgeLines.push_back(connection.first);
-        break;
-    }
-    case GraphDisplay::CORNERARC: {
+    m_arcs.init(m_graphDisplay == GraphDisplay::CORNERARC ? m_connections.size() : 0);
+    if (m_graphDisplay == GraphDisplay::CORNERARC) {
+        // only the angles are found here, the points along the arcs are generated in the
+        // vertex shader
         for (auto &connection : m_connections) {
             const Point2f &intp = connection.second;
-            intp.angle();
-            Point2f intFrom = (connection.first.start() - intp).normalise();
-            double fromAngle = atan2(intFrom.y, intFrom.x);
-            if (fromAngle < 0) {
-                fromAngle += 2 * M_PI;
-            }
-            Point2f intTo = (connection.first.end() - intp).normalise();
-            double toAngle = atan2(intTo.y, intTo.x);
-            if (toAngle < 0) {
-                toAngle += 2 * M_PI;
-            }
-
-            if (fromAngle > toAngle) {
-                std::swap(fromAngle, toAngle);
-            }
-            intFrom = Point2f(m_graphCornerRadius * cos(fromAngle),
-                              m_graphCornerRadius * sin(fromAngle)) +
-                      intp;
-            intTo =
-                Point2f(m_graphCornerRadius * cos(toAngle), m_graphCornerRadius * sin(toAngle)) +
-                intp;
-            double angleDiff = 2 * M_PI / 16.0;
-
-            if (toAngle - fromAngle > M_PI) {
-                int startFrom = static_cast<int>(floor(fromAngle / angleDiff) - 1);
-                for (double a = startFrom * angleDiff; a > toAngle - 2 * M_PI; a -= angleDiff) {
-                    Point2f newTo =
-                        Point2f(m_graphCornerRadius * cos(a), m_graphCornerRadius * sin(a)) + intp;
-                    nodeEdgeLines.push_back(SimpleLine(intFrom.x, intFrom.y, newTo.x, newTo.y));
-                    intFrom = newTo;
-                }
-                nodeEdgeLines.push_back(SimpleLine(intFrom.x, intFrom.y, intTo.x, intTo.y));
-            } else {
-                for (double a = 0; a < 2 * M_PI; a += angleDiff) {
-                    if (a < fromAngle)
-                        continue;
-                    if (a >= toAngle)
-                        break;
-                    Point2f newTo =
-                        Point2f(m_graphCornerRadius * cos(a), m_graphCornerRadius * sin(a)) + intp;
-                    nodeEdgeLines.push_back(SimpleLine(intFrom.x, intFrom.y, newTo.x, newTo.y));
-                    intFrom = newTo;
-                }
+            Point2f intFrom = connection.first.start() - intp;
+            Point2f intTo = connection.first.end() - intp;
+            float fromAngle = static_cast<float>(atan2(intFrom.y, intFrom.x));
+            float toAngle = static_cast<float>(atan2(intTo.y, intTo.x));
+            // go the short way around
+            if (toAngle - fromAngle > static_cast<float>(M_PI)) {
+                toAngle -= 2.0f * static_cast<float>(M_PI);
+            } else if (fromAngle - toAngle > static_cast<float>(M_PI)) {
+                toAngle += 2.0f * static_cast<float>(M_PI);
             }
-            nodeEdgeLines.push_back(SimpleLine(intFrom.x, intFrom.y, intTo.x, intTo.y));
+            m_arcs.addArc(intp, fromAngle, toAngle);
         }
-        break;
     }
-    };
 
-    m_fills.loadTriangleData(nodeFillTriangles, qRgb(0, 0, 0));
+    // the disks of the nodes are made in the vertex shader around their centres
+    m_nodes.init(nodeLocations.size());
+    for (const Point2f &location : nodeLocations)
+        m_nodes.addDisk(location);
     m_lines.loadLineData(nodeEdgeLines, qRgb(0, 255, 0));
 
-    std::vector<Point2f> linkPointLocations;
+    m_linkNodes.init(m_links.size() * 2);
     for (auto &link : m_links) {
-        linkPointLocations.push_back(link.start());
-        linkPointLocations.push_back(link.end());
+        m_linkNodes.addDisk(link.start());
+        m_linkNodes.addDisk(link.end());
     }
+    m_linkLines.loadLineData(m_links, qRgb(0, 255, 0));
 
-    const std::vector<Point2f> &linkFillTriangles =
-        GeometryGenerators::generateMultipleDiskTriangles(32, m_nodeSize, linkPointLocations);
-    m_linkFills.loadTriangleData(linkFillTriangles, qRgb(0, 0, 0));
+    m_unlinkNodes.init(m_unlinks.size());
+    for (const Point2f &unlink : m_unlinks)
+        m_unlinkNodes.addDisk(unlink);
+}
 
-    std::vector<SimpleLine> linkFillPerimeters =
-        GeometryGenerators::generateMultipleCircleLines(32, m_nodeSize, linkPointLocations);
-    linkFillPerimeters.insert(linkFillPerimeters.end(), m_links.begin(), m_links.end());
-    m_linkLines.loadLineData(linkFillPerimeters, qRgb(0, 255, 0));
+bool AGLGraph::loadFromCache(const AGLVertexBufferCache &cache, const QString &prefix) {
+    return m_lines.loadFromCache(cache, prefix + "lines") &&
+           m_arcs.loadFromCache(cache, prefix + "arcs") &&
+           m_nodes.loadFromCache(cache, prefix + "nodes") &&
+           m_linkLines.loadFromCache(cache, prefix + "linkLines") &&
+           m_linkNodes.loadFromCache(cache, prefix + "linkNodes") &&
+           m_unlinkNodes.loadFromCache(cache, prefix + "unlinkNodes");
+}
+
+void AGLGraph::storeToCache(AGLVertexBufferCache &cache, const QString &prefix) const {
+    m_lines.storeToCache(cache, prefix + "lines");
+    m_arcs.storeToCache(cache, prefix + "arcs");
+    m_nodes.storeToCache(cache, prefix + "nodes");
+    m_linkLines.storeToCache(cache, prefix + "linkLines");
+    m_linkNodes.storeToCache(cache, prefix + "linkNodes");
+    m_unlinkNodes.storeToCache(cache, prefix + "unlinkNodes");
+}
 
-    const std::vector<Point2f> &unlinkFillTriangles =
-        GeometryGenerators::generateMultipleDiskTriangles(32, m_nodeSize, m_unlinks);
-    m_unlinkFills.loadTriangleData(unlinkFillTriangles, qRgb(255, 255, 255));
+float AGLGraph::getOpacity(const QMatrix4x4 &mvp) const {
+    GLint viewport[4];
+    QOpenGLContext::currentContext()->functions()->glGetIntegerv(GL_VIEWPORT, viewport);
+    float nodePixels =
+        m_nodeSize * std::abs(mvp(1, 1)) * static_cast<float>(viewport[3]) * 0.5f;
+    if (nodePixels <= HIDDEN_NODE_PIXELS)
+        return 0.0f;
+    if (nodePixels >= OPAQUE_NODE_PIXELS)
+        return 1.0f;
+    return (nodePixels - HIDDEN_NODE_PIXELS) / (OPAQUE_NODE_PIXELS - HIDDEN_NODE_PIXELS);
+}
 
-    const std::vector<SimpleLine> &unlinkFillPerimeters =
-        GeometryGenerators::generateMultipleCircleLines(32, m_nodeSize, m_unlinks);
-    m_unlinkLines.loadLineData(unlinkFillPerimeters, qRgb(255, 0, 0));
+void AGLGraph::setOpacity(float opacity) {
+    m_lines.setOpacity(opacity);
+    m_arcs.setOpacity(opacity);
+    m_nodes.setOpacity(opacity);
+    m_linkLines.setOpacity(opacity);
+    m_linkNodes.setOpacity(opacity);
+    m_unlinkNodes.setOpacity(opacity);
 }
@@ -5,9 +5,11 @@
 #pragma once
 
 #include "../derived/aglobjects.h"
+#include "../func/aglvertexbuffercache.h"
 
+#include "../base/aglarcs.h"
+#include "../base/agldisks.h"
 #include "../base/agllinesuniform.h"
-#include "../base/agltrianglesuniform.h"
 
 class AGLGraph : AGLObjects {
 
@@ -19,75 +21,109 @@ class AGLGraph : AGLObjects {
     std::vector<SimpleLine> m_links;
     std::vector<Point2f> m_unlinks;
 
-    AGLLinesUniform m_lines;
-    AGLTrianglesUniform m_fills;
+    // below this size of a node on screen the graph is not drawn, and it fades in up to the
+    // full size so that it doesn't pop in and out while zooming
+    static constexpr float HIDDEN_NODE_PIXELS = 1.0f;
+    static constexpr float OPAQUE_NODE_PIXELS = 3.0f;
 
-    AGLLinesUniform m_intersectionLines;
-    AGLTrianglesUniform m_intersectionFills;
+    // only the centres of the nodes and the angles of the arcs are found on load, their
+    // shapes are made on the GPU
+    AGLLinesUniform m_lines;
+    AGLArcs m_arcs;
+    AGLDisks m_nodes;
 
     AGLLinesUniform m_linkLines;
-    AGLTrianglesUniform m_linkFills;
+    AGLDisks m_linkNodes;
 
-    AGLLinesUniform m_unlinkLines;
-    AGLTrianglesUniform m_unlinkFills;
+    AGLDisks m_unlinkNodes;
 
-    float m_nodeSize;
-    float m_graphCornerRadius;
+    // as the default radius of the arcs, until the owner sets them from its spacing
+    float m_nodeSize = 1.0f;
+    float m_graphCornerRadius = 1.0f;
 
   public:
+    AGLGraph() {
+        m_arcs.setColour(qRgb(0, 255, 0));
+        m_nodes.setColours(qRgb(0, 0, 0), qRgb(0, 255, 0));
+        m_linkNodes.setColours(qRgb(0, 0, 0), qRgb(0, 255, 0));
+        m_unlinkNodes.setColours(qRgb(255, 255, 255), qRgb(255, 0, 0));
+    }
     void addConnection(SimpleLine connection, Point2f intersection) {
         m_connections.push_back(std::make_pair(connection, intersection));
     }
+    void setConnections(std::vector<std::pair<SimpleLine, Point2f>> connections) {
+        m_connections = std::move(connections);
+    }
     void setLinks(std::vector<SimpleLine> links) { m_links = links; }
     void setUnlinks(std::vector<Point2f> unlinks) { m_unlinks = unlinks; }
 
     void initializeGL(bool m_core) override {
         m_lines.initializeGL(m_core);
-        m_fills.initializeGL(m_core);
-        m_intersectionLines.initializeGL(m_core);
-        m_intersectionFills.initializeGL(m_core);
+        m_arcs.initializeGL(m_core);
+        m_nodes.initializeGL(m_core);
         m_linkLines.initializeGL(m_core);
-        m_linkFills.initializeGL(m_core);
-        m_unlinkFills.initializeGL(m_core);
-        m_unlinkLines.initializeGL(m_core);
+        m_linkNodes.initializeGL(m_core);
+        m_unlinkNodes.initializeGL(m_core);
     }
     void updateGL(bool m_core) override {
         m_lines.updateGL(m_core);
-        m_fills.updateGL(m_core);
-        m_intersectionLines.updateGL(m_core);
-        m_intersectionFills.updateGL(m_core);
+        m_arcs.updateGL(m_core);
+        m_nodes.updateGL(m_core);
         m_linkLines.updateGL(m_core);
-        m_linkFills.updateGL(m_core);
-        m_unlinkFills.updateGL(m_core);
-        m_unlinkLines.updateGL(m_core);
+        m_linkNodes.updateGL(m_core);
+        m_unlinkNodes.updateGL(m_core);
+    }
+    void setOrigin(const Point2f &origin) override {
+        AGLObjects::setOrigin(origin);
+        m_lines.setOrigin(origin);
+        m_arcs.setOrigin(origin);
+        m_nodes.setOrigin(origin);
+        m_linkLines.setOrigin(origin);
+        m_linkNodes.setOrigin(origin);
+        m_unlinkNodes.setOrigin(origin);
     }
     void cleanup() override {
         m_lines.cleanup();
-        m_fills.cleanup();
-        m_intersectionLines.cleanup();
-        m_intersectionFills.cleanup();
+        m_arcs.cleanup();
+        m_nodes.cleanup();
         m_linkLines.cleanup();
-        m_linkFills.cleanup();
-        m_unlinkFills.cleanup();
-        m_unlinkLines.cleanup();
+        m_linkNodes.cleanup();
+        m_unlinkNodes.cleanup();
     }
     void paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
                  const QMatrix4x4 &mModel) override {
+        float opacity = getOpacity(mProj * mView * mModel);
+        if (opacity <= 0.0f)
+            return;
+        setOpacity(opacity);
         QOpenGLFunctions *glFuncs = QOpenGLContext::currentContext()->functions();
         glFuncs->glLineWidth(3);
         m_lines.paintGL(mProj, mView, mModel);
-        m_fills.paintGL(mProj, mView, mModel);
-        //        m_intersectionLines.paintGL(mProj, mView, mModel);
-        //        m_intersectionFills.paintGL(mProj, mView, mModel);
+        m_arcs.paintGL(mProj, mView, mModel);
+        m_nodes.paintGL(mProj, mView, mModel);
         m_linkLines.paintGL(mProj, mView, mModel);
-        m_linkFills.paintGL(mProj, mView, mModel);
-        m_unlinkLines.paintGL(mProj, mView, mModel);
-        m_unlinkFills.paintGL(mProj, mView, mModel);
+        m_linkNodes.paintGL(mProj, mView, mModel);
+        m_unlinkNodes.paintGL(mProj, mView, mModel);
         glFuncs->glLineWidth(1);
     }
     void loadGLObjects() override;
     void loadGLObjectsRequiringGLContext() override {}
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &prefix);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &prefix) const;
+
+    void setNodeSize(float nodeSize) {
+        m_nodeSize = nodeSize;
+        m_nodes.setRadius(nodeSize);
+        m_linkNodes.setRadius(nodeSize);
+        m_unlinkNodes.setRadius(nodeSize);
+    }
+    void setGraphCornerRadius(float graphCornerRadius) {
+        m_graphCornerRadius = graphCornerRadius;
+        m_arcs.setRadius(graphCornerRadius);
+    }
 
-    void setNodeSize(float nodeSize) { m_nodeSize = nodeSize; }
-    void setGraphCornerRadius(float graphCornerRadius) { m_graphCornerRadius = graphCornerRadius; }
+  private:
+    /** @brief Opacity of the graph given the size of a node on screen, 0 if too small to see */
+    float getOpacity(const QMatrix4x4 &mvp) const;
+    void setOpacity(float opacity);
 };
@@ -5,17 +5,69 @@
 #pragma once
 
 #include "../derived/aglobjects.h"
+#include "../func/aglvertexbuffercache.h"
 
 #include "genlib/p2dpoly.h"
 
+#include <QVector2D>
+
+#include <vector>
+
 class AGLMap : public AGLObjects {
 
   protected:
     bool m_hoverStoreInvalid = false;
     bool m_hoverHasShapes = false;
+    bool m_selectionStoreInvalid = false;
+    // set while the view is moving to keep up the frame rate, see AGLQualityGovernor
+    bool m_coarseDetail = false;
+    bool m_overlaysHidden = false;
+
+    /** @brief The origin a map's vertices are stored relative to, see AGLObject::setOrigin */
+    static Point2f regionCentre(const QtRegion &region) {
+        return Point2f((region.bottom_left.x + region.top_right.x) * 0.5,
+                       (region.bottom_left.y + region.top_right.y) * 0.5);
+    }
 
   public:
     virtual ~AGLMap() {}
+    /** @brief Leaves out the finer parts of the map (grids, hover highlights) when drawing */
+    void setCoarseDetail(bool coarseDetail) { m_coarseDetail = coarseDetail; }
+    /** @brief Leaves out the graph and link overlays when drawing */
+    void setOverlaysHidden(bool overlaysHidden) { m_overlaysHidden = overlaysHidden; }
     virtual void updateHoverGL(bool m_core) = 0;
     virtual void highlightHoveredItems(const QtRegion &region) = 0;
+
+    /**
+     * @brief Only shows the items whose normalised display value (0 to 1) is within the
+     * range, AGLShapeValues::unfilteredRange() shows everything
+     */
+    virtual void setFilterRange(const QVector2D &) {}
+
+    /** @brief Draws the items with the given keys (in ascending order) as selected */
+    virtual void setSelectedKeys(const std::vector<int> &) {}
+    /** @brief Uploads what setSelectedKeys changed, requires the GL context */
+    virtual void updateSelectionGL() {}
+
+    /**
+     * @brief Loads the final vertex data of the map from the cache instead of generating it.
+     * Returns false if any part is missing, in which case loadGLObjects() has to be used.
+     */
+    virtual bool loadGLObjectsFromCache(const AGLVertexBufferCache &, const QString &) {
+        return false;
+    }
+    virtual void storeGLObjectsToCache(AGLVertexBufferCache &, const QString &) const {}
+
+    /**
+     * @brief Draws the map from raster tiles made in the background where it can, see
+     * AGLTilePyramid. Tiles are kept under diskDirectory unless empty. Call before loading.
+     */
+    virtual void enableRasterTiles(const QString &) {}
+    /** @brief Whether there is work in the background that needs more frames to show */
+    virtual bool hasPendingWork() const { return false; }
+    /**
+     * @brief Stops and waits for the work in the background that reads the layer, for
+     * before the layer goes away. Nothing but cleanup() may be called on the map after this
+     */
+    virtual void stopBackgroundWork() {}
 };
@@ -4,14 +4,17 @@
 
 #include "aglpixelmap.h"
 
+#include "../func/aglcolourmapper.h"
+
 #include "salalib/geometrygenerators.h"
 #include "salalib/linkutils.h"
 
+#include <algorithm>
+
 void AGLPixelMap::loadGLObjects() {
     QtRegion region = m_pixelMap.getRegion();
-    m_rasterTexture.loadRegionData(
-        static_cast<float>(region.bottom_left.x), static_cast<float>(region.bottom_left.y),
-        static_cast<float>(region.top_right.x), static_cast<float>(region.top_right.y));
+    setOrigin(regionCentre(region));
+    m_rasterTexture.loadRegionData(region);
 
     if (m_showGrid) {
         std::vector<SimpleLine> gridData;
@@ -56,32 +59,98 @@ void AGLPixelMap::loadGLObjectsRequiringGLContext() {
     QImage data(static_cast<int>(m_pixelMap.getCols()), static_cast<int>(m_pixelMap.getRows()),
                 QImage::Format_RGBA8888);
     data.fill(Qt::transparent);
+    // the normalised display value of each pixel for filtering, see loadFilterData
+    m_filterData = QImage(data.width(), data.height(), QImage::Format_RGBA8888);
+    m_filterData.fill(Qt::transparent);
+
+    AttributeTable &attributes = m_pixelMap.getAttributeTable();
+    int displayColumn = m_pixelMap.getAttributeTableHandle().getDisplayColIndex();
+    // when the reference number is displayed it is also what is filtered on
+    float maxRef = std::max(1.0f, static_cast<float>(static_cast<int>(
+                                      PixelRef(static_cast<short>(m_pixelMap.getCols() - 1),
+                                               static_cast<short>(m_pixelMap.getRows() - 1)))));
 
+    auto setPixel = [&](PixelRef pix, const PafColor &colour, float value) {
+        data.setPixelColor(pix.x, pix.y, qRgb(colour.redb(), colour.greenb(), colour.blueb()));
+        if (displayColumn < 0)
+            value = static_cast<float>(static_cast<int>(pix)) / maxRef;
+        if (value >= 0.0f) {
+            int packed = static_cast<int>(std::min(value, 1.0f) * 65535.0f + 0.5f);
+            m_filterData.setPixelColor(pix.x, pix.y, QColor(packed >> 8, packed & 0xFF, 0, 255));
+        }
+    };
+    // the pixels with a value are coloured in one pass, the rest are coloured by their
+    // state (blocked, edge, selected) afterwards
+    auto hasValue = [&](PixelRef pix) {
+        return m_pixelMap.getPoint(pix).filled() &&
+               attributes.getRowPtr(AttributeKey(pix)) != nullptr;
+    };
+    std::vector<int> keys;
+    keys.reserve(m_pixelMap.getCols() * m_pixelMap.getRows());
     for (size_t y = 0; y < m_pixelMap.getRows(); y++) {
         for (size_t x = 0; x < m_pixelMap.getCols(); x++) {
             PixelRef pix(static_cast<short>(x), static_cast<short>(y));
+            if (hasValue(pix))
+                keys.push_back(pix);
+        }
+    }
+    std::vector<float> values;
+    std::vector<PafColor> colours = AGLColourMapper::getDisplayColours(
+        attributes, m_pixelMap.getAttributeTableHandle(), keys, &values);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        setPixel(PixelRef(keys[i]), colours[i], values[i]);
+    }
+    for (size_t y = 0; y < m_pixelMap.getRows(); y++) {
+        for (size_t x = 0; x < m_pixelMap.getCols(); x++) {
+            PixelRef pix(static_cast<short>(x), static_cast<short>(y));
+            if (hasValue(pix))
+                continue;
             PafColor colour = m_pixelMap.getPointColor(pix);
-            if (colour.alphab() != 0) { // alpha == 0 is transparent
-                data.setPixelColor(static_cast<int>(x), static_cast<int>(y),
-                                   qRgb(colour.redb(), colour.greenb(), colour.blueb()));
-            }
+            if (colour.alphab() != 0) // alpha == 0 is transparent
+                setPixel(pix, colour, -1.0f);
         }
     }
+    markSelectedPixels(m_selectedKeys, true);
     m_rasterTexture.loadPixelData(data);
+    m_rasterTexture.loadFilterData(m_filterData);
+    m_selectionStoreInvalid = false;
+}
+
+void AGLPixelMap::markSelectedPixels(const std::vector<int> &keys, bool selected) {
+    for (int key : keys) {
+        PixelRef pix(key);
+        if (pix.x < 0 || pix.y < 0 || pix.x >= m_filterData.width() ||
+            pix.y >= m_filterData.height())
+            continue;
+        // Format_RGBA8888 keeps the bytes in R, G, B, A order
+        uchar *texel = m_filterData.scanLine(pix.y) + pix.x * 4;
+        texel[2] = selected ? 255 : 0;
+    }
+}
+
+void AGLPixelMap::setSelectedKeys(const std::vector<int> &selectedKeys) {
+    if (selectedKeys.empty() && m_selectedKeys.empty())
+        return;
+    markSelectedPixels(m_selectedKeys, false);
+    m_selectedKeys = selectedKeys;
+    markSelectedPixels(m_selectedKeys, true);
+    m_selectionStoreInvalid = true;
 }
 
 void AGLPixelMap::paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView,
                           const QMatrix4x4 &m_mModel) {
     m_rasterTexture.paintGL(m_mProj, m_mView, m_mModel);
-    if (m_showGrid)
+    if (m_showGrid && !m_coarseDetail)
         m_grid.paintGL(m_mProj, m_mView, m_mModel);
-    if (m_showLinks) {
+    if (m_showLinks && !m_overlaysHidden) {
         QOpenGLFunctions *glFuncs = QOpenGLContext::currentContext()->functions();
         glFuncs->glLineWidth(3);
         m_linkLines.paintGL(m_mProj, m_mView, m_mModel);
         m_linkFills.paintGL(m_mProj, m_mView, m_mModel);
         glFuncs->glLineWidth(1);
     }
+    if (m_coarseDetail)
+        return;
     glLineWidth(3);
     m_hoveredPixels.paintGL(m_mProj, m_mView, m_mModel);
     glLineWidth(1);
@@ -12,6 +12,8 @@
 
 #include "salalib/pointdata.h"
 
+#include <QImage>
+
 class AGLPixelMap : public AGLMap {
   public:
     AGLPixelMap(PointMap &pointMap) : AGLMap(), m_pixelMap(pointMap) {}
@@ -45,6 +47,15 @@ class AGLPixelMap : public AGLMap {
         }
     }
 
+    void setOrigin(const Point2f &origin) override {
+        AGLMap::setOrigin(origin);
+        m_grid.setOrigin(origin);
+        m_rasterTexture.setOrigin(origin);
+        m_linkLines.setOrigin(origin);
+        m_linkFills.setOrigin(origin);
+        m_hoveredPixels.setOrigin(origin);
+    }
+
     void cleanup() override {
         m_grid.cleanup();
         m_rasterTexture.cleanup();
@@ -59,6 +70,17 @@ class AGLPixelMap : public AGLMap {
     void loadGLObjectsRequiringGLContext() override;
 
     void highlightHoveredItems(const QtRegion &region) override { highlightHoveredPixels(region); }
+    void setFilterRange(const QVector2D &filterRange) override {
+        m_rasterTexture.setFilterRange(filterRange);
+    }
+    void setSelectedKeys(const std::vector<int> &selectedKeys) override;
+    void updateSelectionGL() override {
+        // before the pixels are loaded the selection is applied along with them
+        if (!m_selectionStoreInvalid || m_filterData.isNull())
+            return;
+        m_rasterTexture.updateFilterData(m_filterData);
+        m_selectionStoreInvalid = false;
+    }
 
     void setGridColour(QColor gridColour) { m_gridColour = gridColour; }
     void showLinks(bool showLinks) { m_showLinks = showLinks; }
@@ -67,11 +89,16 @@ class AGLPixelMap : public AGLMap {
     void highlightHoveredPixels(const std::set<PixelRef> &refs);
 
   private:
+    void markSelectedPixels(const std::vector<int> &keys, bool selected);
+
     PointMap &m_pixelMap;
     AGLLinesUniform m_grid;
     AGLRasterTexture m_rasterTexture;
     AGLLinesUniform m_linkLines;
     AGLTrianglesUniform m_linkFills;
+    // kept to change the selection flags (blue channel) without recomputing the values
+    QImage m_filterData;
+    std::vector<int> m_selectedKeys;
 
     QColor m_gridColour =
         QColor::fromRgb((qRgb(255, 255, 255) & 0x006f6f6f) | (qRgb(0, 0, 0) & 0x00a0a0a0));
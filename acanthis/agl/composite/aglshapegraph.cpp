@@ -4,42 +4,37 @@
 
 #include "aglshapegraph.h"
 
-void AGLShapeGraph::loadGLObjects() {
-    AGLShapeMap::loadGLObjects();
+void AGLShapeGraph::setGraphSizes() {
     m_glGraph.setNodeSize(static_cast<float>(m_shapeGraph.getSpacing()) * 0.05f);
     m_glGraph.setGraphCornerRadius(static_cast<float>(m_shapeGraph.getSpacing()) * 0.3f);
+}
+
+bool AGLShapeGraph::loadGLObjectsFromCache(const AGLVertexBufferCache &cache,
+                                           const QString &prefix) {
+    // the sizes are not in the cache, the arcs are drawn and the graph faded by them
+    setGraphSizes();
+    return AGLShapeMap::loadGLObjectsFromCache(cache, prefix) &&
+           m_glGraph.loadFromCache(cache, prefix + "graph/");
+}
 
-    std::vector<Connector> &connections = m_shapeGraph.getConnections();
-    auto &shapes = m_shapeGraph.getAllShapes();
-    auto shapeIter = shapes.begin();
-    for (Connector &connector : connections) {
-        auto &fromShape = shapeIter->second;
-        auto fromCentroid = fromShape.getCentroid();
-        for (size_t &connection : connector.m_connections) {
-            auto &toShape = shapes[static_cast<int>(connection)];
-            auto toCentroid = toShape.getCentroid();
-            m_glGraph.addConnection(
+void AGLShapeGraph::loadGLObjects() {
+    AGLShapeMap::loadGLObjects();
+    setGraphSizes();
+
+    m_connections = AGLGraphConnections(m_shapeGraph);
+    std::vector<std::pair<SimpleLine, Point2f>> connections;
+    connections.reserve(m_connections.edgeCount());
+    for (size_t node = 0; node < m_connections.nodeCount(); ++node) {
+        const Point2f &fromCentroid = m_connections.getCentroid(node);
+        for (size_t edge = m_connections.getEdgesBegin(node);
+             edge < m_connections.getEdgesEnd(node); ++edge) {
+            const Point2f &toCentroid = m_connections.getCentroid(m_connections.getTarget(edge));
+            connections.push_back(std::make_pair(
                 SimpleLine(fromCentroid.x, fromCentroid.y, toCentroid.x, toCentroid.y),
-                intersection_point(fromShape.getLine(), toShape.getLine()));
-        }
-        for (auto &secConn : connector.m_forward_segconns) {
-            auto &toShape = shapes[secConn.first.ref];
-            auto toCentroid = toShape.getCentroid();
-            const Point2f &intp =
-                secConn.first.dir != -1 ? toShape.getLine().start() : toShape.getLine().end();
-            m_glGraph.addConnection(
-                SimpleLine(fromCentroid.x, fromCentroid.y, toCentroid.x, toCentroid.y), intp);
-        }
-        for (auto &secConn : connector.m_back_segconns) {
-            auto &toShape = shapes[secConn.first.ref];
-            auto toCentroid = toShape.getCentroid();
-            const Point2f &intp =
-                secConn.first.dir != -1 ? toShape.getLine().start() : toShape.getLine().end();
-            m_glGraph.addConnection(
-                SimpleLine(fromCentroid.x, fromCentroid.y, toCentroid.x, toCentroid.y), intp);
+                m_connections.getIntersection(edge)));
         }
-        shapeIter++;
     }
+    m_glGraph.setConnections(std::move(connections));
     m_glGraph.setLinks(m_shapeGraph.getAllLinkLines());
     m_glGraph.setUnlinks(m_shapeGraph.getAllUnlinkPoints());
     m_glGraph.loadGLObjects();
@@ -5,14 +5,17 @@
 #pragma once
 
 #include "../composite/aglgraph.h"
+#include "../func/aglgraphconnections.h"
 #include "aglshapemap.h"
 
 #include "salalib/shapegraph.h"
 
 class AGLShapeGraph : public AGLShapeMap {
   public:
-    AGLShapeGraph(ShapeGraph &shapeGraph, unsigned int pointSides, float pointRadius)
-        : AGLShapeMap(shapeGraph, pointSides, pointRadius), m_shapeGraph(shapeGraph){};
+    AGLShapeGraph(ShapeGraph &shapeGraph, AGLShapeIndex &shapeIndex, unsigned int pointSides,
+                  float pointRadius)
+        : AGLShapeMap(shapeGraph, shapeIndex, pointSides, pointRadius),
+          m_shapeGraph(shapeGraph){};
 
     void initializeGL(bool core) override {
         AGLShapeMap::initializeGL(core);
@@ -23,9 +26,8 @@ class AGLShapeGraph : public AGLShapeMap {
         if (!m_datasetChanged)
             return;
         if (m_forceReloadGLObjects) {
+            // also reloads the shapes and the graph overlay
             loadGLObjects();
-            AGLShapeMap::loadGLObjects();
-            m_glGraph.loadGLObjects();
             m_forceReloadGLObjects = false;
         }
         AGLShapeMap::updateGL(core);
@@ -33,6 +35,11 @@ class AGLShapeGraph : public AGLShapeMap {
         m_datasetChanged = false;
     }
 
+    void setOrigin(const Point2f &origin) override {
+        AGLShapeMap::setOrigin(origin);
+        m_glGraph.setOrigin(origin);
+    }
+
     void cleanup() override {
         AGLShapeMap::cleanup();
         m_glGraph.cleanup();
@@ -41,18 +48,29 @@ class AGLShapeGraph : public AGLShapeMap {
     void paintGL(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
                  const QMatrix4x4 &mModel) override {
         AGLShapeMap::paintGL(mProj, mView, mModel);
-        if (m_showLinks) {
+        if (m_showLinks && !m_overlaysHidden) {
             m_glGraph.paintGL(mProj, mView, mModel);
         }
     }
 
     void showLinks(bool showLinks) { m_showLinks = showLinks; }
+    /** @brief The connections as of the last loadGLObjects(), empty if loaded from the cache */
+    const AGLGraphConnections &getConnections() const { return m_connections; }
     void loadGLObjects() override;
+    bool loadGLObjectsFromCache(const AGLVertexBufferCache &cache, const QString &prefix) override;
+    void storeGLObjectsToCache(AGLVertexBufferCache &cache, const QString &prefix) const override {
+        AGLShapeMap::storeGLObjectsToCache(cache, prefix);
+        m_glGraph.storeToCache(cache, prefix + "graph/");
+    }
 
   private:
+    /** @brief Sizes the nodes and arcs of the graph by the spacing of the map */
+    void setGraphSizes();
+
     ShapeGraph &m_shapeGraph;
 
     AGLGraph m_glGraph;
+    AGLGraphConnections m_connections;
 
     bool m_showLinks = true;
 };
@@ -4,41 +4,204 @@
 
 #include "aglshapemap.h"
 
+#include "../func/aglcolourmapper.h"
+
+#include <algorithm>
+
 void AGLShapeMap::loadGLObjects() {
-    m_lines.loadLineData(m_shapeMap.getAllLinesWithColour());
-    m_polygons.loadPolygonData(m_shapeMap.getAllPolygonsWithColour());
-    m_points.loadPolygonData(m_shapeMap.getAllPointsWithColour(), m_pointSides, m_pointRadius);
+    setOrigin(regionCentre(m_shapeMap.getRegion()));
+    // shapes are walked directly instead of going through getAllLinesWithColour, so
+    // that polylines can be kept as strips instead of being broken into segments
+    std::vector<int> shapeKeys;
+    std::vector<const SalaShape *> drawnShapes;
+    size_t polylineCount = 0;
+    size_t polylineVertexCount = 0;
+    for (const auto &keyShape : m_shapeMap.getAllShapes()) {
+        const SalaShape &shape = keyShape.second;
+        if (!shape.isLine() && !shape.isPolyLine() && !shape.isPolygon() && !shape.isPoint())
+            continue;
+        shapeKeys.push_back(keyShape.first);
+        drawnShapes.push_back(&shape);
+        if (shape.isPolyLine()) {
+            ++polylineCount;
+            polylineVertexCount += shape.m_points.size();
+        }
+    }
+    // all colours in one go rather than one getDisplayColor call per shape, the values
+    // they come from are kept on the GPU for filtering
+    std::vector<float> values;
+    std::vector<PafColor> colours = AGLColourMapper::getDisplayColours(
+        m_shapeMap.getAttributeTable(), m_shapeMap.getAttributeTableHandle(), shapeKeys,
+        &values);
+
+    std::vector<std::pair<SimpleLine, PafColor>> colouredLines;
+    std::vector<std::pair<std::vector<Point2f>, PafColor>> colouredPolygons;
+    std::vector<std::pair<Point2f, PafColor>> colouredPoints;
+    std::vector<float> lineValues;
+    std::vector<float> polygonValues;
+    std::vector<float> pointValues;
+    m_polylines.init(polylineVertexCount, polylineCount);
+    m_lineKeys.clear();
+    m_polylineKeys.clear();
+    m_polygonKeys.clear();
+    m_pointKeys.clear();
+    m_polygonIndices.clear();
+
+    for (size_t i = 0; i < drawnShapes.size(); ++i) {
+        const SalaShape &shape = *drawnShapes[i];
+        const PafColor &colour = colours[i];
+
+        if (shape.isLine()) {
+            colouredLines.push_back(std::make_pair(SimpleLine(shape.getLine()), colour));
+            lineValues.push_back(values[i]);
+            m_lineKeys.push_back(shapeKeys[i]);
+        } else if (shape.isPolyLine()) {
+            m_polylines.addStrip(shape.m_points,
+                                 qRgb(colour.redb(), colour.greenb(), colour.blueb()), false,
+                                 values[i]);
+            // strips of less than two points are not added
+            if (shape.m_points.size() >= 2)
+                m_polylineKeys.push_back(shapeKeys[i]);
+        } else if (shape.isPolygon()) {
+            m_polygonIndices[shapeKeys[i]] = colouredPolygons.size();
+            colouredPolygons.push_back(std::make_pair(shape.m_points, colour));
+            polygonValues.push_back(values[i]);
+            m_polygonKeys.push_back(shapeKeys[i]);
+        } else {
+            colouredPoints.push_back(std::make_pair(shape.getCentroid(), colour));
+            pointValues.push_back(values[i]);
+            m_pointKeys.push_back(shapeKeys[i]);
+        }
+    }
+    m_lines.loadLineData(colouredLines, lineValues);
+    m_polygons.loadPolygonData(colouredPolygons, polygonValues);
+    m_points.loadPolygonData(colouredPoints, m_pointSides, m_pointRadius, pointValues);
+    m_shapeIndex.build();
+    applySelection();
+    if (m_tilePyramid)
+        resetRasterTiles(shapeKeys, colours);
+}
+
+bool AGLShapeMap::loadGLObjectsFromCache(const AGLVertexBufferCache &cache,
+                                         const QString &prefix) {
+    // the cached vertices were stored relative to the same origin
+    setOrigin(regionCentre(m_shapeMap.getRegion()));
+    if (!m_lines.loadFromCache(cache, prefix + "lines") ||
+        !m_polylines.loadFromCache(cache, prefix + "polylines") ||
+        !m_polygons.loadFromCache(cache, prefix + "polygons") ||
+        !m_points.loadFromCache(cache, prefix + "points"))
+        return false;
+    indexShapes();
+    if (m_lineKeys.size() != m_lines.shapeCount() ||
+        m_polylineKeys.size() != m_polylines.shapeCount() ||
+        m_polygonKeys.size() != m_polygons.shapeCount() ||
+        m_polygonIndices.size() != m_polygons.polygonCount() ||
+        m_pointKeys.size() != m_points.shapeCount())
+        return false;
+    m_shapeIndex.build();
+    applySelection();
+    if (m_tilePyramid) {
+        // the colours are not cached, only the tiles need them
+        std::vector<int> shapeKeys;
+        for (const auto &keyShape : m_shapeMap.getAllShapes()) {
+            const SalaShape &shape = keyShape.second;
+            if (shape.isLine() || shape.isPolyLine() || shape.isPolygon() || shape.isPoint())
+                shapeKeys.push_back(keyShape.first);
+        }
+        resetRasterTiles(shapeKeys, AGLColourMapper::getDisplayColours(
+                                        m_shapeMap.getAttributeTable(),
+                                        m_shapeMap.getAttributeTableHandle(), shapeKeys));
+    }
+    return true;
+}
+
+void AGLShapeMap::storeGLObjectsToCache(AGLVertexBufferCache &cache,
+                                        const QString &prefix) const {
+    m_lines.storeToCache(cache, prefix + "lines");
+    m_polylines.storeToCache(cache, prefix + "polylines");
+    m_polygons.storeToCache(cache, prefix + "polygons");
+    m_points.storeToCache(cache, prefix + "points");
+}
+
+void AGLShapeMap::indexShapes() {
+    m_lineKeys.clear();
+    m_polylineKeys.clear();
+    m_polygonKeys.clear();
+    m_pointKeys.clear();
+    m_polygonIndices.clear();
+    for (const auto &keyShape : m_shapeMap.getAllShapes()) {
+        const SalaShape &shape = keyShape.second;
+        if (shape.isLine()) {
+            m_lineKeys.push_back(keyShape.first);
+        } else if (shape.isPolyLine()) {
+            if (shape.m_points.size() >= 2)
+                m_polylineKeys.push_back(keyShape.first);
+        } else if (shape.isPolygon()) {
+            m_polygonIndices[keyShape.first] = m_polygonKeys.size();
+            m_polygonKeys.push_back(keyShape.first);
+        } else if (shape.isPoint()) {
+            m_pointKeys.push_back(keyShape.first);
+        }
+    }
+}
+
+// one flag per shape of an object, found by walking both (ascending) key lists together
+static std::vector<float> selectionFlags(const std::vector<int> &objectKeys,
+                                         const std::vector<int> &selectedKeys) {
+    std::vector<float> flags;
+    if (selectedKeys.empty())
+        return flags;
+    flags.resize(objectKeys.size(), 0.0f);
+    auto selectedKey = selectedKeys.begin();
+    for (size_t i = 0; i < objectKeys.size() && selectedKey != selectedKeys.end(); ++i) {
+        selectedKey = std::lower_bound(selectedKey, selectedKeys.end(), objectKeys[i]);
+        if (selectedKey != selectedKeys.end() && *selectedKey == objectKeys[i])
+            flags[i] = 1.0f;
+    }
+    return flags;
+}
+
+void AGLShapeMap::applySelection() {
+    // no flags at all when nothing is selected, the objects then drop the buffers
+    m_lines.setSelectedShapes(selectionFlags(m_lineKeys, m_selectedKeys));
+    m_polylines.setSelectedShapes(selectionFlags(m_polylineKeys, m_selectedKeys));
+    m_polygons.setSelectedShapes(selectionFlags(m_polygonKeys, m_selectedKeys));
+    m_points.setSelectedShapes(selectionFlags(m_pointKeys, m_selectedKeys));
+    m_selectionStoreInvalid = true;
+}
+
+void AGLShapeMap::setSelectedKeys(const std::vector<int> &selectedKeys) {
+    if (selectedKeys.empty() && m_selectedKeys.empty())
+        return;
+    m_selectedKeys = selectedKeys;
+    applySelection();
 }
 
 void AGLShapeMap::highlightHoveredShapes(const QtRegion &region) {
 
-    auto shapesInRegion = m_shapeMap.getShapesInRegion(region);
-    if (!shapesInRegion.empty()) {
+    std::vector<int> shapeKeys = m_shapeIndex.getShapeKeysInRegion(region);
+    if (!shapeKeys.empty()) {
         std::vector<std::pair<SimpleLine, PafColor>> colouredLines;
-        std::vector<std::pair<std::vector<Point2f>, PafColor>> colouredPolygons;
+        std::vector<size_t> hoveredPolygons;
         std::vector<std::pair<Point2f, PafColor>> colouredPoints;
-        for (auto keyShape : shapesInRegion) {
-            AttributeKey key = AttributeKey(keyShape.first);
-            const SalaShape &shape = keyShape.second;
-
-            const AttributeRow &row = m_shapeMap.getAttributeTable().getRow(key);
-            PafColor colour =
-                dXreimpl::getDisplayColor(key, row, m_shapeMap.getAttributeTableHandle(), true);
+        m_hoveredPolylines.init(0, 0);
+        std::vector<PafColor> colours = AGLColourMapper::getDisplayColours(
+            m_shapeMap.getAttributeTable(), m_shapeMap.getAttributeTableHandle(), shapeKeys);
+        const auto &shapes = m_shapeMap.getAllShapes();
+        for (size_t shapeIndex = 0; shapeIndex < shapeKeys.size(); ++shapeIndex) {
+            const SalaShape &shape = shapes.at(shapeKeys[shapeIndex]);
+            const PafColor &colour = colours[shapeIndex];
 
             if (shape.isLine()) {
                 colouredLines.push_back(std::make_pair(SimpleLine(shape.getLine()), colour));
             } else if (shape.isPolyLine()) {
-                for (size_t n = 0; n < shape.m_points.size() - 1; n++) {
-                    colouredLines.push_back(std::make_pair(
-                        SimpleLine(shape.m_points[n], shape.m_points[n + 1]), colour));
-                }
+                m_hoveredPolylines.addStrip(
+                    shape.m_points, qRgb(colour.redb(), colour.greenb(), colour.blueb()), false);
             } else if (shape.isPolygon()) {
-                for (size_t n = 0; n < shape.m_points.size() - 1; n++) {
-                    colouredLines.push_back(std::make_pair(
-                        SimpleLine(shape.m_points[n], shape.m_points[n + 1]), PafColor(1, 1, 0)));
-                }
-                colouredLines.push_back(std::make_pair(
-                    SimpleLine(shape.m_points.back(), shape.m_points.front()), PafColor(1, 1, 0)));
+                // the outline is drawn from the polygon vertices already on the GPU
+                auto polygonIndex = m_polygonIndices.find(shapeKeys[shapeIndex]);
+                if (polygonIndex != m_polygonIndices.end())
+                    hoveredPolygons.push_back(polygonIndex->second);
             } else {
                 if (shape.isPoint()) {
                     colouredPoints.push_back(
@@ -47,10 +210,13 @@ void AGLShapeMap::highlightHoveredShapes(const QtRegion &region) {
             }
         }
         m_hoveredShapes.loadLineData(colouredLines);
+        m_polygons.setHighlightedPolygons(hoveredPolygons, qRgb(255, 255, 0));
         m_hoverStoreInvalid = true;
         m_hoverHasShapes = true;
     } else if (m_hoverHasShapes) {
         m_hoveredShapes.loadLineData(std::vector<std::pair<SimpleLine, PafColor>>());
+        m_hoveredPolylines.init(0, 0);
+        m_polygons.setHighlightedPolygons(std::vector<size_t>(), qRgb(255, 255, 0));
         m_hoverStoreInvalid = true;
         m_hoverHasShapes = false;
     }
@@ -59,3 +225,89 @@ void AGLShapeMap::highlightHoveredShapes(const QtRegion &region) {
         //        update();
     }
 }
+
+void AGLShapeMap::enableRasterTiles(const QString &diskDirectory) {
+    m_tileDirectory = diskDirectory;
+    if (!m_tilePyramid) {
+        m_tilePyramid = std::make_unique<AGLTilePyramid>(
+            [this](QPainter &painter, const QtRegion &region) {
+                return rasteriseShapes(painter, region);
+            });
+    }
+}
+
+void AGLShapeMap::resetRasterTiles(const std::vector<int> &shapeKeys,
+                                   const std::vector<PafColor> &colours) {
+    std::vector<QRgb> tileColours(colours.size());
+    // tiles of other colourings are kept apart on disk by a hash of the colours
+    uint64_t colourHash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < colours.size(); ++i) {
+        tileColours[i] = qRgb(colours[i].redb(), colours[i].greenb(), colours[i].blueb());
+        colourHash = (colourHash ^ static_cast<uint64_t>(shapeKeys[i])) * 0x100000001b3ULL;
+        colourHash = (colourHash ^ tileColours[i]) * 0x100000001b3ULL;
+    }
+    // waits for the tiles being made, which read the colours
+    m_tilePyramid->reset(m_shapeMap.getRegion(), getOrigin(),
+                         m_tileDirectory.isEmpty()
+                             ? QString()
+                             : m_tileDirectory + "/" + QString::number(colourHash, 16));
+    m_tileColours.clear();
+    m_tileColours.reserve(shapeKeys.size());
+    for (size_t i = 0; i < tileColours.size(); ++i) {
+        m_tileColours[shapeKeys[i]] = tileColours[i];
+    }
+}
+
+bool AGLShapeMap::rasteriseShapes(QPainter &painter, const QtRegion &region) {
+    std::vector<int> shapeKeys = m_shapeIndex.getShapeKeysInRegion(region);
+    if (shapeKeys.empty())
+        return false;
+    const auto &shapes = m_shapeMap.getAllShapes();
+    QPen pen;
+    pen.setCosmetic(true);
+    bool drawn = false;
+    for (int key : shapeKeys) {
+        auto colour = m_tileColours.find(key);
+        if (colour == m_tileColours.end())
+            continue;
+        const SalaShape &shape = shapes.at(key);
+        pen.setColor(QColor(colour->second));
+        painter.setPen(pen);
+        if (shape.isLine()) {
+            const Line &line = shape.getLine();
+            painter.drawLine(QPointF(line.start().x, line.start().y),
+                             QPointF(line.end().x, line.end().y));
+        } else if (shape.isPolyLine() || shape.isPolygon()) {
+            QPolygonF polygon;
+            polygon.reserve(static_cast<qsizetype>(shape.m_points.size()));
+            for (const Point2f &point : shape.m_points) {
+                polygon.append(QPointF(point.x, point.y));
+            }
+            if (shape.isPolygon()) {
+                painter.setBrush(QColor(colour->second));
+                painter.drawPolygon(polygon);
+                painter.setBrush(Qt::NoBrush);
+            } else {
+                painter.drawPolyline(polygon);
+            }
+        } else {
+            Point2f centre = shape.getCentroid();
+            painter.setBrush(QColor(colour->second));
+            painter.drawEllipse(QPointF(centre.x, centre.y), m_pointRadius, m_pointRadius);
+            painter.setBrush(Qt::NoBrush);
+        }
+        drawn = true;
+    }
+    return drawn;
+}
+
+bool AGLShapeMap::paintRasterTiles(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                                   const QMatrix4x4 &mModel) {
+    if (!m_tilePyramid)
+        return false;
+    m_tilePyramid->updateGL();
+    // the tiles don't show the filter or the selection
+    if (m_filtered || !m_selectedKeys.empty())
+        return false;
+    return m_tilePyramid->paintGL(mProj, mView, mModel);
+}
@@ -6,22 +6,36 @@
 
 #include "aglmap.h"
 
+#include "../base/aglindexedlines.h"
 #include "../base/agllines.h"
+#include "../base/agltilepyramid.h"
 #include "../derived/aglpolygons.h"
 #include "../derived/aglregularpolygons.h"
+#include "../func/aglshapeindex.h"
 
 #include "salalib/shapemap.h"
 
+#include <memory>
+#include <unordered_map>
+
 class AGLShapeMap : public AGLMap {
   public:
-    AGLShapeMap(ShapeMap &shapeMap, unsigned int pointSides, float pointRadius)
-        : AGLMap(), m_pointSides(pointSides), m_pointRadius(pointRadius), m_shapeMap(shapeMap){};
+    AGLShapeMap(ShapeMap &shapeMap, AGLShapeIndex &shapeIndex, unsigned int pointSides,
+                float pointRadius, AGLTriangulationCache *triangulationCache = nullptr)
+        : AGLMap(), m_pointSides(pointSides), m_pointRadius(pointRadius), m_shapeMap(shapeMap),
+          m_shapeIndex(shapeIndex) {
+        m_polygons.setTriangulationCache(triangulationCache);
+    };
 
     void initializeGL(bool m_core) override {
         m_lines.initializeGL(m_core);
+        m_polylines.initializeGL(m_core);
         m_polygons.initializeGL(m_core);
         m_points.initializeGL(m_core);
         m_hoveredShapes.initializeGL(m_core);
+        m_hoveredPolylines.initializeGL(m_core);
+        if (m_tilePyramid)
+            m_tilePyramid->initializeGL(m_core);
     }
 
     void updateGL(bool m_core) override {
@@ -32,6 +46,7 @@ class AGLShapeMap : public AGLMap {
             m_forceReloadGLObjects = false;
         }
         m_lines.updateGL(m_core);
+        m_polylines.updateGL(m_core);
         m_polygons.updateGL(m_core);
         m_points.updateGL(m_core);
         m_datasetChanged = false;
@@ -40,41 +55,122 @@ class AGLShapeMap : public AGLMap {
     void updateHoverGL(bool m_core) override {
         if (m_hoverStoreInvalid) {
             m_hoveredShapes.updateGL(m_core);
+            m_hoveredPolylines.updateGL(m_core);
+            m_polygons.updateHighlightGL();
             m_hoverStoreInvalid = false;
         }
     }
 
+    void updateSelectionGL() override {
+        if (!m_selectionStoreInvalid)
+            return;
+        m_lines.updateSelectionGL();
+        m_polylines.updateSelectionGL();
+        m_polygons.updateSelectionGL();
+        m_points.updateSelectionGL();
+        m_selectionStoreInvalid = false;
+    }
+
+    void setOrigin(const Point2f &origin) override {
+        AGLMap::setOrigin(origin);
+        m_lines.setOrigin(origin);
+        m_polylines.setOrigin(origin);
+        m_polygons.setOrigin(origin);
+        m_points.setOrigin(origin);
+        m_hoveredShapes.setOrigin(origin);
+        m_hoveredPolylines.setOrigin(origin);
+    }
+
     void cleanup() override {
         m_lines.cleanup();
+        m_polylines.cleanup();
         m_polygons.cleanup();
         m_points.cleanup();
         m_hoveredShapes.cleanup();
+        m_hoveredPolylines.cleanup();
+        if (m_tilePyramid)
+            m_tilePyramid->cleanup();
     }
 
     void paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView,
                  const QMatrix4x4 &m_mModel) override {
-        m_lines.paintGL(m_mProj, m_mView, m_mModel);
-        m_polygons.paintGL(m_mProj, m_mView, m_mModel);
-        m_points.paintGL(m_mProj, m_mView, m_mModel);
+        if (!paintRasterTiles(m_mProj, m_mView, m_mModel)) {
+            m_lines.paintGL(m_mProj, m_mView, m_mModel);
+            m_polylines.paintGL(m_mProj, m_mView, m_mModel);
+            m_polygons.paintGL(m_mProj, m_mView, m_mModel);
+            m_points.paintGL(m_mProj, m_mView, m_mModel);
+        }
+        if (m_coarseDetail)
+            return;
         glLineWidth(10);
         m_hoveredShapes.paintGL(m_mProj, m_mView, m_mModel);
+        m_hoveredPolylines.paintGL(m_mProj, m_mView, m_mModel);
+        m_polygons.paintHighlightGL(m_mProj, m_mView, m_mModel);
         glLineWidth(1);
     }
 
     void loadGLObjects() override;
     void loadGLObjectsRequiringGLContext() override{};
+    bool loadGLObjectsFromCache(const AGLVertexBufferCache &cache, const QString &prefix) override;
+    void storeGLObjectsToCache(AGLVertexBufferCache &cache, const QString &prefix) const override;
     void highlightHoveredItems(const QtRegion &region) override { highlightHoveredShapes(region); };
 
     void highlightHoveredShapes(const QtRegion &region);
+    void setSelectedKeys(const std::vector<int> &selectedKeys) override;
+
+    void enableRasterTiles(const QString &diskDirectory) override;
+    bool hasPendingWork() const override {
+        return m_tilePyramid && m_tilePyramid->hasPendingTiles();
+    }
+    void stopBackgroundWork() override {
+        if (m_tilePyramid)
+            m_tilePyramid->stop();
+    }
+
+    void setFilterRange(const QVector2D &filterRange) override {
+        // tiles are made without the filter
+        m_filtered = filterRange != AGLShapeValues::unfilteredRange();
+        m_lines.setFilterRange(filterRange);
+        m_polylines.setFilterRange(filterRange);
+        m_polygons.setFilterRange(filterRange);
+        m_points.setFilterRange(filterRange);
+    }
 
   protected:
+    // single-segment lines, polylines are kept as indexed strips
     AGLLines m_lines;
+    AGLIndexedLines m_polylines;
     AGLPolygons m_polygons;
     AGLRegularPolygons m_points;
     AGLLines m_hoveredShapes;
+    AGLIndexedLines m_hoveredPolylines;
+    // keys of the shapes in each object, in the order they were added (ascending)
+    std::vector<int> m_lineKeys;
+    std::vector<int> m_polylineKeys;
+    std::vector<int> m_polygonKeys;
+    std::vector<int> m_pointKeys;
+    // shape key to the polygon's index in m_polygons
+    std::map<int, size_t> m_polygonIndices;
+    std::vector<int> m_selectedKeys;
     const unsigned int m_pointSides;
     const float m_pointRadius;
 
   private:
+    void indexShapes();
+    void applySelection();
+    /** @brief Drops the tiles, for new colours given in the order of the (ascending) keys */
+    void resetRasterTiles(const std::vector<int> &shapeKeys, const std::vector<PafColor> &colours);
+    bool rasteriseShapes(QPainter &painter, const QtRegion &region);
+    /** @brief Draws the shapes from tiles where possible, returns false if it can not */
+    bool paintRasterTiles(const QMatrix4x4 &mProj, const QMatrix4x4 &mView,
+                          const QMatrix4x4 &mModel);
+
+    std::unique_ptr<AGLTilePyramid> m_tilePyramid;
+    QString m_tileDirectory;
+    // the colour each drawn shape is rasterised with, by key
+    std::unordered_map<int, QRgb> m_tileColours;
+    bool m_filtered = false;
+
     ShapeMap &m_shapeMap;
+    AGLShapeIndex &m_shapeIndex;
 };
@@ -3,49 +3,344 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "aglpolygons.h"
-#include "../func/aglutriangulator.h"
+#include "../func/agltriangulator.h"
+
+#include <QOpenGLContext>
+
+// colourOverride replaces the vertex colour when its alpha is non-zero (used by outlines)
+
+static const char *vertexShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec4 vertex;\n"
+    "in vec4 colour;\n"
+    "in float filterValue;\n"
+    "in float selected;\n"
+    "out vec4 col;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform vec2 filterRange;\n"
+    "uniform vec4 selectionColour;\n"
+    "uniform vec4 colourOverride;\n"
+    "void main() {\n"
+    "   col = colourOverride.a > 0.0 ? colourOverride\n"
+    "         : selected > 0.5 ? selectionColour : colour;\n"
+    "   gl_Position = projMatrix * mvMatrix * vertex;\n"
+    "   if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+    "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec4 col;\n"
+    "out highp vec4 fragColor;\n"
+    "void main() {\n"
+    "   fragColor = col;\n"
+    "}\n";
+
+static const char *vertexShaderSource = // auto-format hack
+    "attribute vec4 vertex;\n"
+    "attribute vec4 colour;\n"
+    "attribute float filterValue;\n"
+    "attribute float selected;\n"
+    "varying vec4 col;\n"
+    "uniform mat4 projMatrix;\n"
+    "uniform mat4 mvMatrix;\n"
+    "uniform vec2 filterRange;\n"
+    "uniform vec4 selectionColour;\n"
+    "uniform vec4 colourOverride;\n"
+    "void main() {\n"
+    "   col = colourOverride.a > 0.0 ? colourOverride\n"
+    "         : selected > 0.5 ? selectionColour : colour;\n"
+    "   gl_Position = projMatrix * mvMatrix * vertex;\n"
+    "   if (filterValue < filterRange.x || filterValue > filterRange.y)\n"
+    "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSource = // auto-format hack
+    "varying highp vec4 col;\n"
+    "void main() {\n"
+    "   gl_FragColor = col;\n"
+    "}\n";
 
 /**
  * @brief GLPolygons::GLPolygons
- * This class is an OpenGL representation of multiple polygons of different colour
+ * This class is an OpenGL representation of multiple polygons of different colour.
+ * Triangulations are taken from the triangulation cache when one is set
  */
 
+AGLPolygons::AGLPolygons() : m_program(0) {}
+
 void AGLPolygons::loadPolygonData(
-    const std::vector<std::pair<std::vector<Point2f>, PafColor>> &colouredPolygons) {
-    m_polygons.clear();
+    const std::vector<std::pair<std::vector<Point2f>, PafColor>> &colouredPolygons,
+    const std::vector<float> &filterValues) {
+    m_built = false;
+    bool hasFilterValues = filterValues.size() == colouredPolygons.size();
+
+    size_t vertexCount = 0;
     for (auto &colouredPolygon : colouredPolygons) {
+        vertexCount += colouredPolygon.first.size();
+    }
+    m_data.clear();
+    m_fillIndices.clear();
+    m_outlineIndices.clear();
+    m_outlineRanges.clear();
+    m_highlightIndices.clear();
+    m_filterValues.clear();
+    m_selectionFlags.clear();
+    m_highlightChanged = true;
+    m_data.reserve(static_cast<qsizetype>(vertexCount));
+    m_fillIndices.reserve(static_cast<qsizetype>(vertexCount * 3));
+    m_outlineIndices.reserve(static_cast<qsizetype>(vertexCount + 2 * colouredPolygons.size()));
+    m_outlineRanges.reserve(static_cast<qsizetype>(2 * colouredPolygons.size()));
+    m_filterValues.reserve(colouredPolygons.size());
+
+    std::vector<unsigned int> indices;
+    for (size_t polygonIndex = 0; polygonIndex < colouredPolygons.size(); ++polygonIndex) {
+        const auto &colouredPolygon = colouredPolygons[polygonIndex];
         const std::vector<Point2f> &points = colouredPolygon.first;
         QRgb colour = qRgb(colouredPolygon.second.redb(), colouredPolygon.second.greenb(),
                            colouredPolygon.second.blueb());
 
-        m_polygons.push_back(std::unique_ptr<AGLTrianglesUniform>(new AGLTrianglesUniform));
+        indices.clear();
+        if (m_triangulationCache == nullptr) {
+            indices = AGLTriangulator::triangulate(points);
+        } else {
+            uint64_t hash = AGLTriangulationCache::contentHash(points);
+            if (!m_triangulationCache->find(hash, points, indices)) {
+                indices = AGLTriangulator::triangulate(points);
+                m_triangulationCache->insert(hash, points, indices);
+            }
+        }
 
-        std::vector<Point2f> triangulated = GLUTriangulator::triangulate(points);
-        m_polygons.back()->loadTriangleData(triangulated, colour);
+        GLuint baseVertex = static_cast<GLuint>(m_data.size());
+        for (auto &point : points) {
+            m_data.append(AGLColouredVertex(localX(point.x), localY(point.y), colour));
+        }
+        m_filterValues.append(hasFilterValues ? filterValues[polygonIndex] : 0.0f, points.size());
+        for (unsigned int index : indices) {
+            m_fillIndices.append(baseVertex + index);
+        }
+
+        // closed strip, the restart index is only added between polygons when highlighting
+        m_outlineRanges.append(static_cast<GLuint>(m_outlineIndices.size()));
+        for (GLuint i = 0; i < static_cast<GLuint>(points.size()); ++i) {
+            m_outlineIndices.append(baseVertex + i);
+        }
+        if (!points.empty())
+            m_outlineIndices.append(baseVertex);
+        m_outlineRanges.append(static_cast<GLuint>(m_outlineIndices.size()) -
+                               m_outlineRanges.back());
     }
 }
 
-void AGLPolygons::initializeGL(bool m_core) {
-    for (auto &polygon : m_polygons) {
-        polygon->initializeGL(m_core);
+void AGLPolygons::setHighlightedPolygons(const std::vector<size_t> &polygons,
+                                         const QRgb &colour) {
+    m_highlightIndices.clear();
+    for (size_t polygon : polygons) {
+        if (polygon >= polygonCount())
+            continue;
+        GLuint offset = m_outlineRanges[static_cast<qsizetype>(polygon * 2)];
+        GLuint count = m_outlineRanges[static_cast<qsizetype>(polygon * 2 + 1)];
+        if (!m_highlightIndices.isEmpty())
+            m_highlightIndices.append(AGLIndexedLines::RESTART_INDEX);
+        m_highlightIndices.append(m_outlineIndices.mid(offset, count));
     }
+    m_highlightColour = QVector4D(static_cast<float>(qRed(colour)) / 255.0f,
+                                  static_cast<float>(qGreen(colour)) / 255.0f,
+                                  static_cast<float>(qBlue(colour)) / 255.0f, 1.0f);
+    m_highlightChanged = true;
+}
+
+void AGLPolygons::setupVertexAttribs() {
+    m_vbo.bind();
+    AGLColouredVertex::setupVertexAttribs(QOpenGLContext::currentContext()->functions());
+    m_vbo.release();
+}
+
+void AGLPolygons::initializeGL(bool m_core) {
+    if (m_data.size() == 0)
+        return;
+    m_stripSupport = AGLIndexedLines::stripSupport();
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex,
+                                       m_core ? vertexShaderSourceCore : vertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                       m_core ? fragmentShaderSourceCore : fragmentShaderSource);
+    m_program->bindAttributeLocation("vertex", 0);
+    m_program->bindAttributeLocation("colour", 1);
+    m_program->bindAttributeLocation("filterValue", AGLShapeValues::FILTER_LOCATION);
+    m_program->bindAttributeLocation("selected", AGLShapeValues::SELECTION_LOCATION);
+    m_program->link();
+
+    m_program->bind();
+    m_projMatrixLoc = m_program->uniformLocation("projMatrix");
+    m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+    m_filterRangeLoc = m_program->uniformLocation("filterRange");
+    m_selectionColourLoc = m_program->uniformLocation("selectionColour");
+    m_colourOverrideLoc = m_program->uniformLocation("colourOverride");
+
+    m_vao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    m_vbo.create();
+    m_vbo.bind();
+    m_vbo.allocate(m_data.constData(),
+                   static_cast<int>(m_data.size()) * static_cast<int>(sizeof(AGLColouredVertex)));
+
+    setupVertexAttribs();
+    m_filterValues.initializeGL();
+    m_selectionFlags.initializeGL();
+
+    m_fillIbo.create();
+    m_fillIbo.bind();
+    m_fillIbo.allocate(m_fillIndices.constData(),
+                       static_cast<int>(m_fillIndices.size()) * static_cast<int>(sizeof(GLuint)));
+    m_fillIbo.release();
+
+    m_highlightIbo.create();
+    updateHighlightGL();
+
+    m_program->release();
+    m_built = true;
 }
 
 void AGLPolygons::updateGL(bool m_core) {
-    for (auto &polygon : m_polygons) {
-        polygon->updateGL(m_core);
+    if (m_program == 0) {
+        // has not been initialised yet, do that instead
+        initializeGL(m_core);
+    } else {
+        QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+        m_vbo.bind();
+        m_vbo.allocate(m_data.constData(), static_cast<int>(m_data.size()) *
+                                               static_cast<int>(sizeof(AGLColouredVertex)));
+        m_vbo.release();
+        m_filterValues.updateGL();
+        m_selectionFlags.updateGL();
+        m_fillIbo.bind();
+        m_fillIbo.allocate(m_fillIndices.constData(), static_cast<int>(m_fillIndices.size()) *
+                                                          static_cast<int>(sizeof(GLuint)));
+        m_fillIbo.release();
+        updateHighlightGL();
+        m_built = true;
     }
 }
 
-void AGLPolygons::cleanup() {
-    for (auto &polygon : m_polygons) {
-        polygon->cleanup();
+void AGLPolygons::updateHighlightGL() {
+    if (!m_highlightChanged || !m_highlightIbo.isCreated())
+        return;
+    m_highlightIbo.bind();
+    if (m_stripSupport == AGLIndexedLines::StripSupport::NONE) {
+        QVector<GLuint> lines = AGLIndexedLines::stripsToLines(m_highlightIndices);
+        m_highlightIbo.allocate(lines.constData(),
+                                static_cast<int>(lines.size()) * static_cast<int>(sizeof(GLuint)));
+        m_highlightDrawCount = static_cast<GLsizei>(lines.size());
+    } else {
+        m_highlightIbo.allocate(m_highlightIndices.constData(),
+                                static_cast<int>(m_highlightIndices.size()) *
+                                    static_cast<int>(sizeof(GLuint)));
+        m_highlightDrawCount = static_cast<GLsizei>(m_highlightIndices.size());
     }
+    m_highlightIbo.release();
+    m_highlightChanged = false;
+}
+
+void AGLPolygons::updateSelectionGL() {
+    if (m_program == 0)
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_selectionFlags.updateGL();
+}
+
+void AGLPolygons::cleanup() {
+    if (!m_built)
+        return;
+    m_vbo.destroy();
+    m_fillIbo.destroy();
+    m_highlightIbo.destroy();
+    m_filterValues.cleanup();
+    m_selectionFlags.cleanup();
+    delete m_program;
+    m_program = 0;
 }
 
 void AGLPolygons::paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView,
                           const QMatrix4x4 &m_mModel) {
-    for (auto &polygon : m_polygons) {
-        polygon->paintGL(m_mProj, m_mView, m_mModel);
+    if (!m_built)
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_projMatrixLoc, m_mProj);
+    m_program->setUniformValue(m_mvMatrixLoc, m_mView * m_mModel);
+    m_program->setUniformValue(m_colourOverrideLoc, QVector4D(0.0f, 0.0f, 0.0f, 0.0f));
+    m_program->setUniformValue(m_filterRangeLoc, m_filterRange);
+    m_program->setUniformValue(m_selectionColourLoc, m_selectionColour);
+    m_filterValues.bindForPaint();
+    m_selectionFlags.bindForPaint();
+
+    m_fillIbo.bind();
+    QOpenGLFunctions *glFuncs = QOpenGLContext::currentContext()->functions();
+    glFuncs->glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_fillIndices.size()),
+                            GL_UNSIGNED_INT, 0);
+    m_fillIbo.release();
+
+    m_program->release();
+}
+
+void AGLPolygons::paintHighlightGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView,
+                                   const QMatrix4x4 &m_mModel) {
+    if (!m_built || m_highlightDrawCount == 0)
+        return;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_projMatrixLoc, m_mProj);
+    m_program->setUniformValue(m_mvMatrixLoc, m_mView * m_mModel);
+    m_program->setUniformValue(m_colourOverrideLoc, m_highlightColour);
+    m_program->setUniformValue(m_filterRangeLoc, m_filterRange);
+    m_program->setUniformValue(m_selectionColourLoc, m_selectionColour);
+    m_filterValues.bindForPaint();
+    m_selectionFlags.bindForPaint();
+
+    m_highlightIbo.bind();
+    AGLIndexedLines::drawStrips(m_stripSupport, m_highlightDrawCount);
+    m_highlightIbo.release();
+
+    m_program->release();
+}
+
+bool AGLPolygons::loadFromCache(const AGLVertexBufferCache &cache, const QString &key) {
+    QVector<AGLColouredVertex> data;
+    QVector<GLuint> fillIndices;
+    QVector<GLuint> outlineIndices;
+    QVector<GLuint> outlineRanges;
+    if (!cache.read(key, data) || !cache.read(key + ".fill", fillIndices) ||
+        !cache.read(key + ".outline", outlineIndices) ||
+        !cache.read(key + ".outlineRanges", outlineRanges) || outlineRanges.size() % 2 != 0 ||
+        !AGLVertexBufferCache::indicesInRange(fillIndices, data.size()) ||
+        !AGLVertexBufferCache::indicesInRange(outlineIndices, data.size()))
+        return false;
+    for (qsizetype range = 0; range < outlineRanges.size(); range += 2) {
+        qsizetype offset = static_cast<qsizetype>(outlineRanges[range]);
+        qsizetype count = static_cast<qsizetype>(outlineRanges[range + 1]);
+        if (offset > outlineIndices.size() || count > outlineIndices.size() - offset)
+            return false;
     }
+    if (!m_filterValues.loadFromCache(cache, key) || m_filterValues.vertexCount() != data.size())
+        return false;
+    m_built = false;
+    m_selectionFlags.clear();
+    m_data = std::move(data);
+    m_fillIndices = std::move(fillIndices);
+    m_outlineIndices = std::move(outlineIndices);
+    m_outlineRanges = std::move(outlineRanges);
+    m_highlightIndices.clear();
+    m_highlightChanged = true;
+    return true;
+}
+
+void AGLPolygons::storeToCache(AGLVertexBufferCache &cache, const QString &key) const {
+    cache.write(key, m_data.constData(), m_data.size());
+    cache.write(key + ".fill", m_fillIndices.constData(), m_fillIndices.size());
+    cache.write(key + ".outline", m_outlineIndices.constData(), m_outlineIndices.size());
+    cache.write(key + ".outlineRanges", m_outlineRanges.constData(), m_outlineRanges.size());
+    m_filterValues.storeToCache(cache, key);
 }
@@ -4,9 +4,12 @@
 
 #pragma once
 
+#include "../base/aglshapevalues.h"
+#include "../base/aglindexedlines.h"
 #include "../base/aglobject.h"
+#include "../base/aglvertex.h"
 
-#include "../base/agltrianglesuniform.h"
+#include "../func/agltriangulationcache.h"
 
 #include "salalib/pafcolor.h"
 
@@ -16,24 +19,75 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLVertexArrayObject>
-#include <QVector3D>
+#include <QVector4D>
 #include <QVector>
 
-#include <memory>
-
 /**
- * @brief The GLPolygons class is a plain wrapper class for multiple GLPolygon
- * that acts as if it's a single globject
+ * @brief Multiple polygons of different colour. The vertices of all polygons are kept once
+ * in a single vertex buffer which is shared by the fill pass (triangle indices) and the
+ * outline pass (line strip indices). Outlines are only drawn for highlighted polygons.
  */
 class AGLPolygons : public AGLObject {
   public:
+    AGLPolygons();
+    /** @brief filterValues are optional, with one value per polygon */
     void
-    loadPolygonData(const std::vector<std::pair<std::vector<Point2f>, PafColor>> &colouredPolygons);
-    void paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView, const QMatrix4x4 &m_mModel);
-    void initializeGL(bool m_core);
-    void updateGL(bool m_core);
-    void cleanup();
+    loadPolygonData(const std::vector<std::pair<std::vector<Point2f>, PafColor>> &colouredPolygons,
+                    const std::vector<float> &filterValues = std::vector<float>());
+    void paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView,
+                 const QMatrix4x4 &m_mModel) override;
+    void paintHighlightGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView,
+                          const QMatrix4x4 &m_mModel);
+    void initializeGL(bool m_core) override;
+    void updateGL(bool m_core) override;
+    void updateHighlightGL();
+    void cleanup() override;
+    void setTriangulationCache(AGLTriangulationCache *cache) { m_triangulationCache = cache; }
+    void setHighlightedPolygons(const std::vector<size_t> &polygons, const QRgb &colour);
+    void setFilterRange(const QVector2D &filterRange) { m_filterRange = filterRange; }
+    /** @brief One flag per shape in the order they were added, 1 draws it as selected */
+    void setSelectedShapes(const std::vector<float> &flags) {
+        m_selectionFlags.assign(flags, m_filterValues.getShapeVertexCounts());
+    }
+    /** @brief Uploads the selection flags alone, the vertices are left as they are */
+    void updateSelectionGL();
+    size_t shapeCount() const { return m_filterValues.shapeCount(); }
+    size_t polygonCount() const { return static_cast<size_t>(m_outlineRanges.size() / 2); }
+    bool loadFromCache(const AGLVertexBufferCache &cache, const QString &key);
+    void storeToCache(AGLVertexBufferCache &cache, const QString &key) const;
+    AGLPolygons(const AGLPolygons &) = delete;
+    AGLPolygons &operator=(const AGLPolygons &) = delete;
 
   private:
-    std::vector<std::unique_ptr<AGLTrianglesUniform>> m_polygons;
+    void setupVertexAttribs();
+
+    AGLTriangulationCache *m_triangulationCache = nullptr;
+
+    QVector<AGLColouredVertex> m_data;
+    AGLShapeValues m_filterValues{AGLShapeValues::FILTER_LOCATION};
+    AGLShapeValues m_selectionFlags{AGLShapeValues::SELECTION_LOCATION,
+                                    AGLShapeValues::Type::FLAG};
+    QVector2D m_filterRange = AGLShapeValues::unfilteredRange();
+    QVector4D m_selectionColour = QVector4D(1.0f, 1.0f, 0.0f, 1.0f);
+    QVector<GLuint> m_fillIndices;
+    // strips of all polygon outlines, and the (offset, count) of each polygon in them
+    QVector<GLuint> m_outlineIndices;
+    QVector<GLuint> m_outlineRanges;
+    QVector<GLuint> m_highlightIndices;
+    GLsizei m_highlightDrawCount = 0;
+    QVector4D m_highlightColour = QVector4D(1.0f, 1.0f, 0.0f, 1.0f);
+    bool m_highlightChanged = false;
+    bool m_built = false;
+    AGLIndexedLines::StripSupport m_stripSupport = AGLIndexedLines::StripSupport::NONE;
+
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vbo;
+    QOpenGLBuffer m_fillIbo = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    QOpenGLBuffer m_highlightIbo = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    QOpenGLShaderProgram *m_program;
+    int m_projMatrixLoc;
+    int m_mvMatrixLoc;
+    int m_colourOverrideLoc;
+    int m_filterRangeLoc;
+    int m_selectionColourLoc;
 };
@@ -8,7 +8,8 @@
 
 void AGLRegularPolygons::loadPolygonData(
     const std::vector<std::pair<Point2f, PafColor>> &colouredPoints, const unsigned int sides,
-    const float radius) {
+    const float radius, const std::vector<float> &filterValues) {
+    bool hasFilterValues = filterValues.size() == colouredPoints.size();
     init(static_cast<int>(colouredPoints.size() * static_cast<size_t>(sides) * 3));
     std::vector<Point2f> points(sides * 3);
     float angle = static_cast<float>(2 * M_PI / sides);
@@ -21,20 +22,20 @@ void AGLRegularPolygons::loadPolygonData(
     }
 
     Point2f prevCentre(0, 0);
-    for (const auto &colouredPoint : colouredPoints) {
+    for (size_t pointIndex = 0; pointIndex < colouredPoints.size(); ++pointIndex) {
+        const auto &colouredPoint = colouredPoints[pointIndex];
         const Point2f &centre = colouredPoint.first;
-        float r = colouredPoint.second.redf();
-        float g = colouredPoint.second.greenf();
-        float b = colouredPoint.second.bluef();
+        QRgb colour = qRgb(colouredPoint.second.redb(), colouredPoint.second.greenb(),
+                           colouredPoint.second.blueb());
 
         for (Point2f &point : points) {
             point.x -= prevCentre.x;
             point.y -= prevCentre.y;
             point.x += centre.x;
             point.y += centre.y;
-            add(QVector3D(static_cast<float>(point.x), static_cast<float>(point.y), 0.0f),
-                QVector3D(r, g, b));
+            add(point, colour);
         }
+        addFilterValue(hasFilterValues ? filterValues[pointIndex] : 0.0f, points.size());
         prevCentre = centre;
     }
 }
@@ -26,6 +26,8 @@
  */
 class AGLRegularPolygons : public AGLTriangles {
   public:
+    /** @brief filterValues are optional, with one value per point */
     void loadPolygonData(const std::vector<std::pair<Point2f, PafColor>> &colouredPoints,
-                         const unsigned int sides, const float radius);
+                         const unsigned int sides, const float radius,
+                         const std::vector<float> &filterValues = std::vector<float>());
 };
@@ -0,0 +1,99 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglcolourmapper.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+
+// values per task, below this the column is mapped on the calling thread
+static const size_t MAP_CHUNK_SIZE = 1 << 16;
+
+AGLColourMapper::AGLColourMapper(const DisplayParams &displayParams) {
+    m_ramp.resize(RAMP_SIZE);
+    for (int i = 0; i < RAMP_SIZE; ++i) {
+        m_ramp[static_cast<size_t>(i)] =
+            PafColor().makeColor(static_cast<double>(i) / (RAMP_SIZE - 1), displayParams);
+    }
+    m_noValueColour = PafColor().makeColor(-1.0, displayParams);
+}
+
+void AGLColourMapper::mapRange(const float *values, size_t count, PafColor *colours,
+                               float offset, float scale) const {
+    // kept free of branches so that it can be vectorised, the comparisons below become
+    // selects and also take care of NaN
+    const PafColor *ramp = m_ramp.data();
+    for (size_t i = 0; i < count; ++i) {
+        float value = values[i];
+        float normalised = (value - offset) * scale;
+        normalised = normalised > 0.0f ? normalised : 0.0f;
+        normalised = normalised < 1.0f ? normalised : 1.0f;
+        const PafColor &colour = ramp[static_cast<int>(normalised * (RAMP_SIZE - 1) + 0.5f)];
+        colours[i] = value == -1.0f ? m_noValueColour : colour;
+    }
+}
+
+void AGLColourMapper::map(const float *values, size_t count, PafColor *colours, float offset,
+                          float scale) const {
+    if (count <= MAP_CHUNK_SIZE) {
+        mapRange(values, count, colours, offset, scale);
+        return;
+    }
+    std::vector<size_t> chunkStarts;
+    for (size_t start = 0; start < count; start += MAP_CHUNK_SIZE) {
+        chunkStarts.push_back(start);
+    }
+    QtConcurrent::blockingMap(chunkStarts, [&](size_t start) {
+        mapRange(values + start, std::min(MAP_CHUNK_SIZE, count - start), colours + start,
+                 offset, scale);
+    });
+}
+
+std::vector<PafColor> AGLColourMapper::getDisplayColours(AttributeTable &attributes,
+                                                         const AttributeTableHandle &tableHandle,
+                                                         const std::vector<int> &keys,
+                                                         std::vector<float> *normalisedValues) {
+    std::vector<PafColor> colours(keys.size());
+    int displayColumn = tableHandle.getDisplayColIndex();
+    if (displayColumn < 0) {
+        // the reference number is displayed, it has no column to map
+        for (size_t i = 0; i < keys.size(); ++i) {
+            AttributeKey key(keys[i]);
+            colours[i] = dXreimpl::getDisplayColor(key, attributes.getRow(key), tableHandle, true);
+        }
+        if (normalisedValues != nullptr) {
+            normalisedValues->assign(keys.size(), 0.0f);
+            auto keyRange = std::minmax_element(keys.begin(), keys.end());
+            if (keyRange.first != keys.end() && *keyRange.second > *keyRange.first) {
+                float minKey = static_cast<float>(*keyRange.first);
+                float keySpan = static_cast<float>(*keyRange.second) - minKey;
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    (*normalisedValues)[i] = (static_cast<float>(keys[i]) - minKey) / keySpan;
+                }
+            }
+        }
+        return colours;
+    }
+
+    size_t column = static_cast<size_t>(displayColumn);
+    std::vector<float> values(keys.size());
+    std::vector<size_t> selected;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const AttributeRow &row = attributes.getRow(AttributeKey(keys[i]));
+        values[i] = row.getNormalisedValue(column);
+        if (row.isSelected())
+            selected.push_back(i);
+    }
+    AGLColourMapper(attributes.getColumn(column).getDisplayParams())
+        .map(values.data(), values.size(), colours.data());
+    if (normalisedValues != nullptr)
+        *normalisedValues = std::move(values);
+    // selections are few, leave their colour to salalib
+    for (size_t i : selected) {
+        AttributeKey key(keys[i]);
+        colours[i] = dXreimpl::getDisplayColor(key, attributes.getRow(key), tableHandle, true);
+    }
+    return colours;
+}
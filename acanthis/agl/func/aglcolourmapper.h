@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "salalib/attributetable.h"
+#include "salalib/attributetablehelpers.h"
+#include "salalib/attributetableview.h"
+#include "salalib/pafcolor.h"
+
+#include <vector>
+
+/**
+ * @brief Maps columns of values to colours in one pass. The colour ramp of the display
+ * parameters is sampled once into a lookup table, so each value only costs a clamp and a
+ * table read instead of a call into PafColor::makeColor. Large columns are split across
+ * the thread pool.
+ */
+class AGLColourMapper {
+  public:
+    static const int RAMP_SIZE = 4096;
+
+    explicit AGLColourMapper(const DisplayParams &displayParams);
+
+    /**
+     * @brief Writes the colour of each value, after normalising it as (value - offset) * scale.
+     * Values of -1 are "no value" and get the colour of the ramp for it
+     */
+    void map(const float *values, size_t count, PafColor *colours, float offset = 0.0f,
+             float scale = 1.0f) const;
+
+    /**
+     * @brief Display colours of the given rows of a table, the same as calling
+     * dXreimpl::getDisplayColor (with the selection status) for each of them. If given,
+     * normalisedValues receives the value of each row that the colour was taken from,
+     * between 0 and 1 or -1 for "no value"
+     */
+    static std::vector<PafColor> getDisplayColours(AttributeTable &attributes,
+                                                   const AttributeTableHandle &tableHandle,
+                                                   const std::vector<int> &keys,
+                                                   std::vector<float> *normalisedValues = nullptr);
+
+  private:
+    void mapRange(const float *values, size_t count, PafColor *colours, float offset,
+                  float scale) const;
+
+    std::vector<PafColor> m_ramp;
+    PafColor m_noValueColour;
+};
@@ -0,0 +1,123 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglgraphconnections.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+
+// nodes per task
+static const size_t NODE_CHUNK_SIZE = 1 << 14;
+
+template <typename F> static void forEachNodeChunk(size_t nodeCount, F f) {
+    if (nodeCount <= NODE_CHUNK_SIZE) {
+        f(0, nodeCount);
+        return;
+    }
+    std::vector<size_t> chunkStarts;
+    for (size_t start = 0; start < nodeCount; start += NODE_CHUNK_SIZE) {
+        chunkStarts.push_back(start);
+    }
+    QtConcurrent::blockingMap(chunkStarts, [&](size_t start) {
+        f(start, std::min(nodeCount, start + NODE_CHUNK_SIZE));
+    });
+}
+
+AGLGraphConnections::AGLGraphConnections(ShapeGraph &shapeGraph) {
+    const std::vector<Connector> &connectors = shapeGraph.getConnections();
+    const auto &allShapes = shapeGraph.getAllShapes();
+    // the connectors are in the order of the shapes
+    size_t nodeCount = std::min(connectors.size(), allShapes.size());
+    std::vector<const SalaShape *> shapes;
+    shapes.reserve(nodeCount);
+    m_nodeKeys.reserve(nodeCount);
+    for (const auto &keyShape : allShapes) {
+        if (shapes.size() == nodeCount)
+            break;
+        if (keyShape.first != static_cast<int>(shapes.size()))
+            m_keysAreNodes = false;
+        m_nodeKeys.push_back(keyShape.first);
+        shapes.push_back(&keyShape.second);
+    }
+
+    // first pass: centroids and the number of edges of each node, the edges of a node
+    // are only known to be valid once their target is found
+    m_centroids.resize(nodeCount);
+    m_offsets.assign(nodeCount + 1, 0);
+    forEachNodeChunk(nodeCount, [&](size_t begin, size_t end) {
+        for (size_t node = begin; node < end; ++node) {
+            m_centroids[node] = shapes[node]->getCentroid();
+            const Connector &connector = connectors[node];
+            uint32_t count = 0;
+            for (size_t connection : connector.m_connections) {
+                count += findNode(static_cast<int>(connection)) < nodeCount;
+            }
+            for (auto &segConn : connector.m_forward_segconns) {
+                count += findNode(segConn.first.ref) < nodeCount;
+            }
+            for (auto &segConn : connector.m_back_segconns) {
+                count += findNode(segConn.first.ref) < nodeCount;
+            }
+            m_offsets[node + 1] = count;
+        }
+    });
+    for (size_t node = 0; node < nodeCount; ++node) {
+        m_offsets[node + 1] += m_offsets[node];
+    }
+
+    // second pass: each node writes its own range of the edge arrays
+    m_targets.resize(m_offsets.back());
+    m_intersections.resize(m_offsets.back());
+    forEachNodeChunk(nodeCount, [&](size_t begin, size_t end) {
+        for (size_t node = begin; node < end; ++node) {
+            const Connector &connector = connectors[node];
+            const Line &fromLine = shapes[node]->getLine();
+            size_t edge = m_offsets[node];
+            for (size_t connection : connector.m_connections) {
+                size_t target = findNode(static_cast<int>(connection));
+                if (target >= nodeCount)
+                    continue;
+                m_targets[edge] = static_cast<uint32_t>(target);
+                m_intersections[edge] = intersection_point(fromLine, shapes[target]->getLine());
+                ++edge;
+            }
+            // segments meet at the end of the target the connection leaves from
+            for (const auto *segConns : {&connector.m_forward_segconns,
+                                         &connector.m_back_segconns}) {
+                for (auto &segConn : *segConns) {
+                    size_t target = findNode(segConn.first.ref);
+                    if (target >= nodeCount)
+                        continue;
+                    const Line &toLine = shapes[target]->getLine();
+                    m_targets[edge] = static_cast<uint32_t>(target);
+                    m_intersections[edge] =
+                        segConn.first.dir != -1 ? toLine.start() : toLine.end();
+                    ++edge;
+                }
+            }
+        }
+    });
+}
+
+size_t AGLGraphConnections::findNode(int key) const {
+    if (m_keysAreNodes)
+        return key >= 0 && static_cast<size_t>(key) < m_nodeKeys.size() ? static_cast<size_t>(key)
+                                                                         : m_nodeKeys.size();
+    auto nodeKey = std::lower_bound(m_nodeKeys.begin(), m_nodeKeys.end(), key);
+    if (nodeKey == m_nodeKeys.end() || *nodeKey != key)
+        return m_nodeKeys.size();
+    return static_cast<size_t>(nodeKey - m_nodeKeys.begin());
+}
+
+std::vector<int> AGLGraphConnections::getConnectedKeys(int key) const {
+    std::vector<int> keys;
+    size_t node = findNode(key);
+    if (node >= nodeCount())
+        return keys;
+    for (size_t edge = getEdgesBegin(node); edge < getEdgesEnd(node); ++edge) {
+        keys.push_back(m_nodeKeys[m_targets[edge]]);
+    }
+    return keys;
+}
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "salalib/shapegraph.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The connections of a shape graph flattened into compressed sparse rows. The nodes
+ * are the shapes in key order and the edges of node i are [getEdgesBegin(i), getEdgesEnd(i))
+ * of the target and intersection arrays. Connections to shapes that do not exist are dropped.
+ * Extracted once per load, with the nodes split across the thread pool, so that the overlay
+ * and any graph queries do not go back to the shape map for every edge.
+ */
+class AGLGraphConnections {
+  public:
+    AGLGraphConnections() {}
+    explicit AGLGraphConnections(ShapeGraph &shapeGraph);
+
+    size_t nodeCount() const { return m_nodeKeys.size(); }
+    size_t edgeCount() const { return m_targets.size(); }
+    int getNodeKey(size_t node) const { return m_nodeKeys[node]; }
+    /** @brief Node of the shape with the key, nodeCount() if there is none */
+    size_t findNode(int key) const;
+    const Point2f &getCentroid(size_t node) const { return m_centroids[node]; }
+    size_t getEdgesBegin(size_t node) const { return m_offsets[node]; }
+    size_t getEdgesEnd(size_t node) const { return m_offsets[node + 1]; }
+    size_t getTarget(size_t edge) const { return m_targets[edge]; }
+    /** @brief Where the two shapes of the edge meet */
+    const Point2f &getIntersection(size_t edge) const { return m_intersections[edge]; }
+    /** @brief Keys of the shapes connected to the one with the key */
+    std::vector<int> getConnectedKeys(int key) const;
+
+  private:
+    std::vector<int> m_nodeKeys;
+    // the keys are the node indices, as in most axial and segment maps
+    bool m_keysAreNodes = true;
+    std::vector<Point2f> m_centroids;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_targets;
+    std::vector<Point2f> m_intersections;
+};
@@ -0,0 +1,329 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglimagestreamwriter.h"
+
+#include <QFileInfo>
+#include <QThread>
+#include <QtEndian>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+    void appendBigEndian32(QByteArray &data, quint32 value) {
+        char bytes[4];
+        qToBigEndian(value, bytes);
+        data.append(bytes, 4);
+    }
+
+    void appendLittleEndian16(QByteArray &data, quint16 value) {
+        char bytes[2];
+        qToLittleEndian(value, bytes);
+        data.append(bytes, 2);
+    }
+
+    void appendLittleEndian32(QByteArray &data, quint32 value) {
+        char bytes[4];
+        qToLittleEndian(value, bytes);
+        data.append(bytes, 4);
+    }
+
+    const quint16 TIFF_SHORT = 3;
+    const quint16 TIFF_LONG = 4;
+
+    void appendTiffEntry(QByteArray &directory, quint16 tag, quint16 type, quint32 count,
+                         quint32 value) {
+        appendLittleEndian16(directory, tag);
+        appendLittleEndian16(directory, type);
+        appendLittleEndian32(directory, count);
+        // a single short sits in the first two bytes of the field, which in little endian is
+        // where the low half of the long goes
+        appendLittleEndian32(directory, value);
+    }
+} // namespace
+
+AGLImageStreamWriter::AGLImageStreamWriter(const QString &fileName, const QSize &size,
+                                           int tileSize)
+    : m_file(fileName), m_size(size), m_tileSize(tileSize) {
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    m_format = suffix == "tif" || suffix == "tiff" ? Format::TIFF : Format::PNG;
+    m_pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+}
+
+AGLImageStreamWriter::~AGLImageStreamWriter() {
+    // the workers use the members declared after the pool
+    m_pool.waitForDone();
+}
+
+bool AGLImageStreamWriter::open() {
+    if (m_size.isEmpty() || m_tileSize <= 0 || !m_file.open(QIODevice::WriteOnly))
+        return false;
+    QByteArray header;
+    if (m_format == Format::PNG) {
+        header.append("\x89PNG\r\n\x1a\n", 8);
+        write(header);
+        QByteArray imageHeader;
+        appendBigEndian32(imageHeader, static_cast<quint32>(m_size.width()));
+        appendBigEndian32(imageHeader, static_cast<quint32>(m_size.height()));
+        // 8 bits per sample, RGB, deflate, adaptive filtering (each row says "none"), no
+        // interlacing
+        imageHeader.append("\x08\x02\x00\x00\x00", 5);
+        writePngChunk("IHDR", imageHeader);
+    } else {
+        // little endian, the offset of the directory is filled in once it is written
+        header.append("II", 2);
+        appendLittleEndian16(header, 42);
+        appendLittleEndian32(header, 0);
+        write(header);
+    }
+    return !m_failed;
+}
+
+void AGLImageStreamWriter::addTile(const QImage &tile) {
+    QImage rgb = tile.format() == QImage::Format_RGB888
+                     ? tile
+                     : tile.convertToFormat(QImage::Format_RGB888);
+    int tilesAcross = (m_size.width() + m_tileSize - 1) / m_tileSize;
+    int tilesDown = (m_size.height() + m_tileSize - 1) / m_tileSize;
+    int column = m_tilesAdded % tilesAcross;
+    int row = m_tilesAdded / tilesAcross;
+    if (row >= tilesDown)
+        return;
+    ++m_tilesAdded;
+    int width = std::min(rgb.width(), m_size.width() - column * m_tileSize);
+    int height = std::min(rgb.height(), m_size.height() - row * m_tileSize);
+    qsizetype copyBytes = static_cast<qsizetype>(width) * 3;
+
+    if (m_format == Format::TIFF) {
+        // tiles at the edges are padded to the full size
+        qsizetype tileRowBytes = static_cast<qsizetype>(m_tileSize) * 3;
+        QByteArray raw(tileRowBytes * m_tileSize, '\0');
+        for (int y = 0; y < height; ++y) {
+            std::memcpy(raw.data() + y * tileRowBytes, rgb.constScanLine(y),
+                        static_cast<size_t>(copyBytes));
+        }
+        submit(std::move(raw), m_tilesAdded == tilesAcross * tilesDown);
+        return;
+    }
+
+    // each row starts with its filter type, 0 (none)
+    qsizetype rowBytes = 1 + static_cast<qsizetype>(m_size.width()) * 3;
+    int bandHeight = std::min(m_tileSize, m_size.height() - row * m_tileSize);
+    if (column == 0)
+        m_band = QByteArray(rowBytes * bandHeight, '\0');
+    qsizetype columnOffset = 1 + static_cast<qsizetype>(column) * m_tileSize * 3;
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(m_band.data() + y * rowBytes + columnOffset, rgb.constScanLine(y),
+                    static_cast<size_t>(copyBytes));
+    }
+    if (column < tilesAcross - 1)
+        return;
+    bool lastBand = row == tilesDown - 1;
+    for (int firstRow = 0; firstRow < bandHeight; firstRow += PNG_ROWS_PER_PART) {
+        int rows = std::min(PNG_ROWS_PER_PART, bandHeight - firstRow);
+        submit(m_band.mid(firstRow * rowBytes, rows * rowBytes),
+               lastBand && firstRow + rows == bandHeight);
+    }
+    m_band.clear();
+}
+
+bool AGLImageStreamWriter::finish() {
+    m_pool.waitForDone();
+    int tilesAcross = (m_size.width() + m_tileSize - 1) / m_tileSize;
+    int tilesDown = (m_size.height() + m_tileSize - 1) / m_tileSize;
+    if (m_tilesAdded != tilesAcross * tilesDown)
+        m_failed = true;
+    if (!m_failed) {
+        if (m_format == Format::PNG) {
+            // the stream ends with the checksum of everything in it, pieced together from
+            // the checksums of the parts
+            QByteArray checksum;
+            appendBigEndian32(checksum, m_adler);
+            writePngChunk("IDAT", checksum);
+            writePngChunk("IEND", QByteArray());
+        } else {
+            writeTiffDirectory();
+        }
+    }
+    m_file.close();
+    return !m_failed && m_file.error() == QFileDevice::NoError;
+}
+
+void AGLImageStreamWriter::submit(QByteArray raw, bool last) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_partWritten.wait(lock,
+                       [this]() { return m_partsSubmitted - m_partsWritten < MAX_PENDING_PARTS; });
+    int index = m_partsSubmitted++;
+    lock.unlock();
+    bool png = m_format == Format::PNG;
+    m_pool.start([this, index, raw = std::move(raw), png, last]() {
+        partDone(index, png ? deflateBand(raw, index == 0, last) : compressTile(raw));
+    });
+}
+
+void AGLImageStreamWriter::partDone(int index, Part part) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_donePending.emplace(index, std::move(part));
+    for (auto next = m_donePending.find(m_partsWritten); next != m_donePending.end();
+         next = m_donePending.find(m_partsWritten)) {
+        writePart(next->second);
+        m_donePending.erase(next);
+        ++m_partsWritten;
+    }
+    m_partWritten.notify_all();
+}
+
+void AGLImageStreamWriter::writePart(const Part &part) {
+    if (!part.valid) {
+        m_failed = true;
+        return;
+    }
+    if (m_format == Format::PNG) {
+        m_adler = static_cast<quint32>(
+            adler32_combine(m_adler, part.adler, static_cast<z_off_t>(part.length)));
+        writePngChunk("IDAT", part.data);
+        return;
+    }
+    // classic TIFF only has 32 bit offsets
+    qint64 offset = m_file.pos();
+    if (offset + part.data.size() > std::numeric_limits<quint32>::max()) {
+        m_failed = true;
+        return;
+    }
+    m_tileOffsets.push_back(static_cast<quint32>(offset));
+    m_tileByteCounts.push_back(static_cast<quint32>(part.data.size()));
+    write(part.data);
+}
+
+void AGLImageStreamWriter::write(const QByteArray &data) {
+    if (m_file.write(data) != data.size())
+        m_failed = true;
+}
+
+void AGLImageStreamWriter::writePngChunk(const char *type, const QByteArray &data) {
+    QByteArray header;
+    appendBigEndian32(header, static_cast<quint32>(data.size()));
+    header.append(type, 4);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data.constData()),
+                static_cast<uInt>(data.size()));
+    QByteArray trailer;
+    appendBigEndian32(trailer, static_cast<quint32>(crc));
+    write(header);
+    write(data);
+    write(trailer);
+}
+
+void AGLImageStreamWriter::writeTiffDirectory() {
+    // the directory and the values that do not fit in it go after the tiles
+    if (m_file.pos() % 2 != 0)
+        write(QByteArray(1, '\0'));
+    QByteArray values;
+    quint32 valuesOffset = static_cast<quint32>(m_file.pos());
+    quint32 bitsPerSampleOffset = valuesOffset;
+    for (int sample = 0; sample < 3; ++sample) {
+        appendLittleEndian16(values, 8);
+    }
+    quint32 tileCount = static_cast<quint32>(m_tileOffsets.size());
+    quint32 tileOffsets = m_tileOffsets.front();
+    quint32 tileByteCounts = m_tileByteCounts.front();
+    if (tileCount > 1) {
+        tileOffsets = valuesOffset + static_cast<quint32>(values.size());
+        for (quint32 offset : m_tileOffsets) {
+            appendLittleEndian32(values, offset);
+        }
+        tileByteCounts = valuesOffset + static_cast<quint32>(values.size());
+        for (quint32 byteCount : m_tileByteCounts) {
+            appendLittleEndian32(values, byteCount);
+        }
+    }
+    qint64 directoryOffset = valuesOffset + values.size();
+    if (directoryOffset + 256 > std::numeric_limits<quint32>::max()) {
+        m_failed = true;
+        return;
+    }
+    write(values);
+
+    // entries in increasing order of tag
+    QByteArray directory;
+    appendLittleEndian16(directory, 11);
+    quint32 width = static_cast<quint32>(m_size.width());
+    quint32 height = static_cast<quint32>(m_size.height());
+    quint32 tileSize = static_cast<quint32>(m_tileSize);
+    appendTiffEntry(directory, 256, TIFF_LONG, 1, width);
+    appendTiffEntry(directory, 257, TIFF_LONG, 1, height);
+    appendTiffEntry(directory, 258, TIFF_SHORT, 3, bitsPerSampleOffset);
+    // compression: deflate (Adobe)
+    appendTiffEntry(directory, 259, TIFF_SHORT, 1, 8);
+    // photometric interpretation: RGB
+    appendTiffEntry(directory, 262, TIFF_SHORT, 1, 2);
+    // samples per pixel
+    appendTiffEntry(directory, 277, TIFF_SHORT, 1, 3);
+    // planar configuration: interleaved
+    appendTiffEntry(directory, 284, TIFF_SHORT, 1, 1);
+    appendTiffEntry(directory, 322, TIFF_LONG, 1, tileSize);
+    appendTiffEntry(directory, 323, TIFF_LONG, 1, tileSize);
+    appendTiffEntry(directory, 324, TIFF_LONG, tileCount, tileOffsets);
+    appendTiffEntry(directory, 325, TIFF_LONG, tileCount, tileByteCounts);
+    // no further directories
+    appendLittleEndian32(directory, 0);
+    write(directory);
+
+    QByteArray directoryOffsetBytes;
+    appendLittleEndian32(directoryOffsetBytes, static_cast<quint32>(directoryOffset));
+    if (!m_file.seek(4))
+        m_failed = true;
+    write(directoryOffsetBytes);
+}
+
+AGLImageStreamWriter::Part AGLImageStreamWriter::deflateBand(const QByteArray &raw, bool first,
+                                                             bool last) {
+    Part part;
+    part.adler = static_cast<quint32>(adler32(adler32(0L, Z_NULL, 0),
+                                              reinterpret_cast<const Bytef *>(raw.constData()),
+                                              static_cast<uInt>(raw.size())));
+    part.length = raw.size();
+
+    // raw deflate, the zlib header is added to the first part and the checksum after the last
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return part;
+    if (first)
+        part.data.append("\x78\x9c", 2);
+    qsizetype headerSize = part.data.size();
+    // the bound is for a finished stream, a full flush adds an empty stored block on top
+    part.data.resize(headerSize +
+                     static_cast<qsizetype>(deflateBound(&stream, static_cast<uLong>(raw.size()))) +
+                     16);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(raw.constData()));
+    stream.avail_in = static_cast<uInt>(raw.size());
+    stream.next_out = reinterpret_cast<Bytef *>(part.data.data() + headerSize);
+    stream.avail_out = static_cast<uInt>(part.data.size() - headerSize);
+    // a full flush ends the part on a byte boundary with nothing referring back into it, so
+    // that the parts compressed apart join into one stream
+    int result = deflate(&stream, last ? Z_FINISH : Z_FULL_FLUSH);
+    part.valid = last ? result == Z_STREAM_END
+                      : result == Z_OK && stream.avail_in == 0 && stream.avail_out > 0;
+    part.data.resize(headerSize + static_cast<qsizetype>(stream.total_out));
+    deflateEnd(&stream);
+    return part;
+}
+
+AGLImageStreamWriter::Part AGLImageStreamWriter::compressTile(const QByteArray &raw) {
+    Part part;
+    uLongf compressedSize = compressBound(static_cast<uLong>(raw.size()));
+    part.data.resize(static_cast<qsizetype>(compressedSize));
+    part.valid = compress2(reinterpret_cast<Bytef *>(part.data.data()), &compressedSize,
+                           reinterpret_cast<const Bytef *>(raw.constData()),
+                           static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) == Z_OK;
+    part.data.resize(static_cast<qsizetype>(compressedSize));
+    return part;
+}
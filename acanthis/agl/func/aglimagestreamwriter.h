@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QFile>
+#include <QImage>
+#include <QThreadPool>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Writes an image too large to be held in memory from tiles given one at a time, left
+ * to right and top to bottom. The format is picked by the suffix of the file: tiled TIFF
+ * (.tif, .tiff) with each tile compressed on its own, or PNG with the rows cut in bands of
+ * PNG_ROWS_PER_PART that are compressed on their own and joined into one deflate stream. The
+ * parts are compressed on worker threads and written in order as they are done. At most
+ * MAX_PENDING_PARTS are held at a time, addTile() waits for the file to catch up otherwise.
+ * For TIFF this bounds the memory whatever the size of the image, for PNG it grows with the
+ * width only.
+ */
+class AGLImageStreamWriter {
+  public:
+    static const int MAX_PENDING_PARTS = 8;
+    static const int PNG_ROWS_PER_PART = 64;
+
+    AGLImageStreamWriter(const QString &fileName, const QSize &size, int tileSize);
+    ~AGLImageStreamWriter();
+
+    bool open();
+    /**
+     * @brief Adds the next tile, RGB888 and of the size of the part of the image it covers
+     * (smaller than tileSize at the right and bottom edges)
+     */
+    void addTile(const QImage &tile);
+    /** @brief Waits for everything to be written, false if any of it failed */
+    bool finish();
+
+    AGLImageStreamWriter(const AGLImageStreamWriter &) = delete;
+    AGLImageStreamWriter &operator=(const AGLImageStreamWriter &) = delete;
+
+  private:
+    enum class Format { PNG, TIFF };
+
+    struct Part {
+        QByteArray data;
+        bool valid = false;
+        // of the uncompressed data, only for PNG
+        quint32 adler = 1;
+        qint64 length = 0;
+    };
+
+    void submit(QByteArray raw, bool last);
+    void partDone(int index, Part part);
+    void writePart(const Part &part);
+    void write(const QByteArray &data);
+    void writePngChunk(const char *type, const QByteArray &data);
+    void writeTiffDirectory();
+
+    static Part deflateBand(const QByteArray &raw, bool first, bool last);
+    static Part compressTile(const QByteArray &raw);
+
+    QFile m_file;
+    QSize m_size;
+    int m_tileSize;
+    Format m_format;
+    int m_tilesAdded = 0;
+    // the rows of the tiles being added, PNG only
+    QByteArray m_band;
+
+    QThreadPool m_pool;
+    std::mutex m_mutex;
+    std::condition_variable m_partWritten;
+    int m_partsSubmitted = 0;
+    int m_partsWritten = 0;
+    // done but waiting for an earlier part to be written first
+    std::map<int, Part> m_donePending;
+    bool m_failed = false;
+
+    // PNG: the checksum of the uncompressed stream so far
+    quint32 m_adler = 1;
+    // TIFF: where each tile went
+    std::vector<quint32> m_tileOffsets;
+    std::vector<quint32> m_tileByteCounts;
+};
@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglshapeindex.h"
+
+#include <QtConcurrent>
+
+void AGLShapeIndex::build() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // the previous build reads the same shapes, let it finish rather than race it
+    m_build.waitForFinished();
+    m_index = AGLSpatialIndex();
+    m_build = QtConcurrent::run([this]() {
+        const auto &shapes = m_shapeMap.getAllShapes();
+        std::vector<AGLSpatialIndex::Box> boxes;
+        std::vector<int> keys;
+        boxes.reserve(shapes.size());
+        keys.reserve(shapes.size());
+        for (const auto &keyShape : shapes) {
+            const SalaShape &shape = keyShape.second;
+            if (shape.isPoint()) {
+                const Point2f centroid = shape.getCentroid();
+                boxes.push_back(AGLSpatialIndex::Box{centroid.x, centroid.y, centroid.x,
+                                                     centroid.y});
+            } else if (shape.isLine()) {
+                const Line &line = shape.getLine();
+                boxes.push_back(
+                    AGLSpatialIndex::boundingBox(std::vector<Point2f>{line.start(), line.end()}));
+            } else if (shape.isPolyLine() || shape.isPolygon()) {
+                boxes.push_back(AGLSpatialIndex::boundingBox(shape.m_points));
+            } else {
+                continue;
+            }
+            keys.push_back(keyShape.first);
+        }
+        return AGLSpatialIndex(boxes, keys);
+    });
+}
+
+bool AGLShapeIndex::shapeIntersects(const SalaShape &shape, const QtRegion &region) {
+    if (shape.isPoint()) {
+        const Point2f centroid = shape.getCentroid();
+        return centroid.x >= region.bottom_left.x && centroid.x <= region.top_right.x &&
+               centroid.y >= region.bottom_left.y && centroid.y <= region.top_right.y;
+    }
+    if (shape.isLine()) {
+        const Line &line = shape.getLine();
+        return AGLSpatialIndex::segmentIntersects(line.start(), line.end(), region);
+    }
+    const std::vector<Point2f> &points = shape.m_points;
+    for (size_t i = 1; i < points.size(); ++i) {
+        if (AGLSpatialIndex::segmentIntersects(points[i - 1], points[i], region))
+            return true;
+    }
+    if (!shape.isPolygon() || points.empty())
+        return false;
+    // closing edge, and the region being entirely inside the polygon
+    return AGLSpatialIndex::segmentIntersects(points.back(), points.front(), region) ||
+           AGLSpatialIndex::polygonContains(
+               points, Point2f((region.bottom_left.x + region.top_right.x) * 0.5,
+                               (region.bottom_left.y + region.top_right.y) * 0.5));
+}
+
+std::vector<int> AGLShapeIndex::getShapeKeysInRegion(const QtRegion &region) {
+    std::vector<int> shapeKeys;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_index.isEmpty() && m_build.isValid() && m_build.isFinished()) {
+        m_index = m_build.takeResult();
+    }
+    if (m_index.isEmpty()) {
+        for (auto &keyShape : m_shapeMap.getShapesInRegion(region)) {
+            shapeKeys.push_back(keyShape.first);
+        }
+        return shapeKeys;
+    }
+    // the index only knows the bounding boxes, check the candidates against the geometry
+    std::vector<int> candidates;
+    m_index.query(region, candidates);
+    const auto &shapes = m_shapeMap.getAllShapes();
+    for (int key : candidates) {
+        auto shape = shapes.find(key);
+        if (shape != shapes.end() && shapeIntersects(shape->second, region))
+            shapeKeys.push_back(key);
+    }
+    return shapeKeys;
+}
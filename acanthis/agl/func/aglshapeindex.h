@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "aglspatialindex.h"
+
+#include "salalib/shapemap.h"
+
+#include <QFuture>
+
+#include <mutex>
+
+/**
+ * @brief The spatial index of the shapes of a shape map, shared between the layer (for
+ * selection, on the GUI thread) and its AGLShapeMap (for hovering, on the render thread).
+ * The index is built in the background, until it is ready queries go through the shape map.
+ */
+class AGLShapeIndex {
+  public:
+    explicit AGLShapeIndex(ShapeMap &shapeMap) : m_shapeMap(shapeMap) {}
+    ~AGLShapeIndex() { m_build.waitForFinished(); }
+
+    /** @brief Starts (re)building the index from the current shapes */
+    void build();
+    /** @brief Keys of the shapes that touch the region, checked against their geometry */
+    std::vector<int> getShapeKeysInRegion(const QtRegion &region);
+
+    static bool shapeIntersects(const SalaShape &shape, const QtRegion &region);
+
+    AGLShapeIndex(const AGLShapeIndex &) = delete;
+    AGLShapeIndex &operator=(const AGLShapeIndex &) = delete;
+
+  private:
+    ShapeMap &m_shapeMap;
+    AGLSpatialIndex m_index;
+    QFuture<AGLSpatialIndex> m_build;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglspatialindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+AGLSpatialIndex::AGLSpatialIndex(const std::vector<Box> &boxes, const std::vector<int> &keys) {
+    size_t itemCount = std::min(boxes.size(), keys.size());
+    if (itemCount == 0)
+        return;
+
+    // Sort-Tile-Recursive: cut the items into vertical slices by their centre in x, then
+    // order each slice by y so that runs of NODE_CAPACITY items are close together
+    std::vector<size_t> order(itemCount);
+    std::iota(order.begin(), order.end(), 0);
+    auto centreX = [&boxes](size_t item) { return boxes[item].minX + boxes[item].maxX; };
+    auto centreY = [&boxes](size_t item) { return boxes[item].minY + boxes[item].maxY; };
+    std::sort(order.begin(), order.end(),
+              [&centreX](size_t a, size_t b) { return centreX(a) < centreX(b); });
+    size_t leafCount = (itemCount + NODE_CAPACITY - 1) / NODE_CAPACITY;
+    size_t sliceCount = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(leafCount))));
+    size_t sliceSize = sliceCount * NODE_CAPACITY;
+    for (size_t sliceStart = 0; sliceStart < itemCount; sliceStart += sliceSize) {
+        auto sliceBegin = order.begin() + static_cast<std::ptrdiff_t>(sliceStart);
+        auto sliceEnd = order.begin() + static_cast<std::ptrdiff_t>(
+                                            std::min(itemCount, sliceStart + sliceSize));
+        std::sort(sliceBegin, sliceEnd,
+                  [&centreY](size_t a, size_t b) { return centreY(a) < centreY(b); });
+    }
+
+    m_nodes.reserve(itemCount + itemCount / (NODE_CAPACITY - 1) + 1);
+    m_keys.reserve(itemCount);
+    for (size_t item : order) {
+        m_nodes.push_back(boxes[item]);
+        m_keys.push_back(keys[item]);
+    }
+
+    // each level groups runs of the one below until a single root is left
+    m_levelStarts.push_back(0);
+    size_t levelStart = 0;
+    size_t levelCount = itemCount;
+    while (levelCount > 1) {
+        size_t nextStart = m_nodes.size();
+        for (size_t first = 0; first < levelCount; first += NODE_CAPACITY) {
+            size_t last = std::min(levelCount, first + NODE_CAPACITY);
+            Box node = m_nodes[levelStart + first];
+            for (size_t child = first + 1; child < last; ++child) {
+                const Box &childBox = m_nodes[levelStart + child];
+                node.minX = std::min(node.minX, childBox.minX);
+                node.minY = std::min(node.minY, childBox.minY);
+                node.maxX = std::max(node.maxX, childBox.maxX);
+                node.maxY = std::max(node.maxY, childBox.maxY);
+            }
+            m_nodes.push_back(node);
+        }
+        m_levelStarts.push_back(nextStart);
+        levelStart = nextStart;
+        levelCount = m_nodes.size() - nextStart;
+    }
+}
+
+void AGLSpatialIndex::query(const QtRegion &region, std::vector<int> &keys) const {
+    if (isEmpty())
+        return;
+    // (level, node) pairs still to visit, starting from the root
+    std::vector<std::pair<size_t, size_t>> stack;
+    stack.emplace_back(m_levelStarts.size() - 1, 0);
+    while (!stack.empty()) {
+        auto [level, node] = stack.back();
+        stack.pop_back();
+        if (!m_nodes[m_levelStarts[level] + node].intersects(region))
+            continue;
+        if (level == 0) {
+            keys.push_back(m_keys[node]);
+            continue;
+        }
+        size_t childCount = m_levelStarts[level] - m_levelStarts[level - 1];
+        size_t lastChild = std::min(childCount, (node + 1) * NODE_CAPACITY);
+        if (level == 1) {
+            // test the items here rather than going through the stack for each
+            const Box *items = m_nodes.data();
+            for (size_t item = node * NODE_CAPACITY; item < lastChild; ++item) {
+                if (items[item].intersects(region))
+                    keys.push_back(m_keys[item]);
+            }
+            continue;
+        }
+        for (size_t child = node * NODE_CAPACITY; child < lastChild; ++child) {
+            stack.emplace_back(level - 1, child);
+        }
+    }
+}
+
+AGLSpatialIndex::Box AGLSpatialIndex::boundingBox(const std::vector<Point2f> &points) {
+    Box box{std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+            std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+    for (const Point2f &point : points) {
+        box.minX = std::min(box.minX, point.x);
+        box.minY = std::min(box.minY, point.y);
+        box.maxX = std::max(box.maxX, point.x);
+        box.maxY = std::max(box.maxY, point.y);
+    }
+    return box;
+}
+
+bool AGLSpatialIndex::segmentIntersects(const Point2f &a, const Point2f &b,
+                                        const QtRegion &region) {
+    // Liang-Barsky clipping of the segment against each side of the region
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    const double p[4] = {-dx, dx, -dy, dy};
+    const double q[4] = {a.x - region.bottom_left.x, region.top_right.x - a.x,
+                         a.y - region.bottom_left.y, region.top_right.y - a.y};
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (int side = 0; side < 4; ++side) {
+        if (p[side] == 0.0) {
+            // parallel to this side, and outside of it
+            if (q[side] < 0.0)
+                return false;
+            continue;
+        }
+        double t = q[side] / p[side];
+        if (p[side] < 0.0) {
+            if (t > t1)
+                return false;
+            t0 = std::max(t0, t);
+        } else {
+            if (t < t0)
+                return false;
+            t1 = std::min(t1, t);
+        }
+    }
+    return true;
+}
+
+bool AGLSpatialIndex::polygonContains(const std::vector<Point2f> &polygon, const Point2f &point) {
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const Point2f &pi = polygon[i];
+        const Point2f &pj = polygon[j];
+        if ((pi.y > point.y) != (pj.y > point.y) &&
+            point.x < (pj.x - pi.x) * (point.y - pi.y) / (pj.y - pi.y) + pi.x)
+            inside = !inside;
+    }
+    return inside;
+}
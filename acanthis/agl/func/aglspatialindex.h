@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "genlib/p2dpoly.h"
+
+#include <vector>
+
+/**
+ * @brief Packed R-tree over the bounding boxes of the items of a layer, bulk loaded with
+ * Sort-Tile-Recursive. The tree is built once and not modified after. All levels are kept
+ * in one array with the items first and the root last, the children of node i of a level
+ * are entries [i * NODE_CAPACITY, (i + 1) * NODE_CAPACITY) of the level below. Queries
+ * only return the keys of the items.
+ */
+class AGLSpatialIndex {
+  public:
+    static const size_t NODE_CAPACITY = 16;
+
+    struct Box {
+        double minX;
+        double minY;
+        double maxX;
+        double maxY;
+        bool intersects(const QtRegion &region) const {
+            return minX <= region.top_right.x && maxX >= region.bottom_left.x &&
+                   minY <= region.top_right.y && maxY >= region.bottom_left.y;
+        }
+    };
+
+    AGLSpatialIndex() {}
+    /** @brief Builds the tree, keys[i] is the key of the item with the box boxes[i] */
+    AGLSpatialIndex(const std::vector<Box> &boxes, const std::vector<int> &keys);
+
+    bool isEmpty() const { return m_keys.empty(); }
+    size_t size() const { return m_keys.size(); }
+
+    /** @brief Appends the keys of the items whose box intersects the region */
+    void query(const QtRegion &region, std::vector<int> &keys) const;
+
+    static Box boundingBox(const std::vector<Point2f> &points);
+    /** @brief Whether any part of the segment from a to b is in the region */
+    static bool segmentIntersects(const Point2f &a, const Point2f &b, const QtRegion &region);
+    static bool polygonContains(const std::vector<Point2f> &polygon, const Point2f &point);
+
+  private:
+    std::vector<Box> m_nodes;
+    // start of each level in m_nodes, from the items up to the root
+    std::vector<size_t> m_levelStarts;
+    // in the order of the items in m_nodes
+    std::vector<int> m_keys;
+};
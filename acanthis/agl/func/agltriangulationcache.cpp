@@ -0,0 +1,197 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "agltriangulationcache.h"
+
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+AGLTriangulationCache::AGLTriangulationCache(const QString &filename)
+    : m_filename(filename), m_file(filename) {
+    map();
+}
+
+AGLTriangulationCache::~AGLTriangulationCache() { unmap(); }
+
+uint64_t AGLTriangulationCache::contentHash(const std::vector<Point2f> &points) {
+    // FNV-1a over the raw coordinates
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const Point2f &point : points) {
+        const double coords[2] = {point.x, point.y};
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(coords);
+        for (size_t i = 0; i < sizeof(coords); ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+void AGLTriangulationCache::map() {
+    if (!m_file.exists() || !m_file.open(QIODevice::ReadOnly))
+        return;
+    qint64 size = m_file.size();
+    if (size < static_cast<qint64>(sizeof(Header))) {
+        m_file.close();
+        return;
+    }
+    m_mapped = m_file.map(0, size);
+    if (m_mapped == nullptr) {
+        m_file.close();
+        return;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(m_mapped);
+    // the counts are checked against the size before they are multiplied, so that corrupt
+    // ones can not overflow into a size that matches
+    uint64_t available = static_cast<uint64_t>(size) - sizeof(Header);
+    bool countsFit = header->entryCount <= available / sizeof(Entry) &&
+                     header->indexCount <=
+                         (available - header->entryCount * sizeof(Entry)) / sizeof(uint32_t);
+    if (header->magic != FILE_MAGIC || header->version != FILE_VERSION || !countsFit ||
+        header->entryCount * sizeof(Entry) + header->indexCount * sizeof(uint32_t) !=
+            available) {
+        // stale or foreign file, it will be replaced on the next flush
+        unmap();
+        return;
+    }
+
+    m_entryCount = header->entryCount;
+    m_indexCount = header->indexCount;
+    m_entries = reinterpret_cast<const Entry *>(m_mapped + sizeof(Header));
+    m_indices = reinterpret_cast<const uint32_t *>(m_mapped + sizeof(Header) +
+                                                   m_entryCount * sizeof(Entry));
+    m_entryUsed.assign(static_cast<size_t>(m_entryCount), false);
+}
+
+void AGLTriangulationCache::unmap() {
+    if (m_mapped != nullptr) {
+        m_file.unmap(m_mapped);
+        m_mapped = nullptr;
+    }
+    if (m_file.isOpen())
+        m_file.close();
+    m_entries = nullptr;
+    m_indices = nullptr;
+    m_entryCount = 0;
+    m_indexCount = 0;
+    m_entryUsed.clear();
+}
+
+const AGLTriangulationCache::Entry *AGLTriangulationCache::findMapped(const Key &key) const {
+    const Entry *end = m_entries + m_entryCount;
+    const Entry *it = std::lower_bound(m_entries, end, key, [](const Entry &entry, const Key &k) {
+        return Key(entry.hash, entry.pointCount) < k;
+    });
+    if (it == end || it->hash != key.first || it->pointCount != key.second)
+        return nullptr;
+    return it;
+}
+
+bool AGLTriangulationCache::find(uint64_t hash, const std::vector<Point2f> &points,
+                                 std::vector<unsigned int> &indices) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Key key(hash, static_cast<uint32_t>(points.size()));
+
+    auto pending = m_pending.find(key);
+    if (pending != m_pending.end()) {
+        indices.assign(pending->second.begin(), pending->second.end());
+        return true;
+    }
+
+    const Entry *entry = findMapped(key);
+    if (entry == nullptr || entry->indexOffset + entry->indexCount > m_indexCount)
+        return false;
+
+    const uint32_t *first = m_indices + entry->indexOffset;
+    const uint32_t *last = first + entry->indexCount;
+    // never hand out indices that would read past the polygon
+    if (std::any_of(first, last, [&key](uint32_t idx) { return idx >= key.second; }))
+        return false;
+    indices.assign(first, last);
+    m_entryUsed[static_cast<size_t>(entry - m_entries)] = true;
+    return true;
+}
+
+void AGLTriangulationCache::insert(uint64_t hash, const std::vector<Point2f> &points,
+                                   const std::vector<unsigned int> &indices) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending[Key(hash, static_cast<uint32_t>(points.size()))].assign(indices.begin(),
+                                                                       indices.end());
+}
+
+bool AGLTriangulationCache::hasPendingEntries() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_pending.empty();
+}
+
+bool AGLTriangulationCache::flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.empty())
+        return true;
+
+    // merge the mapped and pending entries, both are already sorted by key
+    std::vector<Entry> entries;
+    entries.reserve(static_cast<size_t>(m_entryCount) + m_pending.size());
+    uint64_t indexCount = 0;
+    {
+        const Entry *mapped = m_entries;
+        const Entry *mappedEnd = m_entries + m_entryCount;
+        auto pending = m_pending.begin();
+        while (mapped != mappedEnd || pending != m_pending.end()) {
+            if (pending == m_pending.end() ||
+                (mapped != mappedEnd && Key(mapped->hash, mapped->pointCount) < pending->first)) {
+                // not found since the file was opened, most likely of a changed polygon
+                if (!m_entryUsed[static_cast<size_t>(mapped - m_entries)]) {
+                    ++mapped;
+                    continue;
+                }
+                entries.push_back(*mapped);
+                entries.back().indexOffset = indexCount;
+                indexCount += mapped->indexCount;
+                ++mapped;
+            } else {
+                if (mapped != mappedEnd && Key(mapped->hash, mapped->pointCount) == pending->first)
+                    ++mapped; // superseded
+                entries.push_back(Entry{pending->first.first, pending->first.second,
+                                        static_cast<uint32_t>(pending->second.size()),
+                                        indexCount});
+                indexCount += pending->second.size();
+                ++pending;
+            }
+        }
+    }
+
+    QSaveFile saveFile(m_filename);
+    if (!saveFile.open(QIODevice::WriteOnly))
+        return false;
+
+    Header header{FILE_MAGIC, FILE_VERSION, entries.size(), indexCount};
+    saveFile.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    saveFile.write(reinterpret_cast<const char *>(entries.data()),
+                   static_cast<qint64>(entries.size() * sizeof(Entry)));
+    for (const Entry &entry : entries) {
+        auto pending = m_pending.find(Key(entry.hash, entry.pointCount));
+        if (pending != m_pending.end()) {
+            saveFile.write(reinterpret_cast<const char *>(pending->second.data()),
+                           static_cast<qint64>(pending->second.size() * sizeof(uint32_t)));
+        } else {
+            const Entry *mapped = findMapped(Key(entry.hash, entry.pointCount));
+            saveFile.write(reinterpret_cast<const char *>(m_indices + mapped->indexOffset),
+                           static_cast<qint64>(mapped->indexCount * sizeof(uint32_t)));
+        }
+    }
+
+    // the old mapping must be released before the file is replaced
+    unmap();
+    bool committed = saveFile.commit();
+    map();
+    // everything in the file now is in use, or could not be replaced and is kept as it was
+    m_entryUsed.assign(static_cast<size_t>(m_entryCount), true);
+    if (committed)
+        m_pending.clear();
+    return committed;
+}
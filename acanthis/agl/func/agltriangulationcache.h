@@ -0,0 +1,86 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "genlib/p2dpoly.h"
+
+#include <QFile>
+#include <QString>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Persistent store of polygon triangulations, kept in a sidecar file next to the
+ * graph. Entries are keyed by a hash of the polygon points (and their count) so that any
+ * change to a polygon simply misses the cache. The file is memory-mapped and consists of
+ * a header, an entry table sorted by key and a flat array of triangle indices:
+ *
+ *   Header   { magic, version, entryCount, indexCount }
+ *   Entry[]  { hash, pointCount, indexCount, indexOffset }
+ *   uint32[] indices
+ *
+ * New triangulations are held in memory until flush() rewrites the file. Only the entries
+ * found since the file was opened are carried over, so that triangulations of polygons that
+ * have since changed do not pile up in the file.
+ */
+class AGLTriangulationCache {
+  public:
+    explicit AGLTriangulationCache(const QString &filename);
+    ~AGLTriangulationCache();
+    AGLTriangulationCache(const AGLTriangulationCache &) = delete;
+    AGLTriangulationCache &operator=(const AGLTriangulationCache &) = delete;
+
+    static QString sidecarFilename(const QString &graphFilename) {
+        return graphFilename + ".tricache";
+    }
+    static uint64_t contentHash(const std::vector<Point2f> &points);
+
+    bool find(uint64_t hash, const std::vector<Point2f> &points,
+              std::vector<unsigned int> &indices);
+    void insert(uint64_t hash, const std::vector<Point2f> &points,
+                const std::vector<unsigned int> &indices);
+    bool hasPendingEntries();
+    bool flush();
+
+  private:
+    static const uint32_t FILE_MAGIC = 0x43525441; // "ATRC"
+    static const uint32_t FILE_VERSION = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t entryCount;
+        uint64_t indexCount;
+    };
+
+    struct Entry {
+        uint64_t hash;
+        uint32_t pointCount;
+        uint32_t indexCount;
+        uint64_t indexOffset;
+    };
+
+    typedef std::pair<uint64_t, uint32_t> Key;
+
+    void map();
+    void unmap();
+    const Entry *findMapped(const Key &key) const;
+
+    const QString m_filename;
+    QFile m_file;
+    uchar *m_mapped = nullptr;
+    const Entry *m_entries = nullptr;
+    uint64_t m_entryCount = 0;
+    const uint32_t *m_indices = nullptr;
+    uint64_t m_indexCount = 0;
+    // one per mapped entry, whether it has been found
+    std::vector<bool> m_entryUsed;
+
+    std::map<Key, std::vector<uint32_t>> m_pending;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,522 @@
+// SPDX-FileCopyrightText: 2016 Mapbox
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later AND ISC
+
+// Ported from mapbox/earcut (https://github.com/mapbox/earcut), under the ISC license:
+//
+// Copyright (c) 2016, Mapbox
+//
+// Permission to use, copy, modify, and/or distribute this software for any purpose
+// with or without fee is hereby granted, provided that the above copyright notice
+// and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH REGARD TO
+// THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS.
+// IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+// DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+// WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+// OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+#include "agltriangulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Ear clipping on a doubly-linked ring of nodes, as in earcut. Holes are merged into the
+// outer ring by bridging them to a visible outer vertex, after which the ring is clipped ear
+// by ear. When no ear can be found the ring is first cleaned of duplicate and collinear
+// points, then small self-intersections are cured, and as a last resort the ring is split
+// along a valid diagonal and both halves are triangulated separately.
+
+namespace {
+
+    constexpr int NONE = -1;
+
+    struct Node {
+        unsigned int i; // index into the input points
+        double x, y;
+        int prev = NONE;
+        int next = NONE;
+        bool steiner = false;
+    };
+
+    struct Arena {
+        std::vector<Node> nodes;
+        std::vector<int> holeQueue;
+        std::vector<unsigned int> *indices = nullptr;
+
+        void reset(size_t expectedNodes) {
+            nodes.clear();
+            holeQueue.clear();
+            if (nodes.capacity() < expectedNodes)
+                nodes.reserve(expectedNodes);
+        }
+
+        Node &operator[](int idx) { return nodes[static_cast<size_t>(idx)]; }
+
+        int insertNode(unsigned int i, const Point2f &point, int last) {
+            nodes.push_back(Node{i, point.x, point.y});
+            int idx = static_cast<int>(nodes.size() - 1);
+            Node &node = nodes.back();
+            if (last == NONE) {
+                node.prev = idx;
+                node.next = idx;
+            } else {
+                Node &lastNode = (*this)[last];
+                node.next = lastNode.next;
+                node.prev = last;
+                (*this)[lastNode.next].prev = idx;
+                lastNode.next = idx;
+            }
+            return idx;
+        }
+
+        void removeNode(int idx) {
+            Node &node = (*this)[idx];
+            (*this)[node.next].prev = node.prev;
+            (*this)[node.prev].next = node.next;
+        }
+
+        void emit(int a, int b, int c) {
+            indices->push_back((*this)[a].i);
+            indices->push_back((*this)[b].i);
+            indices->push_back((*this)[c].i);
+        }
+
+        // signed area of the triangle, negative for counter-clockwise
+        double area(int p, int q, int r) {
+            const Node &np = (*this)[p], &nq = (*this)[q], &nr = (*this)[r];
+            return (nq.y - np.y) * (nr.x - nq.x) - (nq.x - np.x) * (nr.y - nq.y);
+        }
+
+        bool equals(int a, int b) {
+            return (*this)[a].x == (*this)[b].x && (*this)[a].y == (*this)[b].y;
+        }
+
+        int linkedList(const Point2f *points, size_t start, size_t end, bool counterClockwise);
+        int filterPoints(int start, int end = NONE);
+        void earcutLinked(int ear, int pass = 0);
+        bool isEar(int ear);
+        int cureLocalIntersections(int start);
+        void splitEarcut(int start);
+        int eliminateHoles(const Point2f *points, size_t pointCount,
+                           const std::vector<size_t> &holeStarts, int outerNode);
+        int eliminateHole(int hole, int outerNode);
+        int findHoleBridge(int hole, int outerNode);
+        bool sectorContainsSector(int m, int p);
+        int getLeftmost(int start);
+        bool isValidDiagonal(int a, int b);
+        bool intersects(int p1, int q1, int p2, int q2);
+        bool intersectsPolygon(int a, int b);
+        bool locallyInside(int a, int b);
+        bool middleInside(int a, int b);
+        int splitPolygon(int a, int b);
+    };
+
+    thread_local Arena t_arena;
+
+    bool pointInTriangle(double ax, double ay, double bx, double by, double cx, double cy,
+                         double px, double py) {
+        return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+               (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+               (bx - px) * (cy - py) >= (cx - px) * (by - py);
+    }
+
+    int sign(double value) { return (value > 0) - (value < 0); }
+
+    bool onSegment(const Node &p, const Node &q, const Node &r) {
+        return q.x <= std::max(p.x, r.x) && q.x >= std::min(p.x, r.x) &&
+               q.y <= std::max(p.y, r.y) && q.y >= std::min(p.y, r.y);
+    }
+
+    double signedArea(const Point2f *points, size_t start, size_t end) {
+        double sum = 0;
+        for (size_t i = start, j = end - 1; i < end; j = i++) {
+            sum += (points[j].x - points[i].x) * (points[i].y + points[j].y);
+        }
+        return sum;
+    }
+
+    int Arena::linkedList(const Point2f *points, size_t start, size_t end,
+                          bool counterClockwise) {
+        int last = NONE;
+        if (counterClockwise == (signedArea(points, start, end) > 0)) {
+            for (size_t i = start; i < end; ++i)
+                last = insertNode(static_cast<unsigned int>(i), points[i], last);
+        } else {
+            for (size_t i = end; i-- > start;)
+                last = insertNode(static_cast<unsigned int>(i), points[i], last);
+        }
+        if (last != NONE && equals(last, (*this)[last].next)) {
+            int next = (*this)[last].next;
+            removeNode(last);
+            last = next;
+        }
+        return last;
+    }
+
+    int Arena::filterPoints(int start, int end) {
+        if (start == NONE)
+            return start;
+        if (end == NONE)
+            end = start;
+
+        int p = start;
+        bool again;
+        do {
+            again = false;
+            Node &node = (*this)[p];
+            if (!node.steiner && (equals(p, node.next) || area(node.prev, p, node.next) == 0)) {
+                removeNode(p);
+                p = end = node.prev;
+                if (p == (*this)[p].next)
+                    break;
+                again = true;
+            } else {
+                p = node.next;
+            }
+        } while (again || p != end);
+
+        return end;
+    }
+
+    void Arena::earcutLinked(int ear, int pass) {
+        if (ear == NONE)
+            return;
+
+        int stop = ear;
+        while ((*this)[ear].prev != (*this)[ear].next) {
+            int prev = (*this)[ear].prev;
+            int next = (*this)[ear].next;
+
+            if (isEar(ear)) {
+                emit(prev, ear, next);
+                removeNode(ear);
+                // skipping the next vertex leads to less sliver triangles
+                ear = (*this)[next].next;
+                stop = ear;
+                continue;
+            }
+
+            ear = next;
+
+            if (ear == stop) {
+                if (pass == 0) {
+                    earcutLinked(filterPoints(ear), 1);
+                } else if (pass == 1) {
+                    earcutLinked(cureLocalIntersections(filterPoints(ear)), 2);
+                } else if (pass == 2) {
+                    splitEarcut(ear);
+                }
+                break;
+            }
+        }
+    }
+
+    bool Arena::isEar(int ear) {
+        const Node &b = (*this)[ear];
+        const Node &a = (*this)[b.prev];
+        const Node &c = (*this)[b.next];
+
+        if (area(b.prev, ear, b.next) >= 0)
+            return false; // reflex
+
+        double minX = std::min({a.x, b.x, c.x}), maxX = std::max({a.x, b.x, c.x});
+        double minY = std::min({a.y, b.y, c.y}), maxY = std::max({a.y, b.y, c.y});
+
+        int p = c.next;
+        while (p != b.prev) {
+            const Node &node = (*this)[p];
+            if (node.x >= minX && node.x <= maxX && node.y >= minY && node.y <= maxY &&
+                !(node.x == a.x && node.y == a.y) &&
+                pointInTriangle(a.x, a.y, b.x, b.y, c.x, c.y, node.x, node.y) &&
+                area(node.prev, p, node.next) >= 0)
+                return false;
+            p = node.next;
+        }
+        return true;
+    }
+
+    int Arena::cureLocalIntersections(int start) {
+        int p = start;
+        do {
+            int a = (*this)[p].prev;
+            int b = (*this)[(*this)[p].next].next;
+
+            if (!equals(a, b) && intersects(a, p, (*this)[p].next, b) && locallyInside(a, b) &&
+                locallyInside(b, a)) {
+                emit(a, p, b);
+                removeNode(p);
+                removeNode((*this)[p].next);
+                p = start = b;
+            }
+            p = (*this)[p].next;
+        } while (p != start);
+
+        return filterPoints(p);
+    }
+
+    void Arena::splitEarcut(int start) {
+        int a = start;
+        do {
+            int b = (*this)[(*this)[a].next].next;
+            while (b != (*this)[a].prev) {
+                if ((*this)[a].i != (*this)[b].i && isValidDiagonal(a, b)) {
+                    int c = splitPolygon(a, b);
+                    a = filterPoints(a, (*this)[a].next);
+                    c = filterPoints(c, (*this)[c].next);
+                    earcutLinked(a);
+                    earcutLinked(c);
+                    return;
+                }
+                b = (*this)[b].next;
+            }
+            a = (*this)[a].next;
+        } while (a != start);
+    }
+
+    int Arena::eliminateHoles(const Point2f *points, size_t pointCount,
+                              const std::vector<size_t> &holeStarts, int outerNode) {
+        for (size_t h = 0; h < holeStarts.size(); ++h) {
+            size_t start = holeStarts[h];
+            size_t end = h + 1 < holeStarts.size() ? holeStarts[h + 1] : pointCount;
+            if (end <= start)
+                continue;
+            int list = linkedList(points, start, end, false);
+            if (list == (*this)[list].next)
+                (*this)[list].steiner = true;
+            holeQueue.push_back(getLeftmost(list));
+        }
+
+        std::sort(holeQueue.begin(), holeQueue.end(), [this](int a, int b) {
+            const Node &na = (*this)[a], &nb = (*this)[b];
+            return na.x < nb.x || (na.x == nb.x && na.y < nb.y);
+        });
+
+        for (int hole : holeQueue)
+            outerNode = eliminateHole(hole, outerNode);
+
+        return outerNode;
+    }
+
+    int Arena::eliminateHole(int hole, int outerNode) {
+        int bridge = findHoleBridge(hole, outerNode);
+        if (bridge == NONE)
+            return outerNode;
+
+        int bridgeReverse = splitPolygon(bridge, hole);
+        filterPoints(bridgeReverse, (*this)[bridgeReverse].next);
+        return filterPoints(bridge, (*this)[bridge].next);
+    }
+
+    // David Eberly's algorithm for finding a bridge between a hole and the outer polygon
+    int Arena::findHoleBridge(int hole, int outerNode) {
+        int p = outerNode;
+        double hx = (*this)[hole].x;
+        double hy = (*this)[hole].y;
+        double qx = -std::numeric_limits<double>::infinity();
+        int m = NONE;
+
+        // find a segment intersected by a ray from the hole's leftmost point to the left;
+        // the segment's endpoint with lesser x will be the potential connection point
+        do {
+            const Node &node = (*this)[p];
+            const Node &next = (*this)[node.next];
+            if (hy <= node.y && hy >= next.y && next.y != node.y) {
+                double x = node.x + (hy - node.y) * (next.x - node.x) / (next.y - node.y);
+                if (x <= hx && x > qx) {
+                    qx = x;
+                    m = node.x < next.x ? p : node.next;
+                    if (x == hx)
+                        return m; // the hole touches the outer segment
+                }
+            }
+            p = node.next;
+        } while (p != outerNode);
+
+        if (m == NONE)
+            return NONE;
+
+        // look for points inside the triangle of hole point, segment intersection and
+        // endpoint; if there are none then the endpoint is visible, otherwise choose the
+        // point of the minimum angle with the ray as the connection point
+        int stop = m;
+        double mx = (*this)[m].x;
+        double my = (*this)[m].y;
+        double tanMin = std::numeric_limits<double>::infinity();
+
+        p = m;
+        do {
+            const Node &node = (*this)[p];
+            if (hx >= node.x && node.x >= mx && hx != node.x &&
+                pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, node.x,
+                                node.y)) {
+                double tan = std::abs(hy - node.y) / (hx - node.x);
+                if (locallyInside(p, hole) &&
+                    (tan < tanMin ||
+                     (tan == tanMin &&
+                      (node.x > (*this)[m].x ||
+                       (node.x == (*this)[m].x && sectorContainsSector(m, p)))))) {
+                    m = p;
+                    tanMin = tan;
+                }
+            }
+            p = node.next;
+        } while (p != stop);
+
+        return m;
+    }
+
+    bool Arena::sectorContainsSector(int m, int p) {
+        return area((*this)[m].prev, m, (*this)[p].prev) < 0 &&
+               area((*this)[p].next, m, (*this)[m].next) < 0;
+    }
+
+    int Arena::getLeftmost(int start) {
+        int p = start;
+        int leftmost = start;
+        do {
+            const Node &node = (*this)[p];
+            const Node &left = (*this)[leftmost];
+            if (node.x < left.x || (node.x == left.x && node.y < left.y))
+                leftmost = p;
+            p = node.next;
+        } while (p != start);
+        return leftmost;
+    }
+
+    bool Arena::isValidDiagonal(int a, int b) {
+        const Node &na = (*this)[a];
+        const Node &nb = (*this)[b];
+        if ((*this)[na.next].i == nb.i || (*this)[na.prev].i == nb.i || intersectsPolygon(a, b))
+            return false;
+        // locally visible, with the diagonal not collinear with its neighbours
+        if (locallyInside(a, b) && locallyInside(b, a) && middleInside(a, b) &&
+            (area(na.prev, a, nb.prev) != 0 || area(a, nb.prev, b) != 0))
+            return true;
+        // special zero-length case
+        return equals(a, b) && area(na.prev, a, na.next) > 0 && area(nb.prev, b, nb.next) > 0;
+    }
+
+    bool Arena::intersects(int p1, int q1, int p2, int q2) {
+        int o1 = sign(area(p1, q1, p2));
+        int o2 = sign(area(p1, q1, q2));
+        int o3 = sign(area(p2, q2, p1));
+        int o4 = sign(area(p2, q2, q1));
+
+        if (o1 != o2 && o3 != o4)
+            return true;
+
+        const Node &np1 = (*this)[p1], &nq1 = (*this)[q1];
+        const Node &np2 = (*this)[p2], &nq2 = (*this)[q2];
+        if (o1 == 0 && onSegment(np1, np2, nq1))
+            return true;
+        if (o2 == 0 && onSegment(np1, nq2, nq1))
+            return true;
+        if (o3 == 0 && onSegment(np2, np1, nq2))
+            return true;
+        if (o4 == 0 && onSegment(np2, nq1, nq2))
+            return true;
+        return false;
+    }
+
+    bool Arena::intersectsPolygon(int a, int b) {
+        unsigned int ai = (*this)[a].i;
+        unsigned int bi = (*this)[b].i;
+        int p = a;
+        do {
+            const Node &node = (*this)[p];
+            const Node &next = (*this)[node.next];
+            if (node.i != ai && next.i != ai && node.i != bi && next.i != bi &&
+                intersects(p, node.next, a, b))
+                return true;
+            p = node.next;
+        } while (p != a);
+        return false;
+    }
+
+    bool Arena::locallyInside(int a, int b) {
+        const Node &na = (*this)[a];
+        return area(na.prev, a, na.next) < 0
+                   ? area(a, b, na.next) >= 0 && area(a, na.prev, b) >= 0
+                   : area(a, b, na.prev) < 0 || area(a, na.next, b) < 0;
+    }
+
+    bool Arena::middleInside(int a, int b) {
+        int p = a;
+        bool inside = false;
+        double px = ((*this)[a].x + (*this)[b].x) / 2;
+        double py = ((*this)[a].y + (*this)[b].y) / 2;
+        do {
+            const Node &node = (*this)[p];
+            const Node &next = (*this)[node.next];
+            if (((node.y > py) != (next.y > py)) && next.y != node.y &&
+                (px < (next.x - node.x) * (py - node.y) / (next.y - node.y) + node.x))
+                inside = !inside;
+            p = node.next;
+        } while (p != a);
+        return inside;
+    }
+
+    // link two polygon vertices with a bridge; if the vertices belong to the same ring, it
+    // splits the polygon into two; if one belongs to the outer ring and another to a hole,
+    // it merges it into a single ring
+    int Arena::splitPolygon(int a, int b) {
+        // copy the values first, push_back may move the nodes
+        Node aCopy = (*this)[a];
+        Node bCopy = (*this)[b];
+        nodes.push_back(Node{aCopy.i, aCopy.x, aCopy.y});
+        int a2 = static_cast<int>(nodes.size() - 1);
+        nodes.push_back(Node{bCopy.i, bCopy.x, bCopy.y});
+        int b2 = static_cast<int>(nodes.size() - 1);
+        int an = aCopy.next;
+        int bp = bCopy.prev;
+
+        (*this)[a].next = b;
+        (*this)[b].prev = a;
+
+        (*this)[a2].next = an;
+        (*this)[an].prev = a2;
+
+        (*this)[b2].next = a2;
+        (*this)[a2].prev = b2;
+
+        (*this)[bp].next = b2;
+        (*this)[b2].prev = bp;
+
+        return b2;
+    }
+
+} // namespace
+
+void AGLTriangulator::triangulate(const Point2f *points, size_t pointCount,
+                                  const std::vector<size_t> &holeStarts,
+                                  std::vector<unsigned int> &indices) {
+    size_t outerEnd = holeStarts.empty() ? pointCount : holeStarts.front();
+    if (outerEnd < 3)
+        return;
+
+    Arena &arena = t_arena;
+    // every bridge (one per hole) and every split adds two nodes, reserve for the former
+    arena.reset(pointCount + 2 * holeStarts.size());
+    arena.indices = &indices;
+    indices.reserve(indices.size() + 3 * (pointCount + 2 * holeStarts.size() - 2));
+
+    int outerNode = arena.linkedList(points, 0, outerEnd, true);
+    if (outerNode == NONE || arena[outerNode].next == arena[outerNode].prev)
+        return;
+
+    if (!holeStarts.empty())
+        outerNode = arena.eliminateHoles(points, pointCount, holeStarts, outerNode);
+
+    arena.earcutLinked(outerNode);
+    arena.indices = nullptr;
+}
+
+std::vector<unsigned int> AGLTriangulator::triangulate(const std::vector<Point2f> &polygon) {
+    std::vector<unsigned int> indices;
+    triangulate(polygon.data(), polygon.size(), {}, indices);
+    return indices;
+}
@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "genlib/p2dpoly.h"
+
+#include <vector>
+
+/**
+ * @brief Ear-clipping triangulator with hole support, ported from mapbox/earcut (see the
+ * notice in agltriangulator.cpp). Works directly on the polygon points and returns triangle
+ * indices into them instead of duplicating vertices. The working memory is a per-thread
+ * arena that is reused between calls so that triangulating many small polygons does not
+ * allocate once the arena is warm.
+ */
+class AGLTriangulator {
+  public:
+    /**
+     * @brief Triangulates a contiguous run of points. The outer ring comes first, each hole
+     * starts at the offsets given in holeStarts (ascending). Indices are appended to
+     * indices and refer to the points array. Output triangles are counter-clockwise.
+     */
+    static void triangulate(const Point2f *points, size_t pointCount,
+                            const std::vector<size_t> &holeStarts,
+                            std::vector<unsigned int> &indices);
+
+    static std::vector<unsigned int> triangulate(const std::vector<Point2f> &polygon);
+};
@@ -0,0 +1,329 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglvectorwriter.h"
+
+#include <QFileInfo>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // coordinates are kept to this many decimals of a page unit
+    const int DECIMALS = 2;
+    const double QUANTA_PER_UNIT = 100.0;
+    // objects of the PDF: catalog, page list, page, content stream and its length
+    const int PDF_OBJECT_COUNT = 5;
+} // namespace
+
+AGLVectorWriter::AGLVectorWriter(const QString &fileName, const QtRegion &region,
+                                 const QSizeF &pageSize, const QColor &backgroundColour)
+    : m_file(fileName), m_region(region), m_pageSize(pageSize),
+      m_backgroundColour(backgroundColour) {
+    m_format = QFileInfo(fileName).suffix().toLower() == "pdf" ? Format::PDF : Format::SVG;
+    double regionWidth = region.top_right.x - region.bottom_left.x;
+    double regionHeight = region.top_right.y - region.bottom_left.y;
+    m_scale = regionWidth > 0 && regionHeight > 0
+                  ? std::min(pageSize.width() / regionWidth, pageSize.height() / regionHeight)
+                  : 1.0;
+}
+
+AGLVectorWriter::~AGLVectorWriter() {
+    if (m_deflate)
+        deflateEnd(m_deflate.get());
+}
+
+bool AGLVectorWriter::open() {
+    if (m_pageSize.isEmpty() || !m_file.open(QIODevice::WriteOnly))
+        return false;
+    m_buffer.reserve(BUFFER_SIZE + BUFFER_SIZE / 4);
+    qint64 pageWidth = std::llround(m_pageSize.width() * QUANTA_PER_UNIT);
+    qint64 pageHeight = std::llround(m_pageSize.height() * QUANTA_PER_UNIT);
+    QRgb background = m_backgroundColour.rgb();
+
+    if (m_format == Format::SVG) {
+        m_buffer.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                        "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+        appendFixed(pageWidth, DECIMALS);
+        m_buffer.append("\" height=\"");
+        appendFixed(pageHeight, DECIMALS);
+        m_buffer.append("\" viewBox=\"0 0 ");
+        appendFixed(pageWidth, DECIMALS);
+        m_buffer.append(' ');
+        appendFixed(pageHeight, DECIMALS);
+        m_buffer.append("\">\n<rect width=\"100%\" height=\"100%\" fill=\"");
+        appendColour(background);
+        // lines as thick as on screen, a unit being a pixel of the view
+        m_buffer.append("\"/>\n<g stroke-width=\"1\" stroke-linecap=\"round\" "
+                        "stroke-linejoin=\"round\">\n");
+        return !m_failed;
+    }
+
+    QByteArray header("%PDF-1.4\n%\xe2\xe3\xcf\xd3\n");
+    write(header.constData(), header.size());
+    beginObject();
+    header = "<< /Type /Catalog /Pages 2 0 R >>\nendobj\n";
+    write(header.constData(), header.size());
+    beginObject();
+    header = "<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n";
+    write(header.constData(), header.size());
+    beginObject();
+    m_buffer.append("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 ");
+    appendFixed(pageWidth, DECIMALS);
+    m_buffer.append(' ');
+    appendFixed(pageHeight, DECIMALS);
+    m_buffer.append("] /Contents 4 0 R /Resources << >> >>\nendobj\n");
+    write(m_buffer.constData(), m_buffer.size());
+    m_buffer.clear();
+    // the length of the stream is only known at the end, it goes in an object after it
+    beginObject();
+    header = "<< /Length 5 0 R /Filter /FlateDecode >>\nstream\n";
+    write(header.constData(), header.size());
+    m_streamStart = m_file.pos();
+
+    m_deflate = std::make_unique<z_stream_s>();
+    if (deflateInit(m_deflate.get(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        m_deflate.reset();
+        return false;
+    }
+    appendColour(background);
+    m_buffer.append(" rg\n0 0 ");
+    appendFixed(pageWidth, DECIMALS);
+    m_buffer.append(' ');
+    appendFixed(pageHeight, DECIMALS);
+    m_buffer.append(" re\nf\n1 w\n1 J\n1 j\n");
+    return !m_failed;
+}
+
+void AGLVectorWriter::beginLayer(const QString &name) {
+    endPath();
+    if (m_format != Format::SVG)
+        return;
+    m_buffer.append("<g id=\"layer");
+    m_buffer.append(QByteArray::number(++m_layerCount));
+    m_buffer.append("\">\n<title>");
+    m_buffer.append(name.toHtmlEscaped().toUtf8());
+    m_buffer.append("</title>\n");
+}
+
+void AGLVectorWriter::endLayer() {
+    endPath();
+    if (m_format == Format::SVG)
+        m_buffer.append("</g>\n");
+}
+
+void AGLVectorWriter::addLine(const Point2f &start, const Point2f &end, QRgb colour) {
+    const Point2f points[2] = {start, end};
+    if (quantise(points, 2) < 2)
+        return;
+    addPath(Paint::STROKE, colour, false);
+}
+
+void AGLVectorWriter::addPolyline(const std::vector<Point2f> &points, QRgb colour) {
+    if (quantise(points.data(), points.size()) < 2)
+        return;
+    addPath(Paint::STROKE, colour, false);
+}
+
+void AGLVectorWriter::addPolygon(const std::vector<Point2f> &points, QRgb colour) {
+    if (quantise(points.data(), points.size()) > 1 && m_pagePoints.back() == m_pagePoints.front())
+        m_pagePoints.pop_back();
+    if (m_pagePoints.size() < 3)
+        return;
+    addPath(Paint::FILL, colour, true);
+}
+
+bool AGLVectorWriter::finish() {
+    endPath();
+    if (m_format == Format::SVG) {
+        m_buffer.append("</g>\n</svg>\n");
+        flushBuffer(true);
+        m_file.close();
+        return !m_failed && m_file.error() == QFileDevice::NoError;
+    }
+
+    flushBuffer(true);
+    qint64 streamLength = m_file.pos() - m_streamStart;
+    m_buffer.append("\nendstream\nendobj\n");
+    write(m_buffer.constData(), m_buffer.size());
+    m_buffer.clear();
+    beginObject();
+    m_buffer.append(QByteArray::number(streamLength));
+    m_buffer.append("\nendobj\n");
+    write(m_buffer.constData(), m_buffer.size());
+    m_buffer.clear();
+
+    qint64 crossReferenceOffset = m_file.pos();
+    m_buffer.append("xref\n0 ");
+    m_buffer.append(QByteArray::number(PDF_OBJECT_COUNT + 1));
+    m_buffer.append("\n0000000000 65535 f \n");
+    for (qint64 offset : m_objectOffsets) {
+        // each entry is exactly 20 bytes
+        m_buffer.append(QByteArray::number(offset).rightJustified(10, '0'));
+        m_buffer.append(" 00000 n \n");
+    }
+    m_buffer.append("trailer\n<< /Size ");
+    m_buffer.append(QByteArray::number(PDF_OBJECT_COUNT + 1));
+    m_buffer.append(" /Root 1 0 R >>\nstartxref\n");
+    m_buffer.append(QByteArray::number(crossReferenceOffset));
+    m_buffer.append("\n%%EOF\n");
+    write(m_buffer.constData(), m_buffer.size());
+    m_buffer.clear();
+    m_file.close();
+    return !m_failed && m_file.error() == QFileDevice::NoError;
+}
+
+size_t AGLVectorWriter::quantise(const Point2f *points, size_t count) {
+    m_pagePoints.clear();
+    // the SVG has y going down the page, the PDF up
+    bool flipY = m_format == Format::SVG;
+    for (size_t i = 0; i < count; ++i) {
+        double x = (points[i].x - m_region.bottom_left.x) * m_scale;
+        double y = flipY ? (m_region.top_right.y - points[i].y) * m_scale
+                         : (points[i].y - m_region.bottom_left.y) * m_scale;
+        std::pair<qint64, qint64> pagePoint(std::llround(x * QUANTA_PER_UNIT),
+                                            std::llround(y * QUANTA_PER_UNIT));
+        if (m_pagePoints.empty() || m_pagePoints.back() != pagePoint)
+            m_pagePoints.push_back(pagePoint);
+    }
+    return m_pagePoints.size();
+}
+
+void AGLVectorWriter::addPath(Paint paint, QRgb colour, bool closed) {
+    // each fill is a path of its own, as overlapping or nested polygons of opposite winding
+    // in one path would cut holes in each other
+    if (!m_pathOpen || paint == Paint::FILL || paint != m_pathPaint || colour != m_pathColour ||
+        m_pathCommands >= MAX_PATH_COMMANDS) {
+        endPath();
+        beginPath(paint, colour);
+    }
+    for (size_t i = 0; i < m_pagePoints.size(); ++i) {
+        if (m_format == Format::SVG) {
+            m_buffer.append(i == 0 ? 'M' : 'L');
+            appendFixed(m_pagePoints[i].first, DECIMALS);
+            m_buffer.append(' ');
+            appendFixed(m_pagePoints[i].second, DECIMALS);
+        } else {
+            appendFixed(m_pagePoints[i].first, DECIMALS);
+            m_buffer.append(' ');
+            appendFixed(m_pagePoints[i].second, DECIMALS);
+            m_buffer.append(i == 0 ? " m\n" : " l\n");
+        }
+    }
+    if (closed)
+        m_buffer.append(m_format == Format::SVG ? "Z" : "h\n");
+    m_pathCommands += static_cast<int>(m_pagePoints.size());
+    if (m_buffer.size() > BUFFER_SIZE)
+        flushBuffer(false);
+}
+
+void AGLVectorWriter::beginPath(Paint paint, QRgb colour) {
+    if (m_format == Format::SVG) {
+        m_buffer.append(paint == Paint::FILL ? "<path fill=\"" : "<path fill=\"none\" stroke=\"");
+        appendColour(colour);
+        m_buffer.append("\" d=\"");
+    } else {
+        appendColour(colour);
+        m_buffer.append(paint == Paint::FILL ? " rg\n" : " RG\n");
+    }
+    m_pathOpen = true;
+    m_pathPaint = paint;
+    m_pathColour = colour;
+    m_pathCommands = 0;
+}
+
+void AGLVectorWriter::endPath() {
+    if (!m_pathOpen)
+        return;
+    if (m_format == Format::SVG)
+        m_buffer.append("\"/>\n");
+    else
+        m_buffer.append(m_pathPaint == Paint::FILL ? "f\n" : "S\n");
+    m_pathOpen = false;
+}
+
+void AGLVectorWriter::appendColour(QRgb colour) {
+    if (m_format == Format::SVG) {
+        static const char hexDigits[] = "0123456789abcdef";
+        char hex[7] = {'#'};
+        const int channels[3] = {qRed(colour), qGreen(colour), qBlue(colour)};
+        for (int channel = 0; channel < 3; ++channel) {
+            hex[1 + channel * 2] = hexDigits[channels[channel] >> 4];
+            hex[2 + channel * 2] = hexDigits[channels[channel] & 0xF];
+        }
+        m_buffer.append(hex, 7);
+        return;
+    }
+    // PDF colours go from 0 to 1
+    appendFixed(std::lround(qRed(colour) * 1000 / 255.0), 3);
+    m_buffer.append(' ');
+    appendFixed(std::lround(qGreen(colour) * 1000 / 255.0), 3);
+    m_buffer.append(' ');
+    appendFixed(std::lround(qBlue(colour) * 1000 / 255.0), 3);
+}
+
+void AGLVectorWriter::appendFixed(qint64 value, int decimals) {
+    // written out by hand, this is called for every coordinate
+    char digits[24];
+    int end = sizeof(digits);
+    int start = end;
+    bool negative = value < 0;
+    quint64 magnitude = negative ? static_cast<quint64>(-value) : static_cast<quint64>(value);
+    int fractionDigits = decimals;
+    while (fractionDigits > 0 && magnitude % 10 == 0) {
+        magnitude /= 10;
+        --fractionDigits;
+    }
+    for (int digit = 0; digit < fractionDigits; ++digit) {
+        digits[--start] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    if (fractionDigits > 0)
+        digits[--start] = '.';
+    do {
+        digits[--start] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (negative)
+        digits[--start] = '-';
+    m_buffer.append(digits + start, end - start);
+}
+
+void AGLVectorWriter::flushBuffer(bool last) {
+    if (m_format == Format::SVG) {
+        write(m_buffer.constData(), m_buffer.size());
+        m_buffer.clear();
+        return;
+    }
+    if (!m_deflate)
+        return;
+    z_stream_s &stream = *m_deflate;
+    stream.next_in = reinterpret_cast<Bytef *>(m_buffer.data());
+    stream.avail_in = static_cast<uInt>(m_buffer.size());
+    char compressed[1 << 16];
+    int result = Z_OK;
+    do {
+        stream.next_out = reinterpret_cast<Bytef *>(compressed);
+        stream.avail_out = sizeof(compressed);
+        result = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+        write(compressed, static_cast<qint64>(sizeof(compressed) - stream.avail_out));
+    } while (stream.avail_out == 0);
+    if (last && result != Z_STREAM_END)
+        m_failed = true;
+    m_buffer.clear();
+}
+
+void AGLVectorWriter::write(const char *data, qint64 size) {
+    if (m_file.write(data, size) != size)
+        m_failed = true;
+}
+
+void AGLVectorWriter::beginObject() {
+    m_objectOffsets.push_back(m_file.pos());
+    QByteArray header = QByteArray::number(static_cast<qulonglong>(m_objectOffsets.size()));
+    header.append(" 0 obj\n");
+    write(header.constData(), header.size());
+}
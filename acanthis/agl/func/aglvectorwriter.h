@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "genlib/p2dpoly.h"
+
+#include <QColor>
+#include <QFile>
+#include <QSizeF>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct z_stream_s;
+
+/**
+ * @brief Writes the shapes of a region of the map as an SVG or a PDF (by the suffix of the
+ * file) as they are given, with nothing kept but a small buffer. Coordinates are moved onto
+ * the page and rounded to 1/100 of a page unit, points that round onto the one before them
+ * are dropped along with shapes left with nothing to draw. Consecutive lines of the same
+ * colour go in one path, each filled polygon in a path of its own. The PDF content stream is
+ * compressed as it is written.
+ */
+class AGLVectorWriter {
+  public:
+    // in bytes, the buffer is written out (or compressed) when it goes over this
+    static const int BUFFER_SIZE = 1 << 20;
+    // commands in one path before a new one is started, to keep the elements readable
+    static const int MAX_PATH_COMMANDS = 4096;
+
+    /** @brief region is the part of the map drawn onto a page of pageSize units */
+    AGLVectorWriter(const QString &fileName, const QtRegion &region, const QSizeF &pageSize,
+                    const QColor &backgroundColour);
+    ~AGLVectorWriter();
+
+    bool open();
+    /** @brief Groups the shapes added until endLayer() (only in the SVG) */
+    void beginLayer(const QString &name);
+    void endLayer();
+    void addLine(const Point2f &start, const Point2f &end, QRgb colour);
+    void addPolyline(const std::vector<Point2f> &points, QRgb colour);
+    /** @brief A filled polygon, closed back to its first point */
+    void addPolygon(const std::vector<Point2f> &points, QRgb colour);
+    /** @brief Writes out the rest, false if anything could not be written */
+    bool finish();
+
+    AGLVectorWriter(const AGLVectorWriter &) = delete;
+    AGLVectorWriter &operator=(const AGLVectorWriter &) = delete;
+
+  private:
+    enum class Format { SVG, PDF };
+    enum class Paint { STROKE, FILL };
+
+    /** @brief Rounds the points onto the page into m_pagePoints, without repeats */
+    size_t quantise(const Point2f *points, size_t count);
+    void addPath(Paint paint, QRgb colour, bool closed);
+    void beginPath(Paint paint, QRgb colour);
+    void endPath();
+    void appendColour(QRgb colour);
+    /** @brief Appends value / 10^decimals, without trailing zeros */
+    void appendFixed(qint64 value, int decimals);
+    void flushBuffer(bool last);
+    void write(const char *data, qint64 size);
+    void beginObject();
+
+    QFile m_file;
+    Format m_format;
+    QtRegion m_region;
+    QSizeF m_pageSize;
+    QColor m_backgroundColour;
+    // page units per world unit
+    double m_scale;
+
+    QByteArray m_buffer;
+    std::vector<std::pair<qint64, qint64>> m_pagePoints;
+    bool m_pathOpen = false;
+    Paint m_pathPaint = Paint::STROKE;
+    QRgb m_pathColour = 0;
+    int m_pathCommands = 0;
+    int m_layerCount = 0;
+
+    // PDF only
+    std::unique_ptr<z_stream_s> m_deflate;
+    std::vector<qint64> m_objectOffsets;
+    qint64 m_streamStart = 0;
+
+    bool m_failed = false;
+};
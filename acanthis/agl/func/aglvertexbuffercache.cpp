@@ -0,0 +1,218 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglvertexbuffercache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+AGLVertexBufferCache::AGLVertexBufferCache(const QString &filename)
+    : m_filename(filename), m_file(filename) {
+    map();
+}
+
+AGLVertexBufferCache::~AGLVertexBufferCache() { unmap(); }
+
+QString AGLVertexBufferCache::cacheFilename(const QString &graphFilename) {
+    // the start of the file, its size and its time rather than all of it, as for the
+    // thumbnails. A file changed since is given a new cache
+    QFile graphFile(graphFilename);
+    if (!graphFile.open(QIODevice::ReadOnly))
+        return QString();
+    QFileInfo graphFileInfo(graphFile);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(graphFile.read(HASHED_BYTES));
+    hash.addData(QByteArray::number(graphFileInfo.size()));
+    hash.addData(QByteArray::number(graphFileInfo.lastModified().toMSecsSinceEpoch()));
+
+    QString cacheDir =
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/vertexbuffers";
+    QDir().mkpath(cacheDir);
+    return cacheDir + "/" + QString::fromLatin1(hash.result().toHex()) + ".vbcache";
+}
+
+uint64_t AGLVertexBufferCache::keyHash(const QString &key) {
+    // FNV-1a over the UTF-16 code units of the key
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const QChar &c : key) {
+        hash ^= c.unicode();
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void AGLVertexBufferCache::map() {
+    if (!m_file.exists() || !m_file.open(QIODevice::ReadOnly))
+        return;
+    qint64 size = m_file.size();
+    if (size < static_cast<qint64>(sizeof(Header))) {
+        m_file.close();
+        return;
+    }
+    m_mapped = m_file.map(0, size);
+    if (m_mapped == nullptr) {
+        m_file.close();
+        return;
+    }
+    m_mappedSize = static_cast<uint64_t>(size);
+
+    const Header *header = reinterpret_cast<const Header *>(m_mapped);
+    if (header->magic != FILE_MAGIC || header->version != FILE_VERSION ||
+        header->entryCount > (m_mappedSize - sizeof(Header)) / sizeof(Entry)) {
+        // from an older build, it will be replaced on the next flush
+        unmap();
+        return;
+    }
+    m_entryCount = header->entryCount;
+    m_entries = reinterpret_cast<const Entry *>(m_mapped + sizeof(Header));
+    m_entryUsed.assign(static_cast<size_t>(m_entryCount), false);
+}
+
+void AGLVertexBufferCache::unmap() {
+    if (m_mapped != nullptr) {
+        m_file.unmap(m_mapped);
+        m_mapped = nullptr;
+    }
+    if (m_file.isOpen())
+        m_file.close();
+    m_mappedSize = 0;
+    m_entries = nullptr;
+    m_entryCount = 0;
+    m_entryUsed.clear();
+}
+
+QString AGLVertexBufferCache::getMappedKey(const Entry &entry) const {
+    if (!isMapped(entry.keyOffset, entry.keySize) || entry.keySize % sizeof(char16_t) != 0)
+        return QString();
+    return QString(reinterpret_cast<const QChar *>(m_mapped + entry.keyOffset),
+                   static_cast<qsizetype>(entry.keySize / sizeof(char16_t)));
+}
+
+const AGLVertexBufferCache::Entry *AGLVertexBufferCache::findMapped(const QString &key) const {
+    uint64_t hash = keyHash(key);
+    const Entry *end = m_entries + m_entryCount;
+    const Entry *it = std::lower_bound(
+        m_entries, end, hash, [](const Entry &entry, uint64_t h) { return entry.keyHash < h; });
+    for (; it != end && it->keyHash == hash; ++it) {
+        if (isMapped(it->offset, it->size) && getMappedKey(*it) == key)
+            return it;
+    }
+    return nullptr;
+}
+
+bool AGLVertexBufferCache::findBlob(const QString &key, const uchar *&blob,
+                                    uint64_t &size) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto pending = m_pending.find(key);
+    if (pending != m_pending.end()) {
+        blob = reinterpret_cast<const uchar *>(pending->second.constData());
+        size = static_cast<uint64_t>(pending->second.size());
+        return true;
+    }
+    const Entry *entry = findMapped(key);
+    if (entry == nullptr)
+        return false;
+    blob = m_mapped + entry->offset;
+    size = entry->size;
+    m_entryUsed[static_cast<size_t>(entry - m_entries)] = true;
+    return true;
+}
+
+void AGLVertexBufferCache::writeBlob(const QString &key, const char *data, qsizetype size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending[key] = QByteArray(data, size);
+}
+
+bool AGLVertexBufferCache::hasPendingWrites() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_pending.empty();
+}
+
+bool AGLVertexBufferCache::flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.empty() || m_filename.isEmpty())
+        return true;
+
+    // merge the mapped and pending entries, pending ones take precedence and mapped ones
+    // not read since the file was opened are dropped
+    std::vector<Entry> entries;
+    std::vector<QString> keys;
+    std::vector<const char *> sources;
+    for (uint64_t i = 0; i < m_entryCount; ++i) {
+        if (!m_entryUsed[static_cast<size_t>(i)])
+            continue;
+        const Entry &entry = m_entries[i];
+        QString key = getMappedKey(entry);
+        // read entries were found by their key, so are within the file
+        if (m_pending.count(key) == 0 && findMapped(key) == &entry) {
+            entries.push_back(entry);
+            keys.push_back(key);
+            sources.push_back(reinterpret_cast<const char *>(m_mapped + entry.offset));
+        }
+    }
+    for (auto &pending : m_pending) {
+        entries.push_back(Entry{keyHash(pending.first), 0, 0, 0,
+                                static_cast<uint64_t>(pending.second.size())});
+        keys.push_back(pending.first);
+        sources.push_back(pending.second.constData());
+    }
+
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(),
+              [&entries](size_t a, size_t b) { return entries[a].keyHash < entries[b].keyHash; });
+
+    std::vector<Entry> sortedEntries;
+    sortedEntries.reserve(entries.size());
+    auto align = [](uint64_t offset) {
+        return (offset + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+    };
+    uint64_t offset = sizeof(Header) + entries.size() * sizeof(Entry);
+    for (size_t i : order) {
+        uint64_t keyOffset = align(offset);
+        uint64_t keySize = static_cast<uint64_t>(keys[i].size()) * sizeof(char16_t);
+        uint64_t blobOffset = align(keyOffset + keySize);
+        sortedEntries.push_back(
+            Entry{entries[i].keyHash, keyOffset, keySize, blobOffset, entries[i].size});
+        offset = blobOffset + entries[i].size;
+    }
+
+    QSaveFile saveFile(m_filename);
+    if (!saveFile.open(QIODevice::WriteOnly))
+        return false;
+
+    Header header{FILE_MAGIC, FILE_VERSION, sortedEntries.size()};
+    saveFile.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    saveFile.write(reinterpret_cast<const char *>(sortedEntries.data()),
+                   static_cast<qint64>(sortedEntries.size() * sizeof(Entry)));
+    static const char padding[BLOB_ALIGNMENT] = {};
+    uint64_t written = sizeof(Header) + sortedEntries.size() * sizeof(Entry);
+    for (size_t i = 0; i < order.size(); ++i) {
+        const Entry &entry = sortedEntries[i];
+        saveFile.write(padding, static_cast<qint64>(entry.keyOffset - written));
+        saveFile.write(reinterpret_cast<const char *>(keys[order[i]].utf16()),
+                       static_cast<qint64>(entry.keySize));
+        written = entry.keyOffset + entry.keySize;
+        saveFile.write(padding, static_cast<qint64>(entry.offset - written));
+        saveFile.write(sources[order[i]], static_cast<qint64>(entry.size));
+        written = entry.offset + entry.size;
+    }
+
+    // the old mapping must be released before the file is replaced
+    unmap();
+    bool committed = saveFile.commit();
+    map();
+    // everything in the file now is in use, or could not be replaced and is kept as it was
+    m_entryUsed.assign(static_cast<size_t>(m_entryCount), true);
+    if (committed)
+        m_pending.clear();
+    return committed;
+}
@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Store of final vertex buffers, one file per graph (see cacheFilename()) in the
+ * application cache location. Each buffer is a named blob, named by the layer and the
+ * object it belongs to. The file is memory-mapped and laid out as:
+ *
+ *   Header   { magic, version, entryCount }
+ *   Entry[]  { keyHash, keyOffset, keySize, offset, size } sorted by keyHash
+ *   keys (UTF-16) and blobs, each aligned to 16 bytes
+ *
+ * Entries are found by the hash of their name and then the name itself is compared, so that
+ * a collision of the hashes never hands out the blob of another name.
+ *
+ * Writes are held in memory until flush() rewrites the file, which only carries over the
+ * blobs read since the file was opened so that those of old colourings do not pile up.
+ * Increase FILE_VERSION whenever the vertex layout of any of the cached objects changes.
+ */
+class AGLVertexBufferCache {
+  public:
+    explicit AGLVertexBufferCache(const QString &filename);
+    ~AGLVertexBufferCache();
+    AGLVertexBufferCache(const AGLVertexBufferCache &) = delete;
+    AGLVertexBufferCache &operator=(const AGLVertexBufferCache &) = delete;
+
+    /**
+     * @brief Cache file for a graph, empty if the graph file can not be read. Keyed by the
+     * contents and the modification time of the graph file
+     */
+    static QString cacheFilename(const QString &graphFilename);
+
+    template <typename T> bool read(const QString &key, QVector<T> &data) const {
+        const uchar *blob = nullptr;
+        uint64_t size = 0;
+        if (!findBlob(key, blob, size) || size % sizeof(T) != 0)
+            return false;
+        data.resize(static_cast<qsizetype>(size / sizeof(T)));
+        if (size != 0)
+            std::memcpy(data.data(), blob, size);
+        return true;
+    }
+
+    template <typename T> void write(const QString &key, const T *data, qsizetype count) {
+        writeBlob(key, reinterpret_cast<const char *>(data),
+                  static_cast<qsizetype>(static_cast<size_t>(count) * sizeof(T)));
+    }
+
+    /**
+     * @brief Whether the indices read from the cache all point to one of vertexCount
+     * vertices. The file may be damaged, and an index out of range would have the GPU read
+     * past the vertices
+     */
+    static bool indicesInRange(const QVector<uint32_t> &indices, qsizetype vertexCount) {
+        return std::all_of(indices.begin(), indices.end(), [vertexCount](uint32_t index) {
+            return static_cast<qsizetype>(index) < vertexCount;
+        });
+    }
+    /** @brief As above, letting through the marker (i.e. a restart index) between indices */
+    static bool indicesInRange(const QVector<uint32_t> &indices, qsizetype vertexCount,
+                               uint32_t marker) {
+        return std::all_of(indices.begin(), indices.end(), [vertexCount, marker](uint32_t index) {
+            return index == marker || static_cast<qsizetype>(index) < vertexCount;
+        });
+    }
+
+    const QString &getFilename() const { return m_filename; }
+    bool hasPendingWrites();
+    bool flush();
+
+  private:
+    static const uint32_t FILE_MAGIC = 0x43425641; // "AVBC"
+    static const uint32_t FILE_VERSION = 10;
+    static const uint64_t BLOB_ALIGNMENT = 16;
+    // bytes from the start of the graph file hashed into the name, with its size and time
+    static const qint64 HASHED_BYTES = 1 << 16;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t entryCount;
+    };
+
+    struct Entry {
+        uint64_t keyHash;
+        uint64_t keyOffset;
+        uint64_t keySize;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static uint64_t keyHash(const QString &key);
+
+    void map();
+    void unmap();
+    /** @brief Whether the bytes are within the mapped file */
+    bool isMapped(uint64_t offset, uint64_t size) const {
+        return offset <= m_mappedSize && size <= m_mappedSize - offset;
+    }
+    QString getMappedKey(const Entry &entry) const;
+    const Entry *findMapped(const QString &key) const;
+    bool findBlob(const QString &key, const uchar *&blob, uint64_t &size) const;
+    void writeBlob(const QString &key, const char *data, qsizetype size);
+
+    const QString m_filename;
+    QFile m_file;
+    uchar *m_mapped = nullptr;
+    uint64_t m_mappedSize = 0;
+    const Entry *m_entries = nullptr;
+    uint64_t m_entryCount = 0;
+    // one per mapped entry, whether it has been read
+    mutable std::vector<bool> m_entryUsed;
+
+    std::map<QString, QByteArray> m_pending;
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglframehistory.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include <cmath>
+
+static const char *vertexShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "in vec2 vertex;\n"
+    "out vec2 texc;\n"
+    "uniform vec2 offset;\n"
+    "void main() {\n"
+    "   gl_Position = vec4(vertex + offset, 0.0, 1.0);\n"
+    "   texc = vertex * 0.5 + 0.5;\n"
+    "}\n";
+
+static const char *fragmentShaderSourceCore = // auto-format hack
+    "#version 150\n"
+    "uniform sampler2D frame;\n"
+    "in vec2 texc;\n"
+    "out highp vec4 fragColor;\n"
+    "void main() {\n"
+    "   fragColor = texture(frame, texc);\n"
+    "}\n";
+
+static const char *vertexShaderSource = // auto-format hack
+    "attribute highp vec2 vertex;\n"
+    "varying mediump vec2 texc;\n"
+    "uniform highp vec2 offset;\n"
+    "void main() {\n"
+    "   gl_Position = vec4(vertex + offset, 0.0, 1.0);\n"
+    "   texc = vertex * 0.5 + 0.5;\n"
+    "}\n";
+
+static const char *fragmentShaderSource = // auto-format hack
+    "uniform sampler2D frame;\n"
+    "varying mediump vec2 texc;\n"
+    "void main() {\n"
+    "   gl_FragColor = texture2D(frame, texc);\n"
+    "}\n";
+
+void AGLFrameHistory::initializeGL(bool core) {
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex,
+                                       core ? vertexShaderSourceCore : vertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                       core ? fragmentShaderSourceCore : fragmentShaderSource);
+    m_program->bindAttributeLocation("vertex", 0);
+    m_program->link();
+
+    m_program->bind();
+    m_offsetLoc = m_program->uniformLocation("offset");
+    m_textureSamplerLoc = m_program->uniformLocation("frame");
+    m_program->setUniformValue(m_textureSamplerLoc, 0);
+
+    m_vao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    // the viewport as a strip of two triangles, in clip coordinates
+    const GLfloat vertices[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+    m_vbo.create();
+    m_vbo.bind();
+    m_vbo.allocate(vertices, static_cast<int>(sizeof(vertices)));
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glEnableVertexAttribArray(0);
+    f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    m_vbo.release();
+
+    m_program->release();
+}
+
+void AGLFrameHistory::cleanup() {
+    m_frame.reset();
+    m_valid = false;
+    if (m_program == 0)
+        return;
+    m_vbo.destroy();
+    delete m_program;
+    m_program = 0;
+}
+
+QPoint AGLFrameHistory::getOffset(double eyePosX, double eyePosY) const {
+    // a world unit is height / zoomFactor framebuffer pixels in both directions
+    double pixelsPerUnit = m_frame->height() / static_cast<double>(m_zoomFactor);
+    return QPoint(static_cast<int>(std::lround((eyePosX - m_eyePosX) * pixelsPerUnit)),
+                  static_cast<int>(std::lround((eyePosY - m_eyePosY) * pixelsPerUnit)));
+}
+
+void AGLFrameHistory::paintGL(const QPoint &offset) {
+    if (!m_valid || m_program == 0)
+        return;
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(
+        m_offsetLoc, QVector2D(2.0f * static_cast<float>(offset.x()) /
+                                   static_cast<float>(m_frame->width()),
+                               2.0f * static_cast<float>(offset.y()) /
+                                   static_cast<float>(m_frame->height())));
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBindTexture(GL_TEXTURE_2D, m_frame->texture());
+    f->glDisable(GL_BLEND);
+    f->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    f->glEnable(GL_BLEND);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    m_program->release();
+}
+
+void AGLFrameHistory::store(QOpenGLFramebufferObject *source, double eyePosX, double eyePosY,
+                            float zoomFactor) {
+    if (!m_frame || m_frame->size() != source->size()) {
+        // single sampled so that it can be read as a texture, filtered by nearest as it is
+        // only ever drawn moved by whole pixels
+        m_frame = std::make_unique<QOpenGLFramebufferObject>(source->size());
+        QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+        f->glBindTexture(GL_TEXTURE_2D, m_frame->texture());
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        f->glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    QOpenGLFramebufferObject::blitFramebuffer(m_frame.get(), source);
+    // the blit leaves the default framebuffer bound, the source is still drawn to after this
+    source->bind();
+    m_eyePosX = eyePosX;
+    m_eyePosY = eyePosY;
+    m_zoomFactor = zoomFactor;
+    m_valid = true;
+}
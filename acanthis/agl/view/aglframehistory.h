@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QVector2D>
+
+#include <memory>
+
+/**
+ * @brief The last frame drawn by the map view and the camera it was drawn with, so that while
+ * the view is only panned the frame can be drawn again shifted by whole pixels and only the
+ * strips it no longer covers need to be drawn from the map.
+ */
+class AGLFrameHistory {
+  public:
+    AGLFrameHistory() : m_program(0) {}
+    void initializeGL(bool core);
+    void cleanup();
+
+    void invalidate() { m_valid = false; }
+    /** @brief Whether there is a frame of this size drawn at this zoom */
+    bool isValidFor(const QSize &size, float zoomFactor) const {
+        return m_valid && m_frame && m_frame->size() == size && m_zoomFactor == zoomFactor;
+    }
+    /**
+     * @brief Framebuffer pixels the stored frame has to move by to match the camera, with y
+     * up as in GL. Only valid when isValidFor() is.
+     */
+    QPoint getOffset(double eyePosX, double eyePosY) const;
+    /** @brief Camera position that the offset moves the stored frame to exactly */
+    double getSnappedEyePosX(const QPoint &offset) const {
+        return m_eyePosX + offset.x() * static_cast<double>(m_zoomFactor) / m_frame->height();
+    }
+    double getSnappedEyePosY(const QPoint &offset) const {
+        return m_eyePosY + offset.y() * static_cast<double>(m_zoomFactor) / m_frame->height();
+    }
+
+    /** @brief Draws the stored frame over the whole viewport, moved by offset */
+    void paintGL(const QPoint &offset);
+    /** @brief Copies (and resolves if multisampled) the frame drawn with the given camera */
+    void store(QOpenGLFramebufferObject *source, double eyePosX, double eyePosY,
+               float zoomFactor);
+
+    AGLFrameHistory(const AGLFrameHistory &) = delete;
+    AGLFrameHistory &operator=(const AGLFrameHistory &) = delete;
+
+  private:
+    std::unique_ptr<QOpenGLFramebufferObject> m_frame;
+    bool m_valid = false;
+    double m_eyePosX = 0;
+    double m_eyePosY = 0;
+    float m_zoomFactor = 0;
+
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vbo;
+    QOpenGLShaderProgram *m_program;
+    int m_offsetLoc;
+    int m_textureSamplerLoc;
+};
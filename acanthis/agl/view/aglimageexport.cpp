@@ -0,0 +1,145 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglimageexport.h"
+
+#include "../func/aglimagestreamwriter.h"
+
+#include <QFile>
+#include <QImage>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+    // mapping a buffer to read from it needs GL 3.0 or ES 3.0, without it the tiles are read
+    // straight into memory, waiting for each to be drawn
+    bool pixelBufferSupport(QOpenGLContext *context) {
+        const QSurfaceFormat &format = context->format();
+        if (context->isOpenGLES())
+            return format.majorVersion() >= 3;
+        return format.version() >= qMakePair(3, 0);
+    }
+
+    QImage tileImage(const uchar *pixels, const QRect &rect) {
+        QImage image(pixels, rect.width(), rect.height(), rect.width() * 4,
+                     QImage::Format_RGBA8888);
+        // GL rows go bottom to top. The alpha is only what blending over the opaque
+        // background left behind and is dropped
+        return image.mirrored().convertToFormat(QImage::Format_RGB888);
+    }
+} // namespace
+
+bool AGLImageExport::run(const QString &fileName, const QSize &size, const QRectF &region,
+                         const Painter &painter) {
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QOpenGLExtraFunctions *f = context->extraFunctions();
+
+    AGLImageStreamWriter writer(fileName, size, TILE_SIZE);
+    if (!writer.open())
+        return false;
+
+    QOpenGLFramebufferObjectFormat format;
+    format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    format.setSamples(m_antialiasingSamples);
+    QOpenGLFramebufferObject target(TILE_SIZE, TILE_SIZE, format);
+    // a multisampled framebuffer can not be read from, it is resolved into this first
+    std::unique_ptr<QOpenGLFramebufferObject> resolved;
+    if (target.format().samples() > 0)
+        resolved = std::make_unique<QOpenGLFramebufferObject>(TILE_SIZE, TILE_SIZE);
+    QOpenGLFramebufferObject *readSource = resolved ? resolved.get() : &target;
+
+    const int tileBytes = TILE_SIZE * TILE_SIZE * 4;
+    bool pixelBuffers = pixelBufferSupport(context);
+    QOpenGLBuffer buffers[2] = {QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer),
+                                QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer)};
+    if (pixelBuffers) {
+        for (QOpenGLBuffer &buffer : buffers) {
+            buffer.setUsagePattern(QOpenGLBuffer::StreamRead);
+            buffer.create();
+            buffer.bind();
+            buffer.allocate(tileBytes);
+            buffer.release();
+        }
+    }
+    QByteArray directPixels;
+    if (!pixelBuffers)
+        directPixels.resize(tileBytes);
+
+    int tilesAcross = (size.width() + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesDown = (size.height() + TILE_SIZE - 1) / TILE_SIZE;
+    int tileCount = tilesAcross * tilesDown;
+    auto tileRect = [&](int tile) {
+        int x = (tile % tilesAcross) * TILE_SIZE;
+        int y = (tile / tilesAcross) * TILE_SIZE;
+        return QRect(x, y, std::min(TILE_SIZE, size.width() - x),
+                     std::min(TILE_SIZE, size.height() - y));
+    };
+    double unitsPerPixelX = region.width() / size.width();
+    double unitsPerPixelY = region.height() / size.height();
+
+    // each pass draws a tile and collects the one drawn in the pass before
+    bool failed = false;
+    for (int tile = 0; tile <= tileCount && !failed; ++tile) {
+        if (tile < tileCount) {
+            QRect rect = tileRect(tile);
+            // the tile is in the top left of the framebuffer, edge tiles only use part of it
+            double left = region.x() + rect.x() * unitsPerPixelX;
+            double top = region.y() + region.height() - rect.y() * unitsPerPixelY;
+            QMatrix4x4 mProj;
+            mProj.ortho(static_cast<float>(left),
+                        static_cast<float>(left + TILE_SIZE * unitsPerPixelX),
+                        static_cast<float>(top - TILE_SIZE * unitsPerPixelY),
+                        static_cast<float>(top), 0, 10);
+            target.bind();
+            f->glViewport(0, 0, TILE_SIZE, TILE_SIZE);
+            f->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            painter(mProj);
+            if (resolved)
+                QOpenGLFramebufferObject::blitFramebuffer(resolved.get(), &target);
+            readSource->bind();
+            int readY = TILE_SIZE - rect.height();
+            if (!pixelBuffers) {
+                f->glReadPixels(0, readY, rect.width(), rect.height(), GL_RGBA,
+                                GL_UNSIGNED_BYTE, directPixels.data());
+                writer.addTile(
+                    tileImage(reinterpret_cast<const uchar *>(directPixels.constData()), rect));
+                continue;
+            }
+            // returns at once, the copy happens while the next tile is drawn
+            buffers[tile % 2].bind();
+            f->glReadPixels(0, readY, rect.width(), rect.height(), GL_RGBA, GL_UNSIGNED_BYTE,
+                            nullptr);
+            buffers[tile % 2].release();
+        }
+        if (!pixelBuffers || tile == 0)
+            continue;
+        QRect rect = tileRect(tile - 1);
+        QOpenGLBuffer &buffer = buffers[(tile - 1) % 2];
+        buffer.bind();
+        void *pixels = buffer.mapRange(0, rect.width() * rect.height() * 4,
+                                       QOpenGLBuffer::RangeRead);
+        if (pixels) {
+            QImage image = tileImage(static_cast<const uchar *>(pixels), rect);
+            buffer.unmap();
+            writer.addTile(image);
+        } else {
+            failed = true;
+        }
+        buffer.release();
+    }
+
+    readSource->release();
+    for (QOpenGLBuffer &buffer : buffers) {
+        buffer.destroy();
+    }
+    bool written = writer.finish() && !failed;
+    if (!written)
+        QFile::remove(fileName);
+    return written;
+}
@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QMatrix4x4>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+
+#include <functional>
+
+/**
+ * @brief Draws a view into an image file of any size, a tile at a time through an offscreen
+ * framebuffer. Each tile is read back through one of two pixel buffers so that reading it
+ * overlaps drawing the next one, and is then handed to an AGLImageStreamWriter that
+ * compresses and writes it on worker threads.
+ */
+class AGLImageExport {
+  public:
+    static const int TILE_SIZE = 1024;
+
+    /** @brief Draws the view into the bound framebuffer with the given projection */
+    using Painter = std::function<void(const QMatrix4x4 &mProj)>;
+
+    explicit AGLImageExport(int antialiasingSamples) : m_antialiasingSamples(antialiasingSamples) {}
+
+    /**
+     * @brief Draws the image of the given size, region being the bounds of the orthographic
+     * projection over the whole of it. Needs a current context, and leaves the default
+     * framebuffer bound and the viewport set to the tile.
+     */
+    bool run(const QString &fileName, const QSize &size, const QRectF &region,
+             const Painter &painter);
+
+  private:
+    int m_antialiasingSamples;
+};
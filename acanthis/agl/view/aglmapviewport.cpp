@@ -4,10 +4,46 @@
 
 #include "aglmapviewport.h"
 
+#include <QDebug>
 #include <QOpenGLContext>
 #include <QOpenGLShaderProgram>
+#include <QScreen>
+#include <QSemaphore>
 #include <QtCore/QRunnable>
 
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // longest side of the picture kept of an unloaded document
+    const int UNLOADED_THUMBNAIL_SIZE = 256;
+
+    class ReleaseRendererJob : public QRunnable {
+        AGLMapViewRenderer *m_renderer;
+        QImage &m_lastFrame;
+        QSemaphore &m_done;
+        bool m_ran = false;
+
+      public:
+        ReleaseRendererJob(AGLMapViewRenderer *renderer, QImage &lastFrame, QSemaphore &done)
+            : m_renderer(renderer), m_lastFrame(lastFrame), m_done(done) {}
+        ~ReleaseRendererJob() {
+            // a window that is not being drawn deletes its jobs without running them, the
+            // renderer is not drawing then either
+            if (!m_ran)
+                m_renderer->releaseLayers();
+            m_done.release();
+        }
+        void run() override {
+            // the GL context of the renderer is current for jobs
+            m_lastFrame = m_renderer->grabLastFrame(
+                QSize(UNLOADED_THUMBNAIL_SIZE, UNLOADED_THUMBNAIL_SIZE));
+            m_renderer->releaseLayers();
+            m_ran = true;
+        }
+    };
+} // namespace
+
 AGLMapViewport::AGLMapViewport() : m_eyePosX(0), m_eyePosY(0) {
     setAcceptHoverEvents(true);
     setAcceptedMouseButtons(Qt::AllButtons);
@@ -16,6 +52,12 @@ AGLMapViewport::AGLMapViewport() : m_eyePosX(0), m_eyePosY(0) {
     // renderer is initially created as "dirty" because two passes are
     // necessary for it to provide a clean OpenGL context.
     m_dirtyRenderer = true;
+
+    m_frameClock.start();
+    m_interactionTimer.setSingleShot(true);
+    m_interactionTimer.setInterval(INTERACTION_IDLE_TIME);
+    // one more frame, at full quality
+    connect(&m_interactionTimer, &QTimer::timeout, this, &QQuickItem::update);
 }
 
 void AGLMapViewport::handleWindowSync() {
@@ -30,11 +72,120 @@ void AGLMapViewport::forceUpdate() {
     setDirtyRenderer();
 }
 
-void AGLMapViewport::mouseReleaseEvent(QMouseEvent *) {
+void AGLMapViewport::releaseRenderer() {
+    m_graphViewModel->setCamera(m_eyePosX, m_eyePosY, m_zoomFactor);
+    std::shared_ptr<AGLMapViewRenderer *> renderer = m_renderer.lock();
+    if (!renderer)
+        return;
+    if (window() == nullptr) {
+        (*renderer)->releaseLayers();
+        return;
+    }
+    // run on the render thread between frames, or right away without one
+    QImage lastFrame;
+    QSemaphore done;
+    window()->scheduleRenderJob(new ReleaseRendererJob(*renderer, lastFrame, done),
+                                QQuickWindow::NoStage);
+    done.acquire();
+    if (!lastFrame.isNull())
+        m_graphViewModel->setUnloadedThumbnail(lastFrame);
+}
+
+void AGLMapViewport::advanceFrame() {
+    qint64 now = m_frameClock.nsecsElapsed();
+    float frameTime;
+    if (m_lastFrameTime < 0) {
+        // first frame after being idle, assume a frame at the refresh rate
+        qreal refreshRate = window()->screen() ? window()->screen()->refreshRate() : 60.0;
+        frameTime = 1.0f / static_cast<float>(refreshRate > 0 ? refreshRate : 60.0);
+    } else {
+        frameTime = std::min(static_cast<float>(now - m_lastFrameTime) * 1e-9f, 0.1f);
+    }
+    bool animating = false;
+
+    if (!m_pendingPan.isNull()) {
+        panByPixels(m_pendingPan);
+        if (m_dragging) {
+            // by the time since the pan was last applied rather than the frame time, which
+            // is only known once the view animates. Averaged over the last few frames, to
+            // carry on with once the drag is released
+            float panTime = std::clamp(static_cast<float>(now - m_lastPanAppliedTime) * 1e-9f,
+                                       MIN_PAN_TIME, 0.1f);
+            m_panVelocity = 0.5 * m_panVelocity + 0.5 * m_pendingPan / panTime;
+        }
+        m_lastPanAppliedTime = now;
+        m_pendingPan = QPointF();
+    } else if (!m_dragging && !m_panVelocity.isNull()) {
+        panByPixels(m_panVelocity * frameTime);
+        m_panVelocity *= std::exp(-frameTime / PAN_INERTIA_TIME);
+        if (std::hypot(m_panVelocity.x(), m_panVelocity.y()) < MIN_PAN_SPEED)
+            m_panVelocity = QPointF();
+        else
+            animating = true;
+    }
+
+    if (m_zoomFactor != m_targetZoomFactor) {
+        // move towards the target in log space, so that each frame zooms by the same ratio
+        float blend = 1.0f - std::exp(-frameTime / ZOOM_TIME);
+        float zoomFactor = m_zoomFactor * std::pow(m_targetZoomFactor / m_zoomFactor, blend);
+        if (std::abs(zoomFactor / m_targetZoomFactor - 1.0f) < 1e-3f)
+            zoomFactor = m_targetZoomFactor;
+        else
+            animating = true;
+        zoomTo(zoomFactor, m_zoomAnchor);
+    }
+
+    if (m_pendingInputTime >= 0) {
+        m_appliedInputTime.store(m_pendingInputTime);
+        m_pendingInputTime = -1;
+    }
+
+    if (animating) {
+        m_lastFrameTime = now;
+        update();
+    } else {
+        if (m_lastFrameTime >= 0)
+            m_interactionTimer.start();
+        m_lastFrameTime = -1;
+    }
+}
+
+void AGLMapViewport::handleFrameSwapped() {
+    qint64 inputTime = m_appliedInputTime.exchange(-1);
+    if (inputTime < 0)
+        return;
+    m_inputLatency.store(m_frameClock.nsecsElapsed() - inputTime);
+    emit inputLatencyChanged();
+}
+
+void AGLMapViewport::queueInput() {
+    if (m_pendingInputTime < 0)
+        m_pendingInputTime = m_frameClock.nsecsElapsed();
+    m_interactionTimer.start();
+    update();
+}
+
+void AGLMapViewport::mouseReleaseEvent(QMouseEvent *event) {
+    m_dragging = false;
     if (m_wasPanning) {
+        m_interactionTimer.start();
         m_wasPanning = false;
+        if (m_frameClock.nsecsElapsed() - m_lastPanInputTime > INERTIA_RELEASE_WINDOW)
+            m_panVelocity = QPointF();
+        update();
         return;
     }
+    switch (m_interactionMode) {
+    case InteractionMode::NONE:
+        // nothing, deselect
+        clearSelection();
+        break;
+    case InteractionMode::SELECT:
+        selectRegion(getSelectionRegion(event->pos()), event->modifiers());
+        break;
+    default:
+        break;
+    }
     //    QPoint mousePoint = event->pos();
     //    Point2f worldPoint = getWorldPoint(mousePoint);
     //    if (!m_pDoc.m_communicator) {
@@ -54,19 +205,6 @@ void AGLMapViewport::mouseReleaseEvent(QMouseEvent *) {
     //        }
     //        bool selected = false;
     //        switch (m_interactionMode) {
-    //        case InteractionMode::NONE: {
-    //            // nothing, deselect
-    //            m_pDoc.getMetaGraph().clearSel();
-    //            break;
-    //        }
-    //        case InteractionMode::SELECT: {
-    //            // typical selection
-    //            Qt::KeyboardModifiers keyMods = QApplication::keyboardModifiers();
-    //            m_pDoc.getMetaGraph().setCurSel(r, keyMods & Qt::ShiftModifier);
-    //            ((MainWindow *)m_pDoc.m_mainFrame)->updateToolbar();
-    //            if (m_highlightOnHover) highlightHoveredItems(r);
-    //            break;
-    //        }
     //        case InteractionMode::ZOOM_IN: {
     //            if (r.width() > 0) {
     //                OnViewZoomToRegion(r);
@@ -281,15 +419,58 @@ void AGLMapViewport::mouseReleaseEvent(QMouseEvent *) {
     update();
 }
 
+QtRegion AGLMapViewport::getSelectionRegion(const QPoint &mousePoint) {
+    QtRegion region;
+    if (m_mouseDragRect.isNull()) {
+        // a click, take the items within a few pixels of it
+        const int tolerance = 3;
+        Point2f bottomLeft = getWorldPoint(mousePoint + QPoint(-tolerance, tolerance));
+        Point2f topRight = getWorldPoint(mousePoint + QPoint(tolerance, -tolerance));
+        region.bottom_left = bottomLeft;
+        region.top_right = topRight;
+    } else {
+        QRectF rect = m_mouseDragRect.normalized();
+        region.bottom_left = Point2f(rect.left(), rect.top());
+        region.top_right = Point2f(rect.right(), rect.bottom());
+    }
+    return region;
+}
+
+void AGLMapViewport::selectRegion(const QtRegion &region, Qt::KeyboardModifiers modifiers) {
+    if (m_graphViewModel == nullptr)
+        return;
+    SelectionSet::Operation operation = SelectionSet::Operation::REPLACE;
+    if (modifiers & Qt::ShiftModifier)
+        operation = SelectionSet::Operation::UNITE;
+    else if (modifiers & Qt::ControlModifier)
+        operation = SelectionSet::Operation::SUBTRACT;
+    else if (modifiers & Qt::AltModifier)
+        operation = SelectionSet::Operation::INTERSECT;
+    for (auto &mapLayer : m_graphViewModel->getMapLayers()) {
+        if (mapLayer->isVisible())
+            mapLayer->select(region, operation);
+    }
+}
+
+void AGLMapViewport::clearSelection() {
+    if (m_graphViewModel == nullptr)
+        return;
+    for (auto &mapLayer : m_graphViewModel->getMapLayers()) {
+        mapLayer->clearSelection();
+    }
+}
+
 void AGLMapViewport::mousePressEvent(QMouseEvent *event) {
     emit mousePressed();
     std::cout << "click" << std::endl;
     m_mouseLastPos = event->pos();
+    // grabbing the view stops it
+    m_panVelocity = QPointF();
+    m_lastPanAppliedTime = m_frameClock.nsecsElapsed();
 }
 
 void AGLMapViewport::mouseMoveEvent(QMouseEvent *event) {
-    auto dx = static_cast<int>(event->position().x() - m_mouseLastPos.x());
-    auto dy = static_cast<int>(event->position().y() - m_mouseLastPos.y());
+    QPointF delta = event->position() - m_mouseLastPos;
 
     Point2f worldPoint = getWorldPoint(event->pos());
 
@@ -302,8 +483,12 @@ void AGLMapViewport::mouseMoveEvent(QMouseEvent *event) {
 
     if (event->buttons() & Qt::RightButton ||
         (event->buttons() & Qt::LeftButton && m_interactionMode == InteractionMode::PAN)) {
-        panBy(dx, dy);
+        // applied with the next frame
+        m_pendingPan += delta;
+        m_lastPanInputTime = m_frameClock.nsecsElapsed();
+        m_dragging = true;
         m_wasPanning = true;
+        queueInput();
     } else if (event->buttons() & Qt::LeftButton) {
         Point2f lastWorldPoint = getWorldPoint(m_mouseLastPos);
 
@@ -357,12 +542,13 @@ void AGLMapViewport::mouseMoveEvent(QMouseEvent *event) {
 void AGLMapViewport::wheelEvent(QWheelEvent *event) {
     QPoint numDegrees = event->angleDelta() / 8;
 
-    auto x = static_cast<int>(event->position().x());
-    auto y = static_cast<int>(event->position().y());
-
-    zoomBy(1 - 0.25f * static_cast<float>(numDegrees.y()) / 15.0f, x, y);
-
-    update();
+    // the zoom is animated towards the target over the next frames, wheel events arriving
+    // in between only move the target
+    float dzf = 1 - 0.25f * static_cast<float>(numDegrees.y()) / 15.0f;
+    m_targetZoomFactor =
+        std::clamp(m_targetZoomFactor * dzf, m_minZoomFactor, m_maxZoomFactor);
+    m_zoomAnchor = event->position();
+    queueInput();
 
     event->accept();
 }
@@ -407,26 +593,30 @@ bool AGLMapViewport::eventFilter(QObject *object, QEvent *e) {
 }
 
 void AGLMapViewport::zoomBy(float dzf, int mouseX, int mouseY) {
-    GLfloat screenRatio = static_cast<GLfloat>(width()) / static_cast<GLfloat>(height());
-    float pzf = m_zoomFactor;
-    m_zoomFactor = m_zoomFactor * dzf;
-    if (m_zoomFactor < m_minZoomFactor)
-        m_zoomFactor = m_minZoomFactor;
-    else if (m_zoomFactor > m_maxZoomFactor)
-        m_zoomFactor = m_maxZoomFactor;
-    m_eyePosX +=
-        (m_zoomFactor - pzf) * screenRatio * GLfloat(mouseX - width() * 0.5f) / GLfloat(width());
-    m_eyePosY -= (m_zoomFactor - pzf) * GLfloat(mouseY - height() * 0.5f) / GLfloat(height());
+    zoomTo(m_zoomFactor * dzf, QPointF(mouseX, mouseY));
+    m_targetZoomFactor = m_zoomFactor;
     update();
 }
 
-void AGLMapViewport::panBy(int dx, int dy) {
-    m_eyePosX += m_zoomFactor * (static_cast<GLfloat>(dx) / static_cast<GLfloat>(height()));
-    m_eyePosY -= m_zoomFactor * (static_cast<GLfloat>(dy) / static_cast<GLfloat>(height()));
+void AGLMapViewport::zoomTo(float zoomFactor, const QPointF &anchor) {
+    float pzf = m_zoomFactor;
+    m_zoomFactor = std::clamp(zoomFactor, m_minZoomFactor, m_maxZoomFactor);
+    m_eyePosX += (m_zoomFactor - pzf) * static_cast<float>(anchor.x() - width() * 0.5) /
+                 static_cast<float>(height());
+    m_eyePosY -= (m_zoomFactor - pzf) * static_cast<float>(anchor.y() - height() * 0.5) /
+                 static_cast<float>(height());
+}
 
+void AGLMapViewport::panBy(int dx, int dy) {
+    panByPixels(QPointF(dx, dy));
     update();
 }
 
+void AGLMapViewport::panByPixels(const QPointF &delta) {
+    m_eyePosX += m_zoomFactor * static_cast<float>(delta.x()) / static_cast<float>(height());
+    m_eyePosY -= m_zoomFactor * static_cast<float>(delta.y()) / static_cast<float>(height());
+}
+
 Point2f AGLMapViewport::getWorldPoint(const QPoint &screenPoint) {
     return Point2f(+m_zoomFactor * float(screenPoint.x() - width() * 0.5) / height() - m_eyePosX,
                    -m_zoomFactor * float(screenPoint.y() - height() * 0.5) / height() - m_eyePosY);
@@ -546,8 +736,8 @@ void AGLMapViewport::zoomToRegion(const QtRegion region) {
         (region.top_right.y == 0 && region.bottom_left.y == 0))
         // region is unset, don't try to change the view to it
         return;
-    m_eyePosX = -static_cast<float>(region.top_right.x + region.bottom_left.x) * 0.5f;
-    m_eyePosY = -static_cast<float>(region.top_right.y + region.bottom_left.y) * 0.5f;
+    m_eyePosX = -(region.top_right.x + region.bottom_left.x) * 0.5;
+    m_eyePosY = -(region.top_right.y + region.bottom_left.y) * 0.5;
     if (region.width() > region.height()) {
         m_zoomFactor = static_cast<float>(region.top_right.x - region.bottom_left.x);
     } else {
@@ -555,6 +745,9 @@ void AGLMapViewport::zoomToRegion(const QtRegion region) {
     }
     m_minZoomFactor = static_cast<float>(m_zoomFactor) * 0.001f;
     m_maxZoomFactor = m_zoomFactor * 10;
+    // stop any animation that would carry on from the old view
+    m_targetZoomFactor = m_zoomFactor;
+    m_panVelocity = QPointF();
 }
 
 // void GLMapView::OnEditCopy() {
@@ -571,14 +764,33 @@ void AGLMapViewport::zoomToRegion(const QtRegion region) {
 //    tmp->close();
 //}
 
-// void GLMapView::OnEditSave() {
-//    std::unique_ptr<QDepthmapView> tmp(new QDepthmapView(m_pDoc, m_settings));
-//    Point2f topLeftWorld = getWorldPoint(QPoint(0, 0));
-//    Point2f bottomRightWorld = getWorldPoint(QPoint(width(), height()));
+void AGLMapViewport::exportImage(const QUrl &file, int width) {
+    if (width <= 0 || this->width() <= 0 || height() <= 0)
+        return;
+    m_exportFile = file.isLocalFile() ? file.toLocalFile() : file.toString();
+    m_exportSize = QSize(width, std::max(1, qRound(width * height() / this->width())));
+    update();
+}
 
-//    tmp->setAttribute(Qt::WA_DontShowOnScreen);
-//    tmp->show();
-//    tmp->postLoadFile();
-//    tmp->OnViewZoomToRegion(QtRegion(topLeftWorld, bottomRightWorld));
-//    tmp->OnEditSave();
-//}
+void AGLMapViewport::exportVectors(const QUrl &file) {
+    if (m_graphViewModel == nullptr || width() <= 0 || height() <= 0)
+        return;
+    QtRegion region;
+    region.bottom_left = getWorldPoint(QPoint(0, static_cast<int>(height())));
+    region.top_right = getWorldPoint(QPoint(static_cast<int>(width()), 0));
+    QString fileName = file.isLocalFile() ? file.toLocalFile() : file.toString();
+    AGLVectorWriter writer(fileName, region, QSizeF(width(), height()), m_backgroundColour);
+    bool written = writer.open();
+    if (written) {
+        for (auto &mapLayer : m_graphViewModel->getMapLayers()) {
+            if (!mapLayer->isVisible())
+                continue;
+            writer.beginLayer(mapLayer->getName());
+            mapLayer->writeVectors(writer, region);
+            writer.endLayer();
+        }
+        written = writer.finish();
+    }
+    if (!written)
+        qWarning() << "Could not export the view to" << fileName;
+}
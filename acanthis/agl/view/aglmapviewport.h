@@ -8,11 +8,17 @@
 
 #include "graphviewmodel.h"
 
+#include <QElapsedTimer>
 #include <QOpenGLFunctions>
 #include <QSettings>
+#include <QTimer>
+#include <QUrl>
 #include <QtQuick/QQuickFramebufferObject>
 #include <QtQuick/QQuickWindow>
 
+#include <atomic>
+#include <memory>
+
 class AGLMapViewport : public QQuickFramebufferObject {
     Q_OBJECT
     QML_ELEMENT
@@ -26,6 +32,15 @@ class AGLMapViewport : public QQuickFramebufferObject {
                    MEMBER m_antialiasingSamples NOTIFY antialiasingSamplesChanged)
     Q_PROPERTY(bool highlightOnHover //
                    MEMBER m_highlightOnHover NOTIFY highlightOnHoverChanged)
+    Q_PROPERTY(bool vertexBufferCache //
+                   MEMBER m_vertexBufferCache NOTIFY vertexBufferCacheChanged)
+    Q_PROPERTY(bool rasterTiles //
+                   MEMBER m_rasterTiles NOTIFY rasterTilesChanged)
+    Q_PROPERTY(QString basemapFile //
+                   MEMBER m_basemapFile NOTIFY basemapFileChanged)
+    Q_PROPERTY(float inputLatency READ getInputLatency NOTIFY inputLatencyChanged)
+    Q_PROPERTY(float targetFrameTime //
+                   MEMBER m_targetFrameTime NOTIFY targetFrameTimeChanged)
 
     GraphViewModel *m_graphViewModel = nullptr;
     QQuickFramebufferObject::Renderer *createRenderer() const override {
@@ -37,11 +52,27 @@ class AGLMapViewport : public QQuickFramebufferObject {
                 Qt::DirectConnection);
         connect(this, &QQuickItem::heightChanged, this, &AGLMapViewport::forceUpdate,
                 Qt::DirectConnection);
+        // the renderer is created again whenever the scene graph is, these are kept unique
+        // so that a frame is not advanced (or timed) once per renderer ever made
+        auto uniqueDirect =
+            static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection);
+        // once per frame on the GUI thread, just before the renderer is synchronised
+        connect(window(), &QQuickWindow::afterAnimating, this, &AGLMapViewport::advanceFrame,
+                uniqueDirect);
+        // on the render thread, when the frame is handed to the display
+        connect(window(), &QQuickWindow::frameSwapped, this,
+                &AGLMapViewport::handleFrameSwapped, uniqueDirect);
 
-        return new AGLMapViewRenderer(this, m_graphViewModel, m_foregroundColour,
-                                      m_backgroundColour, m_antialiasingSamples,
-                                      m_highlightOnHover);
+        auto renderer = new AGLMapViewRenderer(this, m_graphViewModel, m_foregroundColour,
+                                               m_backgroundColour, m_antialiasingSamples,
+                                               m_highlightOnHover, m_vertexBufferCache,
+                                               m_rasterTiles);
+        m_renderer = renderer->getHandle();
+        return renderer;
     }
+    // the renderer is destroyed on the render thread, which while the item is there only
+    // happens with the GUI thread blocked
+    mutable std::weak_ptr<AGLMapViewRenderer *> m_renderer;
 
   public:
     AGLMapViewport();
@@ -49,7 +80,18 @@ class AGLMapViewport : public QQuickFramebufferObject {
         if (graphViewModel == nullptr)
             return;
         m_graphViewModel = graphViewModel;
+        connect(m_graphViewModel, &GraphViewModel::mapLayersAboutToBeReleased, this,
+                &AGLMapViewport::releaseRenderer, Qt::UniqueConnection);
         matchViewToCurrentMetaGraph();
+        // a view of a document that was unloaded goes back to where it was looking
+        double eyePosX, eyePosY;
+        float zoomFactor;
+        if (m_graphViewModel->getCamera(eyePosX, eyePosY, zoomFactor)) {
+            m_eyePosX = eyePosX;
+            m_eyePosY = eyePosY;
+            m_zoomFactor = zoomFactor;
+            m_targetZoomFactor = zoomFactor;
+        }
 
         emit graphViewModelChanged();
         setDirtyRenderer();
@@ -67,12 +109,37 @@ class AGLMapViewport : public QQuickFramebufferObject {
 
     Point2f getWorldPoint(const QPoint &screenPoint);
     QPoint getScreenPoint(const Point2f &worldPoint);
-    float getEyePosX() { return m_eyePosX; }
-    float getEyePosY() { return m_eyePosY; }
+    double getEyePosX() { return m_eyePosX; }
+    double getEyePosY() { return m_eyePosY; }
     float getZoomFactor() { return m_zoomFactor; }
     QRectF getMouseDragRect() { return m_mouseDragRect; }
     QColor getForegroundColour() { return m_foregroundColour; }
     QColor getBackgroundColour() { return m_backgroundColour; }
+    /** @brief Milliseconds per frame the view aims for while being panned or zoomed */
+    float getTargetFrameTime() const { return m_targetFrameTime; }
+    const QString &getBasemapFile() const { return m_basemapFile; }
+    /** @brief Hands over the export asked for by exportImage(), if there is one */
+    bool takeExportRequest(QString &fileName, QSize &size) {
+        if (m_exportFile.isEmpty())
+            return false;
+        fileName = m_exportFile;
+        size = m_exportSize;
+        m_exportFile.clear();
+        return true;
+    }
+    /** @brief Whether the view is moving, or has been in the last moment */
+    bool isInteracting() const {
+        return m_dragging || m_lastFrameTime >= 0 || m_interactionTimer.isActive();
+    }
+    /** @brief Whether the only change to the view is a pan, by a drag or what is left of one */
+    bool isPanningOnly() const {
+        return ((m_dragging && m_wasPanning) || !m_panVelocity.isNull()) &&
+               m_zoomFactor == m_targetZoomFactor;
+    }
+    /** @brief Milliseconds from the last input that moved the view to the frame showing it */
+    float getInputLatency() const {
+        return static_cast<float>(m_inputLatency.load()) * 1e-6f;
+    }
 
     void setModeJoin();
     void setModeUnjoin();
@@ -98,7 +165,17 @@ class AGLMapViewport : public QQuickFramebufferObject {
     void setModeSelect();
 
     void OnEditCopy();
-    void OnEditSave();
+    /**
+     * @brief Saves the current view as a PNG or TIFF (by the suffix of the file) of the given
+     * width, and the height that keeps the shape of the view. It is drawn by the renderer with
+     * the next frame, in tiles so that it may be far larger than what one framebuffer holds
+     */
+    Q_INVOKABLE void exportImage(const QUrl &file, int width);
+    /**
+     * @brief Saves what the view shows of the visible layers as an SVG or a PDF (by the
+     * suffix of the file), on a page of the size of the view with a pixel to a unit
+     */
+    Q_INVOKABLE void exportVectors(const QUrl &file);
 
     void postLoadFile();
 
@@ -109,8 +186,13 @@ class AGLMapViewport : public QQuickFramebufferObject {
     void backgroundColourChanged(const QColor &colour);
     void antialiasingSamplesChanged();
     void highlightOnHoverChanged();
+    void vertexBufferCacheChanged();
+    void rasterTilesChanged();
+    void basemapFileChanged();
     void graphViewModelChanged();
     void mousePressed();
+    void inputLatencyChanged();
+    void targetFrameTimeChanged();
 
   protected:
     void mouseReleaseEvent(QMouseEvent *) override;
@@ -122,12 +204,54 @@ class AGLMapViewport : public QQuickFramebufferObject {
   private slots:
     void handleWindowSync();
     void forceUpdate();
+    void advanceFrame();
+    void handleFrameSwapped();
+    /**
+     * @brief Waits for the renderer to stop drawing from the layers, which are about to go
+     * away with the document, and keeps the camera and the last frame for when it is back
+     */
+    void releaseRenderer();
 
   private:
+    // time for the zoom to get most of the way (1 - 1/e) to the wheel target
+    static constexpr float ZOOM_TIME = 0.06f;
+    // time for the pan to lose most of its speed after a drag is released
+    static constexpr float PAN_INERTIA_TIME = 0.25f;
+    // in pixels per second, below this the pan stops
+    static constexpr float MIN_PAN_SPEED = 20.0f;
+    // shortest time a pan is taken to be over, so that two pans applied in quick succession
+    // do not give the view a huge speed
+    static constexpr float MIN_PAN_TIME = 0.004f;
+    // a drag released after holding still for longer than this doesn't keep moving
+    static const qint64 INERTIA_RELEASE_WINDOW = 50000000;
+    // milliseconds after the last input or animation frame until the view counts as idle and
+    // is drawn again at full quality
+    static const int INTERACTION_IDLE_TIME = 200;
+
+    void panByPixels(const QPointF &delta);
+    /** @brief Sets the zoom keeping the world point under the anchor in place */
+    void zoomTo(float zoomFactor, const QPointF &anchor);
+    /** @brief Marks the start of a view change still to be applied, for the latency */
+    void queueInput();
+
+    /** @brief The drag rectangle in world coordinates, or a small region around a click */
+    QtRegion getSelectionRegion(const QPoint &mousePoint);
+    /** @brief Shift adds to the selection, Ctrl removes from it and Alt intersects with it */
+    void selectRegion(const QtRegion &region, Qt::KeyboardModifiers modifiers);
+    void clearSelection();
+
     QColor m_foregroundColour;
     QColor m_backgroundColour;
     int m_antialiasingSamples;
     bool m_highlightOnHover;
+    bool m_vertexBufferCache = false;
+    bool m_rasterTiles = false;
+    // an MBTiles file drawn under the layers, taking the world coordinates as Web Mercator
+    QString m_basemapFile;
+
+    // waiting for the renderer to pick it up
+    QString m_exportFile;
+    QSize m_exportSize;
 
     // user interaction
     enum class InteractionMode {
@@ -155,12 +279,33 @@ class AGLMapViewport : public QQuickFramebufferObject {
     QPoint m_mouseLastPos;
     bool m_wasPanning = false;
 
-    float m_eyePosX;
-    float m_eyePosY;
+    // double as far from (0, 0) a float can not place the camera finely enough, see
+    // AGLObject::setOrigin
+    double m_eyePosX;
+    double m_eyePosY;
     float m_minZoomFactor = 1;
     float m_zoomFactor = 20;
     float m_maxZoomFactor = 200;
 
+    // Pan and zoom input is gathered between frames and applied once in advanceFrame, with
+    // the wheel zoom and the pan after a drag animated over the frame times
+    QElapsedTimer m_frameClock;
+    qint64 m_lastFrameTime = -1;
+    QPointF m_pendingPan;
+    qint64 m_lastPanInputTime = 0;
+    // when the pan was last applied (or the drag started), the pan velocity is over this
+    qint64 m_lastPanAppliedTime = 0;
+    bool m_dragging = false;
+    QPointF m_panVelocity;
+    float m_targetZoomFactor = 20;
+    QPointF m_zoomAnchor;
+    // frame clock times, -1 when there is no input waiting
+    qint64 m_pendingInputTime = -1;
+    std::atomic<qint64> m_appliedInputTime{-1};
+    std::atomic<qint64> m_inputLatency{0};
+    QTimer m_interactionTimer;
+    float m_targetFrameTime = AGLQualityGovernor::DEFAULT_TARGET_FRAME_TIME;
+
     QRectF m_mouseDragRect = QRectF(0, 0, 0, 0);
 
     bool m_dirtyRenderer = false;
@@ -4,9 +4,15 @@
 
 #include "aglmapviewrenderer.h"
 #include "agl/viewmodel/aglmapviewmodel.h"
+#include "aglimageexport.h"
 #include "aglmapviewport.h"
 
+#include <QDebug>
 #include <QQuickOpenGLUtils>
+#include <QUrl>
+
+#include <cstdlib>
+#include <vector>
 
 void AGLMapViewRenderer::synchronize(QQuickFramebufferObject *item) {
     AGLMapViewport *glView = static_cast<AGLMapViewport *>(item);
@@ -17,6 +23,35 @@ void AGLMapViewRenderer::synchronize(QQuickFramebufferObject *item) {
     m_foregroundColour = glView->getForegroundColour();
     m_backgroundColour = glView->getBackgroundColour();
     m_backgroundColourChanged = true;
+    if (glView->getBasemapFile() != m_basemapFile) {
+        m_basemapFile = glView->getBasemapFile();
+        m_basemapFileChanged = true;
+    }
+    glView->takeExportRequest(m_exportFile, m_exportSize);
+    if (glView->getGraphViewModel().getLayersGeneration() != m_layersGeneration) {
+        m_layersGeneration = glView->getGraphViewModel().getLayersGeneration();
+        m_layersChanged = true;
+    }
+    // a model about to be replaced would only pick up the new layers to throw them away
+    if (!m_layersChanged && m_model->hasGraphViewModel())
+        m_model->synchronize();
+
+    AGLQualityGovernor::Level previousLevel = m_qualityGovernor.getLevel();
+    m_qualityGovernor.setTargetFrameTime(glView->getTargetFrameTime());
+    AGLQualityGovernor::Level level = m_qualityGovernor.nextFrame(glView->isInteracting());
+    bool framebufferChanged =
+        AGLQualityGovernor::resolutionScale(level) !=
+            AGLQualityGovernor::resolutionScale(previousLevel) ||
+        (level >= AGLQualityGovernor::Level::NO_ANTIALIASING) !=
+            (previousLevel >= AGLQualityGovernor::Level::NO_ANTIALIASING);
+    if (framebufferChanged)
+        invalidateFramebufferObject();
+    m_model->setReducedDetail(level >= AGLQualityGovernor::Level::COARSE_DETAIL,
+                              level >= AGLQualityGovernor::Level::NO_OVERLAYS);
+
+    // anything but a pan changes what the previous frame shows
+    m_reprojectionAllowed = glView->isPanningOnly() && !m_layersChanged && !framebufferChanged &&
+                            level == previousLevel;
     recalcView();
 }
 
@@ -24,10 +59,18 @@ AGLMapViewRenderer::AGLMapViewRenderer(const QQuickFramebufferObject *item,
                                        const GraphViewModel *graphViewModel,
                                        const QColor &foregrounColour,
                                        const QColor &backgroundColour, int antialiasingSamples,
-                                       bool highlightOnHover)
+                                       bool highlightOnHover, bool useVertexBufferCache,
+                                       bool useRasterTiles)
     : m_item(static_cast<const AGLMapViewport *>(item)), m_foregroundColour(foregrounColour),
-      m_backgroundColour(backgroundColour), m_model(new AGLMapViewModel(graphViewModel)),
-      m_highlightOnHover(highlightOnHover), m_antialiasingSamples(antialiasingSamples) {
+      m_backgroundColour(backgroundColour), m_graphViewModel(graphViewModel),
+      m_model(new AGLMapViewModel(graphViewModel,
+                                  useVertexBufferCache && graphViewModel
+                                      ? graphViewModel->getVertexBufferCache()
+                                      : nullptr,
+                                  useRasterTiles)),
+      m_useVertexBufferCache(useVertexBufferCache), m_useRasterTiles(useRasterTiles),
+      m_highlightOnHover(highlightOnHover),
+      m_antialiasingSamples(antialiasingSamples) {
 
     if (!m_model->hasGraphViewModel())
         return;
@@ -38,6 +81,8 @@ AGLMapViewRenderer::AGLMapViewRenderer(const QQuickFramebufferObject *item,
         format.setSamples(m_antialiasingSamples);
     }
 
+    m_layersGeneration = graphViewModel->getLayersGeneration();
+
     loadAxes();
 
     m_model->loadGLObjects();
@@ -52,6 +97,8 @@ AGLMapViewRenderer::AGLMapViewRenderer(const QQuickFramebufferObject *item,
     m_selectionRect.initializeGL(m_core);
     m_dragLine.initializeGL(m_core);
     m_axes.initializeGL(m_core);
+    m_frameHistory.initializeGL(m_core);
+    m_basemap.initializeGL(m_core);
 
     m_model->initializeGL(m_core);
 
@@ -63,10 +110,40 @@ AGLMapViewRenderer::AGLMapViewRenderer(const QQuickFramebufferObject *item,
     m_mView.translate(0, 0, -1);
 }
 
+void AGLMapViewRenderer::reloadModel() {
+    // the layers the model was built from no longer exist, only the GL side of it can
+    // be cleaned up
+    m_model->cleanup();
+    m_model.reset(new AGLMapViewModel(
+        m_graphViewModel,
+        m_useVertexBufferCache ? m_graphViewModel->getVertexBufferCache() : nullptr,
+        m_useRasterTiles));
+    m_model->loadGLObjects();
+    m_model->initializeGL(m_core);
+    m_model->loadGLObjectsRequiringGLContext();
+}
+
+void AGLMapViewRenderer::releaseLayers() {
+    m_model->releaseLayers();
+    m_layersChanged = true;
+}
+
+QImage AGLMapViewRenderer::grabLastFrame(const QSize &size) {
+    if (framebufferObject() == nullptr)
+        return QImage();
+    QImage frame = framebufferObject()->toImage();
+    QQuickOpenGLUtils::resetOpenGLState();
+    if (frame.isNull())
+        return frame;
+    return frame.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
+
 AGLMapViewRenderer::~AGLMapViewRenderer() {
     m_selectionRect.cleanup();
     m_dragLine.cleanup();
     m_axes.cleanup();
+    m_frameHistory.cleanup();
+    m_basemap.cleanup();
     m_model->cleanup();
 }
 
@@ -77,6 +154,11 @@ void AGLMapViewRenderer::render() {
     if (!m_model->hasGraphViewModel())
         return;
 
+    if (m_layersChanged) {
+        reloadModel();
+        m_layersChanged = false;
+    }
+
     if (m_backgroundColourChanged) {
         // TODO: This should be happening in the ctor, however
         // this particular qt opengl implementation does not
@@ -87,17 +169,31 @@ void AGLMapViewRenderer::render() {
     }
 
     glEnable(GL_MULTISAMPLE);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glDisable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    if (m_basemapFileChanged) {
+        // the setting may hold a file URL as given by a file dialog. Opening only reads the
+        // zoom levels from the file, which is quick
+        QUrl basemapUrl(m_basemapFile);
+        if (m_basemapFile.isEmpty())
+            m_basemap.close();
+        else
+            m_basemap.open(basemapUrl.isLocalFile() ? basemapUrl.toLocalFile() : m_basemapFile);
+        m_basemapFileChanged = false;
+        m_reprojectionAllowed = false;
+    }
+    m_basemap.updateGL();
     m_model->updateGL(m_core);
 
-    m_axes.paintGL(m_mProj, m_mView, m_mModel);
-
-    m_model->paintGL(m_mProj, m_mView, m_mModel);
+    if (!m_reprojectionAllowed || !paintReprojected()) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        paintModel();
+    }
+    // kept without the selection rectangle, which is drawn over it each frame
+    m_frameHistory.store(framebufferObject(), m_eyePosX, m_eyePosY, m_zoomFactor);
 
     float pos[] = {
         float(std::min(m_mouseDragRect.bottomRight().x(), m_mouseDragRect.topLeft().x())),
@@ -105,16 +201,88 @@ void AGLMapViewRenderer::render() {
         float(std::max(m_mouseDragRect.bottomRight().x(), m_mouseDragRect.topLeft().x())),
         float(std::max(m_mouseDragRect.bottomRight().y(), m_mouseDragRect.topLeft().y()))};
     m_selectionRect.setSelectionBounds(QMatrix2x2(pos));
-    m_selectionRect.paintGL(m_mProj, m_mView, m_mModel);
+    m_selectionRect.paintGL(m_mProj, m_mView, m_mWorldModel);
 
     //    if ((m_mouseMode & MOUSE_MODE_SECOND_POINT) == MOUSE_MODE_SECOND_POINT) {
     //        float pos[] = {float(m_tempFirstPoint.x), float(m_tempFirstPoint.y),
     //        float(m_tempSecondPoint.x),
     //                       float(m_tempSecondPoint.y)};
-    //        m_dragLine.paintGL(m_mProj, m_mView, m_mModel, QMatrix2x2(pos));
+    //        m_dragLine.paintGL(m_mProj, m_mView, m_mWorldModel, QMatrix2x2(pos));
     //    }
 
+    if (!m_exportFile.isEmpty())
+        exportImage();
+
     QQuickOpenGLUtils::resetOpenGLState();
+
+    // draw again once the tiles being made or read come in
+    if (m_model->hasPendingWork() || m_basemap.hasPendingTiles())
+        QQuickFramebufferObject::Renderer::update();
+}
+
+void AGLMapViewRenderer::paintModel() {
+    m_basemap.paintGL(m_mProj, m_mView, m_mModel, m_eyePosX, m_eyePosY);
+    m_axes.paintGL(m_mProj, m_mView, m_mWorldModel);
+    m_model->setEyePosition(m_eyePosX, m_eyePosY);
+    m_model->paintGL(m_mProj, m_mView, m_mModel);
+}
+
+void AGLMapViewRenderer::exportImage() {
+    // whatever the view is doing, the next synchronize sets the detail back
+    m_model->setReducedDetail(false, false);
+    double ratio = static_cast<double>(m_exportSize.width()) / m_exportSize.height();
+    QRectF region(-m_zoomFactor * 0.5 * ratio, -m_zoomFactor * 0.5, m_zoomFactor * ratio,
+                  m_zoomFactor);
+    QMatrix4x4 mProj = m_mProj;
+    AGLImageExport imageExport(m_antialiasingSamples);
+    bool exported = imageExport.run(m_exportFile, m_exportSize, region,
+                                    [this](const QMatrix4x4 &mTileProj) {
+                                        m_mProj = mTileProj;
+                                        paintModel();
+                                    });
+    m_mProj = mProj;
+    framebufferObject()->bind();
+    glViewport(0, 0, m_viewportSize.width(), m_viewportSize.height());
+    if (!exported)
+        qWarning() << "Could not export the view to" << m_exportFile;
+    m_exportFile.clear();
+}
+
+bool AGLMapViewRenderer::paintReprojected() {
+    QSize size = framebufferObject()->size();
+    if (!m_frameHistory.isValidFor(size, m_zoomFactor))
+        return false;
+    QPoint offset = m_frameHistory.getOffset(m_eyePosX, m_eyePosY);
+    if (std::abs(offset.x()) >= size.width() || std::abs(offset.y()) >= size.height())
+        return false;
+
+    // move the camera by under half a pixel so that the strips line up with the old frame,
+    // the next full frame puts it back
+    m_eyePosX = m_frameHistory.getSnappedEyePosX(offset);
+    m_eyePosY = m_frameHistory.getSnappedEyePosY(offset);
+    recalcView();
+
+    m_frameHistory.paintGL(offset);
+
+    // the columns and rows uncovered, in framebuffer pixels with y up
+    std::vector<QRect> strips;
+    if (offset.x() > 0)
+        strips.emplace_back(0, 0, offset.x(), size.height());
+    else if (offset.x() < 0)
+        strips.emplace_back(size.width() + offset.x(), 0, -offset.x(), size.height());
+    if (offset.y() > 0)
+        strips.emplace_back(0, 0, size.width(), offset.y());
+    else if (offset.y() < 0)
+        strips.emplace_back(0, size.height() + offset.y(), size.width(), -offset.y());
+
+    glEnable(GL_SCISSOR_TEST);
+    for (const QRect &strip : strips) {
+        glScissor(strip.x(), strip.y(), strip.width(), strip.height());
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        paintModel();
+    }
+    glDisable(GL_SCISSOR_TEST);
+    return true;
 }
 
 void AGLMapViewRenderer::recalcView() {
@@ -129,7 +297,8 @@ void AGLMapViewRenderer::recalcView() {
         m_mProj.ortho(-m_zoomFactor * 0.5f * screenRatio, m_zoomFactor * 0.5f * screenRatio,
                       -m_zoomFactor * 0.5f, m_zoomFactor * 0.5f, 0, 10);
     }
-    m_mProj.translate(m_eyePosX, m_eyePosY, 0.0f);
+    m_mWorldModel = m_mModel;
+    m_mWorldModel.translate(static_cast<float>(m_eyePosX), static_cast<float>(m_eyePosY));
 }
 
 void AGLMapViewRenderer::loadAxes() {
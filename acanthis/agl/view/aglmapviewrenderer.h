@@ -4,10 +4,13 @@
 
 #pragma once
 
+#include "../base/aglbasemap.h"
 #include "../base/agldynamicline.h"
 #include "../base/agldynamicrect.h"
 #include "../base/agllines.h"
 #include "../viewmodel/aglviewmodel.h"
+#include "aglframehistory.h"
+#include "aglqualitygovernor.h"
 
 #include "graphviewmodel.h"
 
@@ -18,15 +21,23 @@
 #include <QtQuick/QQuickFramebufferObject>
 #include <QtQuick/QQuickWindow>
 
+#include <memory>
+
 class AGLMapViewport;
 class AGLMapViewRenderer : public QQuickFramebufferObject::Renderer {
 
     QOpenGLFramebufferObject *createFramebufferObject(const QSize &size) override {
-        m_viewportSize = size;
+        // while the quality is reduced the framebuffer is smaller and without multisampling,
+        // the item still shows it at its full size
+        AGLQualityGovernor::Level level = m_qualityGovernor.getLevel();
+        m_viewportSize = (size * AGLQualityGovernor::resolutionScale(level))
+                             .expandedTo(QSize(1, 1));
         QOpenGLFramebufferObjectFormat format;
         format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
-        format.setSamples(m_antialiasingSamples);
-        return new QOpenGLFramebufferObject(size, format);
+        format.setSamples(level >= AGLQualityGovernor::Level::NO_ANTIALIASING
+                              ? 0
+                              : m_antialiasingSamples);
+        return new QOpenGLFramebufferObject(m_viewportSize, format);
     }
 
     void synchronize(QQuickFramebufferObject *item) override;
@@ -34,18 +45,37 @@ class AGLMapViewRenderer : public QQuickFramebufferObject::Renderer {
   public:
     AGLMapViewRenderer(const QQuickFramebufferObject *item, const GraphViewModel *graphDocViewModel,
                        const QColor &foregrounColour, const QColor &backgroundColour,
-                       int antialiasingSamples, bool highlightOnHover);
+                       int antialiasingSamples, bool highlightOnHover,
+                       bool useVertexBufferCache, bool useRasterTiles);
     ~AGLMapViewRenderer();
 
     void render() override;
     void update();
+    /**
+     * @brief Stops the work in the background on the layers of the document before it is
+     * unloaded, on the render thread between frames (see AGLMapViewport::releaseRenderer).
+     * The model is rebuilt from the layers there are by the next frame drawn
+     */
+    void releaseLayers();
+    /** @brief The last frame drawn, fit in size. Requires the GL context */
+    QImage grabLastFrame(const QSize &size);
+    /** @brief Points to the renderer for as long as it exists, see AGLMapViewport */
+    std::weak_ptr<AGLMapViewRenderer *> getHandle() const { return m_handle; }
 
   private:
     QSize m_viewportSize;
     QOpenGLShaderProgram *m_program = nullptr;
+    const std::shared_ptr<AGLMapViewRenderer *> m_handle =
+        std::make_shared<AGLMapViewRenderer *>(this);
     const AGLMapViewport *m_item;
 
     void recalcView();
+    void reloadModel();
+    /** @brief Draws the map over the strips the shifted previous frame leaves uncovered */
+    bool paintReprojected();
+    void paintModel();
+    /** @brief Draws the view at full quality into the export file, see AGLImageExport */
+    void exportImage();
 
     static QColor colorMerge(QColor color, QColor mergecolor) {
         return QColor::fromRgb((color.rgba() & 0x006f6f6f) | (mergecolor.rgba() & 0x00a0a0a0));
@@ -60,12 +90,16 @@ class AGLMapViewRenderer : public QQuickFramebufferObject::Renderer {
 
     bool m_core;
     bool m_perspectiveView = false;
-    float m_eyePosX;
-    float m_eyePosY;
+    double m_eyePosX;
+    double m_eyePosY;
     float m_zoomFactor = 20;
+    // the camera position is left out of these, the layers add it to their own origin in
+    // double precision (see AGLViewModel::relativeModel)
     QMatrix4x4 m_mProj;
     QMatrix4x4 m_mView;
     QMatrix4x4 m_mModel;
+    // for what is drawn in world coordinates directly (axes, selection rectangle)
+    QMatrix4x4 m_mWorldModel;
 
     QColor m_foregroundColour;
     QColor m_backgroundColour;
@@ -75,12 +109,33 @@ class AGLMapViewRenderer : public QQuickFramebufferObject::Renderer {
     AGLDynamicLine m_dragLine;
     AGLLines m_axes;
 
+    // drawn under everything else, reopened on the render thread when the file changes
+    AGLBasemap m_basemap;
+    QString m_basemapFile;
+    bool m_basemapFileChanged = false;
+
+    // empty unless an export is to be drawn with the next frame
+    QString m_exportFile;
+    QSize m_exportSize;
+
+    const GraphViewModel *m_graphViewModel;
     std::unique_ptr<AGLViewModel> m_model;
+    bool m_useVertexBufferCache = false;
+    bool m_useRasterTiles = false;
+    // the layers of the document are recreated when it is unloaded and reloaded
+    unsigned int m_layersGeneration = 0;
+    bool m_layersChanged = false;
 
     bool m_highlightOnHover = true;
 
     int m_antialiasingSamples = 0; // set this to 0 if rendering is too slow
 
+    AGLQualityGovernor m_qualityGovernor;
+
+    // while the view is only panned the previous frame is reused, see AGLFrameHistory
+    AGLFrameHistory m_frameHistory;
+    bool m_reprojectionAllowed = false;
+
     bool m_datasetChanged = false;
 
     void loadAxes();
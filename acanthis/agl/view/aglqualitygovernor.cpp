@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aglqualitygovernor.h"
+
+AGLQualityGovernor::Level AGLQualityGovernor::nextFrame(bool interacting) {
+    if (!interacting) {
+        m_level = Level::FULL;
+        m_frameTimer.invalidate();
+        m_framesSinceChange = 0;
+        return m_level;
+    }
+    if (!m_frameTimer.isValid()) {
+        // the first frame of an interaction, the time since the last one means nothing
+        m_frameTimer.start();
+        m_averageFrameTime = m_targetFrameTime;
+        return m_level;
+    }
+    float frameTime = static_cast<float>(m_frameTimer.nsecsElapsed()) * 1e-6f;
+    m_frameTimer.restart();
+    m_averageFrameTime = 0.8f * m_averageFrameTime + 0.2f * frameTime;
+    if (++m_framesSinceChange < SETTLE_FRAMES)
+        return m_level;
+
+    if (m_averageFrameTime > m_targetFrameTime * SLOW_FRAME_RATIO &&
+        m_level != Level::NO_OVERLAYS) {
+        m_level = static_cast<Level>(static_cast<int>(m_level) + 1);
+        m_framesSinceChange = 0;
+        m_averageFrameTime = m_targetFrameTime;
+    } else if (m_averageFrameTime < m_targetFrameTime * FAST_FRAME_RATIO &&
+               m_level != Level::FULL) {
+        m_level = static_cast<Level>(static_cast<int>(m_level) - 1);
+        m_framesSinceChange = 0;
+        m_averageFrameTime = m_targetFrameTime;
+    }
+    return m_level;
+}
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QElapsedTimer>
+
+/**
+ * @brief Picks how much of the quality of the view to give up while the user pans and zooms,
+ * from the measured time between frames. Each level adds to the ones before it, and levels
+ * are taken one at a time, a few frames apart, while frames take longer than the target.
+ * Full quality comes back as soon as the view is idle.
+ */
+class AGLQualityGovernor {
+  public:
+    enum class Level {
+        FULL,
+        REDUCED_RESOLUTION, // render to a smaller framebuffer, scaled up on display
+        NO_ANTIALIASING,    // no multisampling
+        COARSE_DETAIL,      // leave out grids and hover highlights
+        NO_OVERLAYS         // leave out the graph and link overlays
+    };
+
+    static constexpr float DEFAULT_TARGET_FRAME_TIME = 1000.0f / 60.0f;
+
+    void setTargetFrameTime(float targetFrameTime) { m_targetFrameTime = targetFrameTime; }
+    /** @brief Call once per frame, returns the level to draw the frame at */
+    Level nextFrame(bool interacting);
+    Level getLevel() const { return m_level; }
+    /** @brief Frame time in milliseconds averaged over the last few frames of interaction */
+    float getAverageFrameTime() const { return m_averageFrameTime; }
+
+    static float resolutionScale(Level level) {
+        return level >= Level::REDUCED_RESOLUTION ? 0.5f : 1.0f;
+    }
+
+  private:
+    // frames to wait after a change of level before measuring whether another is needed
+    static const int SETTLE_FRAMES = 8;
+    // frames slower than the target by this much lower the quality
+    static constexpr float SLOW_FRAME_RATIO = 1.25f;
+    // and frames faster than the target by this much raise it again
+    static constexpr float FAST_FRAME_RATIO = 0.5f;
+
+    float m_targetFrameTime = DEFAULT_TARGET_FRAME_TIME;
+    float m_averageFrameTime = 0.0f;
+    int m_framesSinceChange = 0;
+    Level m_level = Level::FULL;
+    QElapsedTimer m_frameTimer;
+};
@@ -4,6 +4,8 @@
 
 #include "aglmapviewmodel.h"
 
+#include "../base/aglshapevalues.h"
+
 const QList<QSharedPointer<MapLayer>> &AGLMapViewModel::getMaps() const {
     return m_graphViewModel->getMapLayers();
 }
@@ -26,8 +28,60 @@ void AGLMapViewModel::cleanup() {
 }
 
 void AGLMapViewModel::loadGLObjects() {
+    if (m_rasterTiles)
+        enableRasterTiles();
+    if (m_vertexBufferCache == nullptr) {
+        for (auto &map : getMaps()) {
+            getGLMap(map.get()).loadGLObjects();
+        }
+        return;
+    }
+    // names are not unique (i.e. layers of different drawing files) so include the index.
+    // The buffers hold the colours and filter values of the items, so they are kept apart
+    // for each colouring of the layer
+    int layerIndex = 0;
+    for (auto &map : getMaps()) {
+        AGLMap &glMap = getGLMap(map.get());
+        QString prefix = QString::number(layerIndex++) + "/" + map->getName() + "/" +
+                         QString::number(map->getColouringHash(), 16) + "/";
+        if (!glMap.loadGLObjectsFromCache(*m_vertexBufferCache, prefix)) {
+            glMap.loadGLObjects();
+            glMap.storeGLObjectsToCache(*m_vertexBufferCache, prefix);
+        }
+    }
+    if (m_vertexBufferCache->hasPendingWrites())
+        m_vertexBufferCache->flush();
+}
+
+void AGLMapViewModel::enableRasterTiles() {
+    // the tiles go next to the vertex buffers of the graph file, when it can be cached
+    AGLVertexBufferCache *cache = m_graphViewModel->getVertexBufferCache();
+    QString tileDirectory;
+    if (cache != nullptr) {
+        QString filename = cache->getFilename();
+        tileDirectory = filename.left(filename.lastIndexOf('.')) + ".tiles";
+    }
+    int layerIndex = 0;
     for (auto &map : getMaps()) {
-        getGLMap(map.get()).loadGLObjects();
+        getGLMap(map.get()).enableRasterTiles(
+            tileDirectory.isEmpty() ? QString()
+                                    : tileDirectory + "/" + QString::number(layerIndex));
+        ++layerIndex;
+    }
+}
+
+bool AGLMapViewModel::hasPendingWork() const {
+    for (auto &glMap : m_glMaps) {
+        if (glMap.first->isVisible() && glMap.second->hasPendingWork())
+            return true;
+    }
+    return false;
+}
+
+void AGLMapViewModel::releaseLayers() {
+    // the layers may already be gone from the GraphViewModel, the maps still know them
+    for (auto &glMap : m_glMaps) {
+        glMap.second->stopBackgroundWork();
     }
 }
 
@@ -49,12 +103,23 @@ void AGLMapViewModel::highlightHoveredItems(const QtRegion &region) {
     }
 }
 
+void AGLMapViewModel::synchronize() {
+    for (auto &map : getMaps()) {
+        unsigned int &generation = m_selectionGenerations[map.get()];
+        if (generation == map->getSelectionGeneration())
+            continue;
+        generation = map->getSelectionGeneration();
+        getGLMap(map.get()).setSelectedKeys(map->getSelectedKeys());
+    }
+}
+
 void AGLMapViewModel::updateGL(bool m_core) {
     for (auto &map : getMaps()) {
         if (!map->isVisible())
             continue;
         getGLMap(map.get()).updateGL(m_core);
         getGLMap(map.get()).updateHoverGL(m_core);
+        getGLMap(map.get()).updateSelectionGL();
     }
 }
 
@@ -63,6 +128,12 @@ void AGLMapViewModel::paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mVi
     for (auto &map : getMaps()) {
         if (!map->isVisible())
             continue;
-        getGLMap(map.get()).paintGL(m_mProj, m_mView, m_mModel);
+        AGLMap &glMap = getGLMap(map.get());
+        glMap.setFilterRange(map->isFiltered()
+                                 ? QVector2D(map->getFilterMinimum(), map->getFilterMaximum())
+                                 : AGLShapeValues::unfilteredRange());
+        glMap.setCoarseDetail(m_coarseDetail);
+        glMap.setOverlaysHidden(m_overlaysHidden);
+        glMap.paintGL(m_mProj, m_mView, relativeModel(m_mModel, glMap.getOrigin()));
     }
 }
@@ -13,14 +13,32 @@
 class AGLMapViewModel : public AGLViewModel {
     AGLMap &getGLMap(MapLayer *mapLayer);
     std::map<MapLayer *, std::unique_ptr<AGLMap>> m_glMaps;
+    // the selection generation of each layer last passed to its AGLMap
+    std::map<MapLayer *, unsigned int> m_selectionGenerations;
+    AGLVertexBufferCache *m_vertexBufferCache = nullptr;
+    bool m_rasterTiles = false;
+    bool m_coarseDetail = false;
+    bool m_overlaysHidden = false;
+
+    void enableRasterTiles();
 
   public:
-    using AGLViewModel::AGLViewModel;
+    AGLMapViewModel(const GraphViewModel *graphViewModel,
+                    AGLVertexBufferCache *vertexBufferCache = nullptr, bool rasterTiles = false)
+        : AGLViewModel(graphViewModel), m_vertexBufferCache(vertexBufferCache),
+          m_rasterTiles(rasterTiles) {}
     const QList<QSharedPointer<MapLayer>> &getMaps() const;
     void cleanup() override;
     void loadGLObjects() override;
     void initializeGL(bool m_core) override;
     void loadGLObjectsRequiringGLContext() override;
+    void synchronize() override;
+    bool hasPendingWork() const override;
+    void releaseLayers() override;
+    void setReducedDetail(bool coarseDetail, bool hideOverlays) override {
+        m_coarseDetail = coarseDetail;
+        m_overlaysHidden = hideOverlays;
+    }
     void updateGL(bool m_core) override;
     void paintGL(const QMatrix4x4 &m_mProj, const QMatrix4x4 &m_mView,
                  const QMatrix4x4 &m_mModel) override;
@@ -11,8 +11,44 @@
 class AGLViewModel : public AGLObjects {
   protected:
     const GraphViewModel *m_graphViewModel = nullptr;
+    double m_eyePosX = 0;
+    double m_eyePosY = 0;
+
+    /**
+     * @brief The model matrix for vertices stored relative to origin. The camera translation
+     * is added to it here, in double precision, so that only the small difference between
+     * the two reaches the float matrices.
+     */
+    QMatrix4x4 relativeModel(const QMatrix4x4 &mModel, const Point2f &origin) const {
+        QMatrix4x4 model = mModel;
+        model.translate(static_cast<float>(m_eyePosX + origin.x),
+                        static_cast<float>(m_eyePosY + origin.y));
+        return model;
+    }
 
   public:
     AGLViewModel(const GraphViewModel *graphViewModel) : m_graphViewModel(graphViewModel) {}
     bool hasGraphViewModel() const { return m_graphViewModel != nullptr; }
+    /**
+     * @brief Copies over the state the GUI thread changes (i.e. the selection), called from
+     * the renderer's synchronize() while the GUI thread is blocked
+     */
+    virtual void synchronize() {}
+    /**
+     * @brief The camera position, which the matrices given to paintGL leave out so that it
+     * can be combined with the origin of each part in double precision
+     */
+    void setEyePosition(double eyePosX, double eyePosY) {
+        m_eyePosX = eyePosX;
+        m_eyePosY = eyePosY;
+    }
+    /** @brief Leaves out finer detail and the overlays, while the view is moving */
+    virtual void setReducedDetail(bool, bool) {}
+    /** @brief Whether work in the background needs more frames drawn to show up */
+    virtual bool hasPendingWork() const { return false; }
+    /**
+     * @brief Stops the work in the background on the layers, for before they go away. The
+     * model is only cleaned up after this, and replaced by one of the new layers
+     */
+    virtual void releaseLayers() {}
 };
@@ -0,0 +1,136 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aqattributetablemodel.h"
+
+#include <algorithm>
+#include <numeric>
+
+void AQAttributeTableModel::setGraphViewModel(GraphViewModel *graphViewModel) {
+    if (graphViewModel == m_graphViewModel)
+        return;
+    if (m_graphViewModel != nullptr)
+        disconnect(m_graphViewModel, nullptr, this, nullptr);
+    m_graphViewModel = graphViewModel;
+    if (m_graphViewModel != nullptr) {
+        // the table belongs to the layer, let go of it before the layer goes away
+        connect(m_graphViewModel, &GraphViewModel::mapLayersAboutToBeRemoved, this,
+                &AQAttributeTableModel::clearLayer);
+        connect(m_graphViewModel, &GraphViewModel::mapLayersInserted, this,
+                &AQAttributeTableModel::loadLayer);
+    }
+    loadLayer();
+    emit graphViewModelChanged();
+}
+
+void AQAttributeTableModel::setLayerIndex(int layerIndex) {
+    if (layerIndex == m_layerIndex)
+        return;
+    m_layerIndex = layerIndex;
+    loadLayer();
+    emit layerIndexChanged();
+}
+
+void AQAttributeTableModel::clearLayer() {
+    beginResetModel();
+    m_attributes = nullptr;
+    m_keys.clear();
+    m_rows.clear();
+    m_sortedRows.clear();
+    m_sortColumn = -1;
+    endResetModel();
+}
+
+void AQAttributeTableModel::loadLayer() {
+    beginResetModel();
+    m_attributes = nullptr;
+    m_keys.clear();
+    m_rows.clear();
+    m_sortedRows.clear();
+    m_sortColumn = -1;
+    if (m_graphViewModel != nullptr && m_layerIndex >= 0 &&
+        m_layerIndex < m_graphViewModel->getMapLayers().size()) {
+        m_attributes = &m_graphViewModel->getMapLayers()[m_layerIndex]->getAttributes();
+        m_keys.reserve(m_attributes->getNumRows());
+        m_rows.reserve(m_attributes->getNumRows());
+        for (auto iter = m_attributes->begin(); iter != m_attributes->end(); ++iter) {
+            m_keys.push_back(iter->getKey().value);
+            m_rows.push_back(&iter->getRow());
+        }
+    }
+    endResetModel();
+}
+
+size_t AQAttributeTableModel::getTableRow(int row) const {
+    if (m_sortColumn < 0)
+        return static_cast<size_t>(row);
+    if (m_sortOrder == Qt::AscendingOrder)
+        return m_sortedRows[static_cast<size_t>(row)];
+    return m_sortedRows[m_sortedRows.size() - 1 - static_cast<size_t>(row)];
+}
+
+int AQAttributeTableModel::rowCount(const QModelIndex &parent) const {
+    if (parent.isValid())
+        return 0;
+    return static_cast<int>(m_rows.size());
+}
+
+int AQAttributeTableModel::columnCount(const QModelIndex &parent) const {
+    if (parent.isValid() || m_attributes == nullptr)
+        return 0;
+    // the key is shown as the first column
+    return static_cast<int>(m_attributes->getNumColumns()) + 1;
+}
+
+QVariant AQAttributeTableModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || role != Qt::DisplayRole || m_attributes == nullptr)
+        return QVariant();
+    size_t tableRow = getTableRow(index.row());
+    if (index.column() == 0)
+        return m_keys[tableRow];
+    return m_rows[tableRow]->getValue(static_cast<size_t>(index.column() - 1));
+}
+
+QVariant AQAttributeTableModel::headerData(int section, Qt::Orientation orientation,
+                                           int role) const {
+    if (role != Qt::DisplayRole || m_attributes == nullptr)
+        return QVariant();
+    if (orientation == Qt::Vertical)
+        return section + 1;
+    if (section == 0)
+        return QString("Ref");
+    return QString::fromStdString(
+        m_attributes->getColumn(static_cast<size_t>(section - 1)).getName());
+}
+
+void AQAttributeTableModel::sort(int column, Qt::SortOrder order) {
+    if (m_attributes == nullptr || column < 0 || column >= columnCount())
+        return;
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(),
+                                QAbstractItemModel::VerticalSortHint);
+    if (column != m_sortColumn) {
+        m_sortedRows.resize(m_rows.size());
+        std::iota(m_sortedRows.begin(), m_sortedRows.end(), 0u);
+        if (column == 0) {
+            std::stable_sort(m_sortedRows.begin(), m_sortedRows.end(),
+                             [this](unsigned int a, unsigned int b) {
+                                 return m_keys[a] < m_keys[b];
+                             });
+        } else {
+            // read the column out once rather than going through the rows on every comparison
+            size_t attributeColumn = static_cast<size_t>(column - 1);
+            std::vector<float> values(m_rows.size());
+            for (size_t i = 0; i < m_rows.size(); ++i) {
+                values[i] = m_rows[i]->getValue(attributeColumn);
+            }
+            std::stable_sort(m_sortedRows.begin(), m_sortedRows.end(),
+                             [&values](unsigned int a, unsigned int b) {
+                                 return values[a] < values[b];
+                             });
+        }
+        m_sortColumn = column;
+    }
+    m_sortOrder = order;
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "graphviewmodel.h"
+
+#include "salalib/attributetable.h"
+
+#include <QAbstractTableModel>
+
+#include <vector>
+
+// Table of the attributes of one layer of a GraphViewModel. Values are read from the
+// AttributeTable only for the cells the view asks for. The rows are looked up through
+// a flat list of row pointers, built once per layer, and sorting only reorders a
+// permutation of that list, so the table itself is never copied or modified.
+
+class AQAttributeTableModel : public QAbstractTableModel {
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(GraphViewModel *graphViewModel MEMBER m_graphViewModel WRITE setGraphViewModel
+                   NOTIFY graphViewModelChanged)
+    Q_PROPERTY(int layerIndex MEMBER m_layerIndex WRITE setLayerIndex NOTIFY layerIndexChanged)
+
+    GraphViewModel *m_graphViewModel = nullptr;
+    int m_layerIndex = -1;
+
+    AttributeTable *m_attributes = nullptr;
+    std::vector<int> m_keys;
+    std::vector<const AttributeRow *> m_rows;
+
+    // row order for the current sort column, ascending. The descending order reads it
+    // backwards so that it does not need to be sorted again
+    std::vector<unsigned int> m_sortedRows;
+    int m_sortColumn = -1;
+    Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+
+    void loadLayer();
+    size_t getTableRow(int row) const;
+
+  public:
+    explicit AQAttributeTableModel(QObject *parent = nullptr) : QAbstractTableModel(parent) {}
+
+    void setGraphViewModel(GraphViewModel *graphViewModel);
+    void setLayerIndex(int layerIndex);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+
+    Q_INVOKABLE void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+  private slots:
+    void clearLayer();
+
+  signals:
+    void graphViewModelChanged();
+    void layerIndexChanged();
+};
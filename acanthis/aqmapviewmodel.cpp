@@ -71,6 +71,53 @@ QVariant AQMapViewModel::data(const QModelIndex &index, int role) const {
         return item->isEditable();
     case NameRole:
         return item->getName();
+    case MinimumRole:
+    case MaximumRole:
+    case MeanRole:
+    case QuantilesRole:
+        return getStatisticsData(item, role);
+    case FilterMinimumRole:
+    case FilterMaximumRole: {
+        MapLayer *mapLayer = dynamic_cast<MapLayer *>(item);
+        if (mapLayer == nullptr)
+            return QVariant();
+        return role == FilterMinimumRole ? mapLayer->getFilterMinimum()
+                                         : mapLayer->getFilterMaximum();
+    }
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+QVariant AQMapViewModel::getStatisticsData(TreeItem *item, int role) const {
+    const AttributeStatistics::ColumnStatistics *statistics = nullptr;
+    if (AttributeItem *attributeItem = dynamic_cast<AttributeItem *>(item)) {
+        statistics = attributeItem->getStatistics();
+    } else if (MapLayer *mapLayer = dynamic_cast<MapLayer *>(item)) {
+        // those of the displayed column, which the filter of the layer is over
+        int column = mapLayer->getDisplayedColumn();
+        if (column >= 0) {
+            statistics = mapLayer->getAttributeStatistics().getColumnStatistics(
+                static_cast<size_t>(column));
+        }
+    }
+    if (statistics == nullptr || statistics->count == 0)
+        return QVariant();
+    switch (role) {
+    case MinimumRole:
+        return statistics->minimum;
+    case MaximumRole:
+        return statistics->maximum;
+    case MeanRole:
+        return statistics->mean;
+    case QuantilesRole: {
+        QVariantList quantiles;
+        for (double quantile : statistics->quantiles) {
+            quantiles.append(quantile);
+        }
+        return quantiles;
+    }
     default:
         break;
     }
@@ -80,7 +127,15 @@ QVariant AQMapViewModel::data(const QModelIndex &index, int role) const {
 QHash<int, QByteArray> AQMapViewModel::roleNames() const {
     QHash<int, QByteArray> names = QAbstractItemModel::roleNames();
     names.insert(QHash<int, QByteArray>{
-        {VisibleRole, "visibility"}, {EditableRole, "editability"}, {NameRole, "name"}});
+        {VisibleRole, "visibility"},
+        {EditableRole, "editability"},
+        {NameRole, "name"},
+        {MinimumRole, "minimum"},
+        {MaximumRole, "maximum"},
+        {MeanRole, "mean"},
+        {QuantilesRole, "quantiles"},
+        {FilterMinimumRole, "filterMinimum"},
+        {FilterMaximumRole, "filterMaximum"}});
     return names;
 }
 
@@ -99,26 +154,96 @@ QSharedPointer<TreeItem> AQMapViewModel::addChildItem(QSharedPointer<TreeItem> p
 void AQMapViewModel::resetItems() {
     if (!m_graphViewModel)
         return;
+    // layers are added and removed when the document is unloaded or reloaded
+    connect(m_graphViewModel, &GraphViewModel::mapLayersInserted, this,
+            &AQMapViewModel::insertMapLayers, Qt::UniqueConnection);
+    connect(m_graphViewModel, &GraphViewModel::mapLayersAboutToBeRemoved, this,
+            &AQMapViewModel::removeMapLayers, Qt::UniqueConnection);
     beginResetModel();
+    // only the layers are added here, anything underneath them is created on expansion
+    m_rootItem = QSharedPointer<TreeItem>(new TreeItem("Root"));
     int rowL1 = 0;
     for (QSharedPointer<MapLayer> mapLayer : m_graphViewModel->getMapLayers()) {
-        QSharedPointer<TreeItem> mapItem = addChildItem(m_rootItem, mapLayer, rowL1);
-        mapItem->setVisible(true);
-        int rowL2 = 0;
-        if (mapLayer->hasGraph()) {
-            auto graphItem = addChildItem(mapItem, "Graph", rowL2);
-            rowL2++;
-        }
-        auto allAttrItem = addChildItem(mapItem, "Attributes", rowL2);
-        for (size_t col = 0; col < mapLayer->getAttributes().getNumColumns(); ++col) {
-            auto attrItem = addChildItem(allAttrItem,
-                                         QSharedPointer<AttributeItem>(new AttributeItem(
-                                             mapLayer->getAttributes().getColumn(col))),
-                                         static_cast<int>(col));
-        }
+        addChildItem(m_rootItem, mapLayer, rowL1);
         rowL1++;
     }
     endResetModel();
+    connectLayerStatistics(0, rowL1 - 1);
+}
+
+void AQMapViewModel::connectLayerStatistics(int first, int last) {
+    const QList<QSharedPointer<MapLayer>> &mapLayers = m_graphViewModel->getMapLayers();
+    for (int row = first; row <= last; ++row) {
+        MapLayer *mapLayer = mapLayers[row].get();
+        QPersistentModelIndex layerIndex(index(row, 0));
+        // the layers are connected again on every reset, and the lambda can not be made
+        // unique, so let go of the connection to the previous index
+        disconnect(&mapLayer->getAttributeStatistics(),
+                   &AttributeStatistics::columnStatisticsReady, this, nullptr);
+        connect(&mapLayer->getAttributeStatistics(), &AttributeStatistics::columnStatisticsReady,
+                this, [this, mapLayer, layerIndex](size_t column) {
+                    if (!layerIndex.isValid() ||
+                        static_cast<int>(column) != mapLayer->getDisplayedColumn())
+                        return;
+                    emit dataChanged(layerIndex,
+                                     layerIndex.siblingAtColumn(numRolesAsColumns - 1),
+                                     QVector<int>() << MinimumRole << MaximumRole << MeanRole
+                                                    << QuantilesRole);
+                });
+    }
+}
+
+void AQMapViewModel::insertMapLayers(int first, int last) {
+    const QList<QSharedPointer<MapLayer>> &mapLayers = m_graphViewModel->getMapLayers();
+    beginInsertRows(QModelIndex(), first, last);
+    for (int row = first; row <= last; ++row) {
+        m_rootItem->insertChildItem(mapLayers[row], row)->setParentItem(m_rootItem);
+    }
+    endInsertRows();
+    connectLayerStatistics(first, last);
+}
+
+void AQMapViewModel::removeMapLayers(int first, int last) {
+    beginRemoveRows(QModelIndex(), first, last);
+    m_rootItem->removeChildItems(first, last - first + 1);
+    endRemoveRows();
+}
+
+bool AQMapViewModel::hasChildren(const QModelIndex &parent) const {
+    TreeItem *parentItem = getItem(parent);
+    return parentItem->nChildren() > 0 || parentItem->nChildrenAvailable() > 0;
+}
+
+bool AQMapViewModel::canFetchMore(const QModelIndex &parent) const {
+    return getItem(parent)->canFetchMore();
+}
+
+void AQMapViewModel::fetchMore(const QModelIndex &parent) {
+    TreeItem *parentItem = getItem(parent);
+    int first = static_cast<int>(parentItem->nChildren());
+    int last = static_cast<int>(parentItem->nChildrenAvailable()) - 1;
+    if (last < first)
+        return;
+    QSharedPointer<TreeItem> parentPtr = parentItem->sharedFromThis();
+    beginInsertRows(parent, first, last);
+    for (int row = first; row <= last; ++row) {
+        addChildItem(parentPtr, parentItem->createChild(static_cast<size_t>(row)), row);
+    }
+    endInsertRows();
+    for (int row = first; row <= last; ++row) {
+        AttributeItem *attributeItem =
+            dynamic_cast<AttributeItem *>(parentItem->getChild(static_cast<size_t>(row)).get());
+        if (attributeItem == nullptr)
+            continue;
+        QPersistentModelIndex attributeIndex(index(row, 0, parent));
+        connect(attributeItem, &AttributeItem::statisticsChanged, this, [this, attributeIndex]() {
+            if (!attributeIndex.isValid())
+                return;
+            emit dataChanged(attributeIndex, attributeIndex.siblingAtColumn(numRolesAsColumns - 1),
+                             QVector<int>() << MinimumRole << MaximumRole << MeanRole
+                                            << QuantilesRole);
+        });
+    }
 }
 
 void AQMapViewModel::setItemVisible(const QModelIndex &idx, bool visibility) {
@@ -131,6 +256,14 @@ void AQMapViewModel::setItemEditable(const QModelIndex &idx, bool visibility) {
     emit dataChanged(idx, idx, QVector<int>() << EditableRole);
 }
 
+void AQMapViewModel::setItemFilterRange(const QModelIndex &idx, float minimum, float maximum) {
+    MapLayer *mapLayer = dynamic_cast<MapLayer *>(getItem(idx));
+    if (mapLayer == nullptr)
+        return;
+    mapLayer->setFilterRange(minimum, maximum);
+    emit dataChanged(idx, idx, QVector<int>() << FilterMinimumRole << FilterMaximumRole);
+}
+
 TreeItem *AQMapViewModel::getItem(const QModelIndex &idx) const {
     if (idx.isValid()) {
         TreeItem *item = static_cast<TreeItem *>(idx.internalPointer());
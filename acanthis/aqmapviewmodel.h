@@ -16,6 +16,9 @@ class AQMapViewModel : public QAbstractItemModel {
     GraphViewModel *m_graphViewModel;
     QSharedPointer<TreeItem> m_rootItem;
     TreeItem *getItem(const QModelIndex &idx) const;
+    QVariant getStatisticsData(TreeItem *item, int role) const;
+    // updates the value range of the layers once the statistics are computed
+    void connectLayerStatistics(int first, int last);
 
     // Add roles that are not visible at the bottom only.
     // If new column roles are added, then the number
@@ -24,7 +27,15 @@ class AQMapViewModel : public QAbstractItemModel {
         // Roles visible as columns
         NameRole = Qt::UserRole,
         VisibleRole,
-        EditableRole
+        EditableRole,
+        // Attribute statistics, empty until computed
+        MinimumRole,
+        MaximumRole,
+        MeanRole,
+        QuantilesRole,
+        // Layer filter range on the normalised display value
+        FilterMinimumRole,
+        FilterMaximumRole
     };
 
     short numRolesAsColumns = 3;
@@ -47,10 +58,18 @@ class AQMapViewModel : public QAbstractItemModel {
     AQMapViewModel::LayerModelRole getRole(int columnIndex) const;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QHash<int, QByteArray> roleNames() const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
 
     Q_INVOKABLE void resetItems();
     Q_INVOKABLE void setItemVisible(const QModelIndex &idx, bool visibility);
     Q_INVOKABLE void setItemEditable(const QModelIndex &idx, bool editability);
+    Q_INVOKABLE void setItemFilterRange(const QModelIndex &idx, float minimum, float maximum);
+
+  private slots:
+    void insertMapLayers(int first, int last);
+    void removeMapLayers(int first, int last);
 
   signals:
     void graphViewModelChanged();
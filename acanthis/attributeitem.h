@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "attributestatistics.h"
 #include "treeitem.h"
 
 #include "salalib/attributetable.h"
@@ -16,13 +17,45 @@ class AttributeItem : public QObject, public TreeItem {
     Q_PROPERTY(QString name MEMBER m_name NOTIFY nameChanged)
     Q_PROPERTY(bool visible MEMBER m_visible NOTIFY visibilityChanged)
 
+    AttributeStatistics &m_statistics;
+    size_t m_column;
+
   public:
-    AttributeItem(AttributeColumn &attributeColumn)
-        : TreeItem(QString::fromStdString(attributeColumn.getName())) {
+    AttributeItem(AttributeColumn &attributeColumn, AttributeStatistics &statistics,
+                  size_t column)
+        : TreeItem(QString::fromStdString(attributeColumn.getName())), m_statistics(statistics),
+          m_column(column) {
         m_visible = false;
+        connect(&m_statistics, &AttributeStatistics::columnStatisticsReady, this,
+                [this](size_t readyColumn) {
+                    if (readyColumn == m_column)
+                        emit statisticsChanged();
+                });
     };
 
+    /** @brief nullptr until the statistics have been computed, see statisticsChanged */
+    const AttributeStatistics::ColumnStatistics *getStatistics() {
+        return m_statistics.getColumnStatistics(m_column);
+    }
+
   signals:
     void nameChanged();
     void visibilityChanged();
+    void statisticsChanged();
+};
+
+// The columns of an attribute table, only created when the item is expanded
+class AttributeListItem : public TreeItem {
+    AttributeTable &m_attributes;
+    AttributeStatistics &m_statistics;
+
+  public:
+    AttributeListItem(AttributeTable &attributes, AttributeStatistics &statistics)
+        : TreeItem("Attributes"), m_attributes(attributes), m_statistics(statistics) {}
+
+    size_t nChildrenAvailable() override { return m_attributes.getNumColumns(); }
+    QSharedPointer<TreeItem> createChild(size_t idx) override {
+        return QSharedPointer<AttributeItem>(
+            new AttributeItem(m_attributes.getColumn(idx), m_statistics, idx));
+    }
 };
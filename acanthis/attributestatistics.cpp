@@ -0,0 +1,161 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "attributestatistics.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // values per task of the reduction, large enough to amortise the scheduling
+    const size_t REDUCTION_CHUNK_SIZE = 1 << 16;
+
+    struct Chunk {
+        const float *begin;
+        const float *end;
+    };
+
+    struct PartialStatistics {
+        size_t count = 0;
+        double sum = 0;
+        float minimum = std::numeric_limits<float>::max();
+        float maximum = std::numeric_limits<float>::lowest();
+    };
+
+    // Written without branches on the values so that the compiler can vectorise it,
+    // the "no value" entries are masked out instead of skipped
+    PartialStatistics reduceChunk(const Chunk &chunk) {
+        PartialStatistics partial;
+        float minimum = std::numeric_limits<float>::max();
+        float maximum = std::numeric_limits<float>::lowest();
+        double sum = 0;
+        size_t count = 0;
+        for (const float *value = chunk.begin; value != chunk.end; ++value) {
+            bool valid = *value != -1.0f;
+            minimum = std::min(minimum, valid ? *value : std::numeric_limits<float>::max());
+            maximum = std::max(maximum, valid ? *value : std::numeric_limits<float>::lowest());
+            sum += valid ? static_cast<double>(*value) : 0.0;
+            count += valid ? 1 : 0;
+        }
+        partial.minimum = minimum;
+        partial.maximum = maximum;
+        partial.sum = sum;
+        partial.count = count;
+        return partial;
+    }
+
+    void mergePartial(PartialStatistics &result, const PartialStatistics &partial) {
+        result.count += partial.count;
+        result.sum += partial.sum;
+        result.minimum = std::min(result.minimum, partial.minimum);
+        result.maximum = std::max(result.maximum, partial.maximum);
+    }
+} // namespace
+
+AttributeStatistics::~AttributeStatistics() { cancelPending(); }
+
+AttributeStatistics::ColumnFingerprint AttributeStatistics::getFingerprint(size_t column) const {
+    const AttributeColumn &attributeColumn = m_attributes.getColumn(column);
+    const AttributeColumnStats &stats = attributeColumn.getStats();
+    return ColumnFingerprint{attributeColumn.getName(), m_attributes.getNumRows(), stats.total,
+                             stats.min, stats.max};
+}
+
+const AttributeStatistics::ColumnStatistics *
+AttributeStatistics::getColumnStatistics(size_t column) {
+    if (column >= m_attributes.getNumColumns())
+        return nullptr;
+    ColumnFingerprint fingerprint = getFingerprint(column);
+    auto cached = m_cache.find(column);
+    if (cached != m_cache.end()) {
+        if (cached->second.first == fingerprint)
+            return &cached->second.second;
+        m_cache.erase(cached);
+    }
+    if (m_pending.count(column) != 0)
+        return nullptr;
+
+    m_pending.insert(column);
+    m_running.erase(std::remove_if(m_running.begin(), m_running.end(),
+                                   [](const QFuture<void> &future) { return future.isFinished(); }),
+                    m_running.end());
+    m_cancelled = false;
+    m_running.append(QtConcurrent::run([this, column, fingerprint]() {
+        ColumnStatistics statistics = computeStatistics(m_attributes, column, m_cancelled);
+        if (m_cancelled)
+            return;
+        // hand the result over to the thread the cache lives in
+        QMetaObject::invokeMethod(
+            this,
+            [this, column, fingerprint, statistics]() {
+                m_pending.erase(column);
+                m_cache[column] = std::make_pair(fingerprint, statistics);
+                emit columnStatisticsReady(column);
+            },
+            Qt::QueuedConnection);
+    }));
+    return nullptr;
+}
+
+void AttributeStatistics::invalidate(size_t column) { m_cache.erase(column); }
+
+void AttributeStatistics::invalidateAll() { m_cache.clear(); }
+
+void AttributeStatistics::cancelPending() {
+    m_cancelled = true;
+    for (QFuture<void> &future : m_running) {
+        future.waitForFinished();
+    }
+    m_running.clear();
+    m_pending.clear();
+}
+
+AttributeStatistics::ColumnStatistics
+AttributeStatistics::computeStatistics(AttributeTable &attributes, size_t column,
+                                       const std::atomic<bool> &cancelled) {
+    ColumnStatistics statistics;
+
+    // the rows are stored separately, bring the column together first
+    std::vector<float> values;
+    values.reserve(attributes.getNumRows());
+    for (auto iter = attributes.begin(); iter != attributes.end(); ++iter) {
+        values.push_back(iter->getRow().getValue(column));
+    }
+    if (cancelled || values.empty())
+        return statistics;
+
+    std::vector<Chunk> chunks;
+    for (size_t start = 0; start < values.size(); start += REDUCTION_CHUNK_SIZE) {
+        size_t end = std::min(values.size(), start + REDUCTION_CHUNK_SIZE);
+        chunks.push_back(Chunk{values.data() + start, values.data() + end});
+    }
+    PartialStatistics total = QtConcurrent::blockingMappedReduced<PartialStatistics>(
+        chunks, reduceChunk, mergePartial, QtConcurrent::UnorderedReduce);
+    if (cancelled || total.count == 0)
+        return statistics;
+
+    statistics.count = total.count;
+    statistics.minimum = total.minimum;
+    statistics.maximum = total.maximum;
+    statistics.mean = total.sum / static_cast<double>(total.count);
+
+    // quantiles through successive partial sorts, each one only looks at the values above
+    // the previous quantile
+    values.erase(std::remove(values.begin(), values.end(), -1.0f), values.end());
+    statistics.quantiles.reserve(static_cast<size_t>(QUANTILE_STEPS - 1));
+    auto from = values.begin();
+    for (int step = 1; step < QUANTILE_STEPS; ++step) {
+        if (cancelled)
+            return ColumnStatistics();
+        size_t rank =
+            (values.size() - 1) * static_cast<size_t>(step) / static_cast<size_t>(QUANTILE_STEPS);
+        auto nth = values.begin() + static_cast<std::ptrdiff_t>(rank);
+        std::nth_element(from, nth, values.end());
+        statistics.quantiles.push_back(*nth);
+        from = nth;
+    }
+    return statistics;
+}
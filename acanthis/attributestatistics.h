@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "salalib/attributetable.h"
+
+#include <QFuture>
+#include <QList>
+#include <QObject>
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Summary statistics of the columns of an attribute table, for colour scaling, legends
+// and filters. Statistics are computed on the thread pool the first time they are asked
+// for and then kept until the column changes. Values of -1 are "no value" in salalib
+// and are left out.
+
+class AttributeStatistics : public QObject {
+    Q_OBJECT
+
+  public:
+    // quantiles are kept at every 1/QUANTILE_STEPS, i.e. every 5%, not including
+    // the minimum and maximum
+    static const int QUANTILE_STEPS = 20;
+
+    struct ColumnStatistics {
+        size_t count = 0;
+        double minimum = 0;
+        double maximum = 0;
+        double mean = 0;
+        std::vector<double> quantiles;
+    };
+
+    explicit AttributeStatistics(AttributeTable &attributes) : m_attributes(attributes) {}
+    ~AttributeStatistics();
+    AttributeStatistics(const AttributeStatistics &) = delete;
+    AttributeStatistics &operator=(const AttributeStatistics &) = delete;
+
+    /**
+     * @brief The statistics of a column if they are known and the column has not changed
+     * since. Otherwise nullptr is returned, the statistics are computed in the background
+     * and columnStatisticsReady is emitted once they are available
+     */
+    const ColumnStatistics *getColumnStatistics(size_t column);
+    void invalidate(size_t column);
+    void invalidateAll();
+    /** @brief Stops and waits for any computation, must be called before the table goes away */
+    void cancelPending();
+
+  signals:
+    void columnStatisticsReady(size_t column);
+
+  private:
+    // cheap to read values that change when the contents of a column change
+    struct ColumnFingerprint {
+        std::string name;
+        size_t rowCount;
+        double total;
+        double minimum;
+        double maximum;
+        bool operator==(const ColumnFingerprint &other) const {
+            return name == other.name && rowCount == other.rowCount && total == other.total &&
+                   minimum == other.minimum && maximum == other.maximum;
+        }
+    };
+
+    ColumnFingerprint getFingerprint(size_t column) const;
+    static ColumnStatistics computeStatistics(AttributeTable &attributes, size_t column,
+                                              const std::atomic<bool> &cancelled);
+
+    AttributeTable &m_attributes;
+    std::map<size_t, std::pair<ColumnFingerprint, ColumnStatistics>> m_cache;
+    std::set<size_t> m_pending;
+    QList<QFuture<void>> m_running;
+    std::atomic<bool> m_cancelled = false;
+};
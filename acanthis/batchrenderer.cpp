@@ -0,0 +1,286 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "batchrenderer.h"
+
+#include "agl/func/aglvectorwriter.h"
+#include "agl/view/aglimageexport.h"
+#include "agl/viewmodel/aglmapviewmodel.h"
+#include "graphmodel.h"
+#include "graphviewmodel.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QProcess>
+#include <QThread>
+#include <QThreadPool>
+#include <QtDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+namespace {
+    const char *const RENDER_OPTION = "--render";
+    const char *const BATCH_OPTION = "--batch";
+    // around the graph, as a fraction of its size
+    const double MARGIN = 0.02;
+} // namespace
+
+bool BatchRenderer::isRequested(const QStringList &arguments) {
+    return arguments.contains(RENDER_OPTION) || arguments.contains(BATCH_OPTION);
+}
+
+bool BatchRenderer::isRequested(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], RENDER_OPTION) == 0 || std::strcmp(argv[i], BATCH_OPTION) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool BatchRenderer::parseArguments(const QStringList &arguments, QString &error) {
+    // the first is the program
+    if (!parseJobArguments(arguments, 1, error))
+        return false;
+    if (m_jobs.empty()) {
+        error = "Nothing to render";
+        return false;
+    }
+    for (const Job &job : m_jobs) {
+        if (job.outFile.isEmpty()) {
+            error = QString("No output given for %1").arg(job.graphFile);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BatchRenderer::parseJobArguments(const QStringList &arguments, int first, QString &error) {
+    for (int i = first; i < arguments.size(); ++i) {
+        const QString &option = arguments[i];
+        // every option takes a value
+        if (i + 1 >= arguments.size()) {
+            error = QString("No value given for %1").arg(option);
+            return false;
+        }
+        const QString &value = arguments[++i];
+        if (option == RENDER_OPTION) {
+            m_jobs.emplace_back();
+            m_jobs.back().graphFile = value;
+            continue;
+        }
+        if (option == "--jobs") {
+            bool valid = false;
+            m_threadCount = value.toInt(&valid);
+            if (!valid || m_threadCount < 1) {
+                error = QString("Not a number of jobs: %1").arg(value);
+                return false;
+            }
+            continue;
+        }
+        if (option == BATCH_OPTION) {
+            QFile list(value);
+            if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                error = QString("Could not read the batch list %1").arg(value);
+                return false;
+            }
+            while (!list.atEnd()) {
+                QString line = QString::fromUtf8(list.readLine()).trimmed();
+                if (line.isEmpty() || line.startsWith('#'))
+                    continue;
+                if (!parseJobArguments(QProcess::splitCommand(line), 0, error))
+                    return false;
+            }
+            continue;
+        }
+        if (m_jobs.empty()) {
+            error = QString("%1 given before %2").arg(option, QString(RENDER_OPTION));
+            return false;
+        }
+        Job &job = m_jobs.back();
+        if (option == "--layer") {
+            job.layers.append(value);
+        } else if (option == "--attribute") {
+            job.attribute = value;
+        } else if (option == "--out") {
+            job.outFile = value;
+        } else if (option == "--size") {
+            QStringList dimensions = value.split('x');
+            bool validWidth = false;
+            bool validHeight = false;
+            int width = dimensions.value(0).toInt(&validWidth);
+            int height = dimensions.value(1).toInt(&validHeight);
+            if (dimensions.size() != 2 || !validWidth || !validHeight || width <= 0 ||
+                height <= 0) {
+                error = QString("Size should be <width>x<height>, not %1").arg(value);
+                return false;
+            }
+            job.size = QSize(width, height);
+        } else {
+            error = QString("Unknown option %1").arg(option);
+            return false;
+        }
+    }
+    return true;
+}
+
+int BatchRenderer::run() {
+    size_t jobCount = m_jobs.size();
+    int threadCount = std::min(m_threadCount > 0 ? m_threadCount : QThread::idealThreadCount(),
+                               static_cast<int>(jobCount));
+    // surfaces can only be made on the GUI thread, each worker makes its context on this
+    // one of its own
+    std::vector<std::unique_ptr<QOffscreenSurface>> surfaces;
+    for (int worker = 0; worker < threadCount; ++worker) {
+        auto surface = std::make_unique<QOffscreenSurface>();
+        surface->setFormat(QSurfaceFormat::defaultFormat());
+        surface->create();
+        if (!surface->isValid()) {
+            qCritical() << "Could not create an offscreen surface";
+            return 1;
+        }
+        surfaces.push_back(std::move(surface));
+    }
+
+    std::atomic<size_t> nextJob(0);
+    std::atomic<int> failures(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (auto &surface : surfaces) {
+        QOffscreenSurface *workerSurface = surface.get();
+        pool.start([this, workerSurface, jobCount, &nextJob, &failures]() {
+            QOpenGLContext context;
+            context.setFormat(workerSurface->format());
+            bool hasContext = context.create() && context.makeCurrent(workerSurface);
+            for (size_t index = nextJob++; index < jobCount; index = nextJob++) {
+                const Job &job = m_jobs[index];
+                QString error = "No OpenGL context";
+                bool rendered = (hasContext || isVectorOutput(job)) && render(job, error);
+                if (rendered) {
+                    qInfo().noquote() << "Rendered" << job.outFile;
+                } else {
+                    qWarning().noquote() << "Could not render" << job.graphFile << "-" << error;
+                    ++failures;
+                }
+            }
+            if (hasContext)
+                context.doneCurrent();
+        });
+    }
+    pool.waitForDone();
+    return failures == 0 ? 0 : 1;
+}
+
+bool BatchRenderer::isVectorOutput(const Job &job) {
+    QString suffix = QFileInfo(job.outFile).suffix().toLower();
+    return suffix == "svg" || suffix == "pdf";
+}
+
+bool BatchRenderer::render(const Job &job, QString &error) {
+    GraphModel graphModel(job.graphFile.toStdString());
+    if (!graphModel.wasReadFromFile()) {
+        error = "The graph file could not be read";
+        return false;
+    }
+    return render(graphModel, job, error);
+}
+
+bool BatchRenderer::render(GraphModel &graphModel, const Job &job, QString &error) {
+    GraphViewModel graphViewModel("batch", nullptr);
+    graphViewModel.setGraphModel(&graphModel);
+
+    bool layerFound = job.layers.isEmpty();
+    bool attributeFound = job.attribute.isEmpty();
+    for (auto &mapLayer : graphViewModel.getMapLayers()) {
+        if (!job.layers.isEmpty())
+            mapLayer->setVisible(job.layers.contains(mapLayer->getName()));
+        if (!mapLayer->isVisible())
+            continue;
+        layerFound = true;
+        if (!job.attribute.isEmpty() && mapLayer->setDisplayedAttribute(job.attribute))
+            attributeFound = true;
+    }
+    if (!layerFound) {
+        error = QString("No layer named %1").arg(job.layers.join(", "));
+        return false;
+    }
+    if (!attributeFound) {
+        error = QString("No layer drawn has the attribute %1").arg(job.attribute);
+        return false;
+    }
+
+    // the whole graph, widened to the shape of the image
+    QtRegion bounds = graphViewModel.getBoundingBox();
+    double boundsWidth = bounds.top_right.x - bounds.bottom_left.x;
+    double boundsHeight = bounds.top_right.y - bounds.bottom_left.y;
+    if (boundsWidth <= 0 && boundsHeight <= 0) {
+        error = "The graph is empty";
+        return false;
+    }
+    double centreX = (bounds.bottom_left.x + bounds.top_right.x) * 0.5;
+    double centreY = (bounds.bottom_left.y + bounds.top_right.y) * 0.5;
+    double aspect = static_cast<double>(job.size.width()) / job.size.height();
+    double viewHeight = std::max(boundsHeight, boundsWidth / aspect) * (1.0 + 2.0 * MARGIN);
+    double viewWidth = viewHeight * aspect;
+
+    if (isVectorOutput(job)) {
+        QtRegion region;
+        region.bottom_left = Point2f(centreX - viewWidth * 0.5, centreY - viewHeight * 0.5);
+        region.top_right = Point2f(centreX + viewWidth * 0.5, centreY + viewHeight * 0.5);
+        AGLVectorWriter writer(job.outFile, region, QSizeF(job.size), Qt::white);
+        if (!writer.open()) {
+            error = "The output could not be written";
+            return false;
+        }
+        for (auto &mapLayer : graphViewModel.getMapLayers()) {
+            if (!mapLayer->isVisible())
+                continue;
+            writer.beginLayer(mapLayer->getName());
+            mapLayer->writeVectors(writer, region);
+            writer.endLayer();
+        }
+        if (!writer.finish()) {
+            error = "The output could not be written";
+            return false;
+        }
+        return true;
+    }
+
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    bool core = context->format().profile() == QSurfaceFormat::CoreProfile;
+    AGLMapViewModel model(&graphViewModel);
+    model.loadGLObjects();
+    model.initializeGL(core);
+    model.loadGLObjectsRequiringGLContext();
+    model.updateGL(core);
+
+    // the same state as the map view draws with, over the default background
+    QOpenGLFunctions *f = context->functions();
+    f->glClearColor(1, 1, 1, 1);
+    f->glDisable(GL_DEPTH_TEST);
+    f->glEnable(GL_CULL_FACE);
+    f->glEnable(GL_BLEND);
+    f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // the camera is at the centre, the projection goes around it
+    model.setEyePosition(-centreX, -centreY);
+    QMatrix4x4 mView;
+    mView.translate(0, 0, -1);
+    QMatrix4x4 mModel;
+    AGLImageExport imageExport(ANTIALIASING_SAMPLES);
+    bool exported = imageExport.run(
+        job.outFile, job.size, QRectF(-viewWidth * 0.5, -viewHeight * 0.5, viewWidth, viewHeight),
+        [&model, &mView, &mModel](const QMatrix4x4 &mProj) {
+            model.paintGL(mProj, mView, mModel);
+        });
+    model.cleanup();
+    if (!exported)
+        error = "The output could not be written";
+    return exported;
+}
@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QSize>
+#include <QStringList>
+
+#include <vector>
+
+class GraphModel;
+
+// Renders graph files to images without a window, for batches run from the command line:
+//
+//   acanthis --render <file.graph> [--layer <name>]... [--attribute <column>]
+//            [--size <width>x<height>] --out <image> [--render ...] [--batch <list>]
+//            [--jobs <count>]
+//
+// Each --render starts a job and the options after it apply to that job. A batch list holds
+// one job per line in the same form. The images show the whole graph, drawn from the named
+// layers (all visible layers otherwise) coloured by the attribute if given, and are written
+// as PNG, TIFF, SVG or PDF by the suffix of the output. Jobs run in parallel, each worker
+// with a context of its own.
+
+class BatchRenderer {
+  public:
+    static const int DEFAULT_WIDTH = 1920;
+    static const int DEFAULT_HEIGHT = 1080;
+    static const int ANTIALIASING_SAMPLES = 4;
+
+    struct Job {
+        QString graphFile;
+        QStringList layers;
+        QString attribute;
+        QSize size = QSize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+        QString outFile;
+    };
+
+    /** @brief Whether the command line asks for a batch render rather than the window */
+    static bool isRequested(const QStringList &arguments);
+    static bool isRequested(int argc, char *argv[]);
+
+    /** @brief Reads the jobs from the command line, false with the reason in error if wrong */
+    bool parseArguments(const QStringList &arguments, QString &error);
+    /** @brief Renders all the jobs, returns the exit code of the application */
+    int run();
+
+    /**
+     * @brief Renders one job, with the context current on this thread for images, false
+     * with the reason in error if it failed
+     */
+    static bool render(const Job &job, QString &error);
+    /** @brief As render(), from a graph already loaded instead of the file of the job */
+    static bool render(GraphModel &graphModel, const Job &job, QString &error);
+
+  private:
+    bool parseJobArguments(const QStringList &arguments, int first, QString &error);
+    static bool isVectorOutput(const Job &job);
+
+    std::vector<Job> m_jobs;
+    int m_threadCount = 0;
+};
@@ -5,7 +5,10 @@
 #include "coreapplication.h"
 
 #include "agl/view/aglmapviewport.h"
+#include "aqattributetablemodel.h"
 #include "aqmapviewmodel.h"
+#include "batchrenderer.h"
+#include "documentthumbnailprovider.h"
 #include "settingsimpl.h"
 
 #include <QQmlApplicationEngine>
@@ -13,6 +16,18 @@
 #include <QtQuick/QQuickView>
 
 int CoreApplication::exec() {
+    auto args = arguments();
+    if (BatchRenderer::isRequested(args)) {
+        // no window, nor any of the settings of the interface
+        BatchRenderer batchRenderer;
+        QString error;
+        if (!batchRenderer.parseArguments(args, error)) {
+            qCritical().noquote() << error;
+            return 2;
+        }
+        return batchRenderer.run();
+    }
+
     SettingsImpl settings(new DefaultSettingsFactory);
 
     if (!settings.readSetting(SettingTag::licenseAccepted, false).toBool()) {
@@ -26,7 +41,6 @@ int CoreApplication::exec() {
         settings.writeSetting(SettingTag::licenseAccepted, true);
     }
 
-    auto args = arguments();
     std::string fileToLoad = m_fileToLoad;
     if (args.length() == 2) {
         fileToLoad = args[1].toStdString();
@@ -42,12 +56,13 @@ int CoreApplication::exec() {
     qmlRegisterType<AGLMapViewport>("acanthis", versionMajor, versionMinor, "AGLMapViewport");
     //    qmlRegisterType<GraphViewModel>("acanthis", versionMajor, versionMinor, "GraphViewModel");
     qmlRegisterType<AQMapViewModel>("acanthis", versionMajor, versionMinor, "AQMapViewModel");
-    qmlRegisterSingletonType<DocumentManager>("acanthis", versionMajor, versionMinor,
-                                              "DocumentManager",
-                                              [&](QQmlEngine *, QJSEngine *) -> QObject * {
-                                                  return new DocumentManager;
-                                                  // the QML engine takes ownership of the singleton
-                                              });
+    qmlRegisterType<AQAttributeTableModel>("acanthis", versionMajor, versionMinor,
+                                           "AQAttributeTableModel");
+    // made here rather than by the engine so that the thumbnails can find the open documents,
+    // and outlives the engine
+    DocumentManager documentManager;
+    qmlRegisterSingletonInstance("acanthis", versionMajor, versionMinor, "DocumentManager",
+                                 &documentManager);
 
     qmlRegisterUncreatableType<GraphModel>(
         "acanthis", versionMajor, versionMinor, "GraphModel",
@@ -57,6 +72,8 @@ int CoreApplication::exec() {
                              versionMinor, "Theme");
 
     QQmlApplicationEngine engine;
+    // the engine takes ownership of the provider
+    engine.addImageProvider("thumbnail", new DocumentThumbnailProvider(&documentManager));
 
     QJSValue jsMetaObject = engine.newQMetaObject(&GraphViewModel::staticMetaObject);
     engine.globalObject().setProperty(GraphViewModel::staticMetaObject.className(), jsMetaObject);
@@ -4,10 +4,38 @@
 
 #include "documentmanager.h"
 
+#include "settingsimpl.h"
+
 #include <QDir>
+#include <QFileInfo>
 #include <QUrl>
 
-DocumentManager::DocumentManager() {}
+#include <algorithm>
+
+DocumentManager::DocumentManager() {
+    SettingsImpl settings(new DefaultSettingsFactory);
+    qint64 memoryBudgetMB =
+        settings.readSetting(SettingTag::documentMemoryBudget, DEFAULT_MEMORY_BUDGET_MB)
+            .toLongLong();
+    m_memoryBudget = memoryBudgetMB * 1024 * 1024;
+
+    // files moved or deleted since are dropped
+    for (const QString &fileName :
+         settings.readSetting(SettingTag::recentFileList).toStringList()) {
+        if (QFileInfo::exists(fileName))
+            m_recentFiles.append(fileName);
+    }
+}
+
+void DocumentManager::addRecentFile(const QString &fileName) {
+    m_recentFiles.removeAll(fileName);
+    m_recentFiles.prepend(fileName);
+    while (m_recentFiles.size() > MAX_RECENT_FILES)
+        m_recentFiles.removeLast();
+    SettingsImpl settings(new DefaultSettingsFactory);
+    settings.writeSetting(SettingTag::recentFileList, m_recentFiles);
+    emit recentFilesChanged();
+}
 
 void DocumentManager::createEmptyDocument() {
     std::string newDocName = "Untitled";
@@ -17,14 +45,51 @@ void DocumentManager::createEmptyDocument() {
         newDocName = "Untitled " + std::to_string(counter);
         ++counter;
     }
-    m_openedDocuments.push_back(
-        std::make_pair(newDocName, std::unique_ptr<GraphModel>(new GraphModel(newDocName))));
+    auto document = std::unique_ptr<GraphModel>(new GraphModel(newDocName));
+    {
+        std::lock_guard<std::mutex> lock(m_openedDocumentsMutex);
+        m_openedDocuments.push_back(std::make_pair(newDocName, std::move(document)));
+    }
     m_lastDocumentIndex = static_cast<unsigned int>(m_openedDocuments.size() - 1);
+    markActive(m_openedDocuments.back().second.get());
 }
 
 void DocumentManager::removeDocument(unsigned int index) {
-    auto openDocument = m_openedDocuments.begin() + index;
-    m_openedDocuments.erase(openDocument);
+    std::unique_ptr<GraphModel> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_openedDocumentsMutex);
+        auto openDocument = m_openedDocuments.begin() + index;
+        removed = std::move(openDocument->second);
+        m_openedDocuments.erase(openDocument);
+    }
+    m_lastActivated.erase(removed.get());
+    // destroyed out of the lock, as it waits for any work still reading it
+    removed.reset();
+}
+
+GraphModel *DocumentManager::lockLoadedDocument(const std::string &fileName,
+                                                std::shared_lock<std::shared_mutex> &lock) {
+    std::lock_guard<std::mutex> documentsLock(m_openedDocumentsMutex);
+    auto doc = std::find_if(m_openedDocuments.begin(), m_openedDocuments.end(),
+                            NameDocumentComparator(fileName));
+    if (doc == m_openedDocuments.end())
+        return nullptr;
+    // taken before the list is let go, so that the document can not be removed in between
+    lock = doc->second->lockMetaGraph();
+    if (!doc->second->hasMetaGraph()) {
+        lock.unlock();
+        return nullptr;
+    }
+    return doc->second.get();
+}
+
+QImage DocumentManager::getUnloadedThumbnail(const std::string &fileName) {
+    std::lock_guard<std::mutex> documentsLock(m_openedDocumentsMutex);
+    auto doc = std::find_if(m_openedDocuments.begin(), m_openedDocuments.end(),
+                            NameDocumentComparator(fileName));
+    if (doc == m_openedDocuments.end())
+        return QImage();
+    return doc->second->getUnloadedThumbnail();
 }
 
 void DocumentManager::openDocument(QString urlString) {
@@ -40,10 +105,48 @@ void DocumentManager::openDocument(QString urlString) {
     if (doc != m_openedDocuments.end()) {
         m_lastDocumentIndex =
             static_cast<unsigned int>(std::distance(m_openedDocuments.begin(), doc));
+        setActiveDocument(m_lastDocumentIndex);
         return;
     }
 
-    m_openedDocuments.push_back(
-        std::make_pair(fileName, std::unique_ptr<GraphModel>(new GraphModel(fileName))));
+    auto document = std::unique_ptr<GraphModel>(new GraphModel(fileName));
+    {
+        std::lock_guard<std::mutex> lock(m_openedDocumentsMutex);
+        m_openedDocuments.push_back(std::make_pair(fileName, std::move(document)));
+    }
     m_lastDocumentIndex = static_cast<unsigned int>(m_openedDocuments.size() - 1);
+    setActiveDocument(m_lastDocumentIndex);
+    if (m_openedDocuments.back().second->wasReadFromFile())
+        addRecentFile(QString::fromStdString(fileName));
+}
+
+void DocumentManager::setActiveDocument(unsigned int index) {
+    if (index >= m_openedDocuments.size())
+        return;
+    GraphModel *document = m_openedDocuments[index].second.get();
+    if (!document->isLoaded())
+        document->reload();
+    markActive(document);
+    unloadToBudget(document);
+}
+
+void DocumentManager::unloadToBudget(const GraphModel *activeDocument) {
+    if (m_memoryBudget <= 0)
+        return;
+    qint64 memoryUsed = 0;
+    std::vector<std::pair<uint64_t, GraphModel *>> candidates;
+    for (auto &openedDocument : m_openedDocuments) {
+        GraphModel *document = openedDocument.second.get();
+        memoryUsed += document->getMemoryEstimate();
+        if (document != activeDocument && document->canUnload())
+            candidates.push_back(std::make_pair(m_lastActivated[document], document));
+    }
+    // least recently viewed first
+    std::sort(candidates.begin(), candidates.end());
+    for (auto &candidate : candidates) {
+        if (memoryUsed <= m_memoryBudget)
+            break;
+        memoryUsed -= candidate.second->getMemoryEstimate();
+        candidate.second->unload();
+    }
 }
@@ -7,6 +7,11 @@
 #include "graphmodel.h"
 
 #include <QObject>
+#include <QStringList>
+
+#include <map>
+#include <mutex>
+#include <shared_mutex>
 
 class DocumentManager : public QObject {
     Q_OBJECT
@@ -23,6 +28,7 @@ class DocumentManager : public QObject {
     // https://embeddeduse.com/2020/01/19/address-sanitizers-qml-engine-deletes-c-objects-still-in-use/
 
     Q_PROPERTY(GraphModel *lastDocument READ lastDocument)
+    Q_PROPERTY(QStringList recentFiles READ recentFiles NOTIFY recentFilesChanged)
 
     struct NameDocumentComparator {
         NameDocumentComparator(std::string const &s) : _s(s) {}
@@ -32,14 +38,34 @@ class DocumentManager : public QObject {
         std::string _s;
     };
     std::vector<std::pair<std::string, std::unique_ptr<GraphModel>>> m_openedDocuments;
+    // held while the list of documents is changed on the GUI thread, or read from others
+    std::mutex m_openedDocumentsMutex;
 
     unsigned int m_lastDocumentIndex = 0;
 
+    // Documents not viewed recently are unloaded once the loaded ones exceed the budget
+    // (0 for no limit). The documents are ordered by the tick at which they were last
+    // made active.
+    qint64 m_memoryBudget = 0;
+    uint64_t m_activationTick = 0;
+    std::map<const GraphModel *, uint64_t> m_lastActivated;
+
+    void markActive(const GraphModel *document) { m_lastActivated[document] = ++m_activationTick; }
+    void unloadToBudget(const GraphModel *activeDocument);
+
+    // Most recently opened first, kept in the settings across sessions
+    QStringList m_recentFiles;
+    void addRecentFile(const QString &fileName);
+
   public:
+    static const qint64 DEFAULT_MEMORY_BUDGET_MB = 2048;
+    static const int MAX_RECENT_FILES = 10;
+
     DocumentManager();
     Q_INVOKABLE void createEmptyDocument();
     Q_INVOKABLE void removeDocument(unsigned int index);
     Q_INVOKABLE void openDocument(QString urlString);
+    Q_INVOKABLE void setActiveDocument(unsigned int index);
     Q_INVOKABLE bool hasDocument() { return !m_openedDocuments.empty(); }
     Q_INVOKABLE unsigned int lastDocumentIndex() { return m_lastDocumentIndex; }
     Q_INVOKABLE unsigned int numOpenedDocuments() {
@@ -47,4 +73,20 @@ class DocumentManager : public QObject {
     }
 
     GraphModel *lastDocument() { return m_openedDocuments[m_lastDocumentIndex].second.get(); }
+    QStringList recentFiles() const { return m_recentFiles; }
+
+    /**
+     * @brief The open and loaded document of the file, kept loaded while the lock is held.
+     * nullptr if there is none. Can be called from any thread
+     */
+    GraphModel *lockLoadedDocument(const std::string &fileName,
+                                   std::shared_lock<std::shared_mutex> &lock);
+    /**
+     * @brief The picture kept of the open document of the file while it is unloaded, null if
+     * there is none. Can be called from any thread
+     */
+    QImage getUnloadedThumbnail(const std::string &fileName);
+
+  signals:
+    void recentFilesChanged();
 };
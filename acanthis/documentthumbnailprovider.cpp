@@ -0,0 +1,159 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "documentthumbnailprovider.h"
+
+#include "batchrenderer.h"
+#include "documentmanager.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QOpenGLContext>
+#include <QStandardPaths>
+#include <QUrl>
+
+DocumentThumbnailProvider::DocumentThumbnailProvider(DocumentManager *documentManager)
+    : m_documentManager(documentManager),
+      m_cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                 "/thumbnails") {
+    m_cacheDir.mkpath(".");
+    m_renderPool.setMaxThreadCount(1);
+    // surfaces can only be made on the GUI thread, the provider is made there by the
+    // application before the engine loads anything
+    m_surface = std::make_unique<QOffscreenSurface>();
+    m_surface->setFormat(QSurfaceFormat::defaultFormat());
+    m_surface->create();
+}
+
+DocumentThumbnailProvider::~DocumentThumbnailProvider() {
+    m_renderPool.clear();
+    m_renderPool.waitForDone();
+}
+
+QQuickImageResponse *DocumentThumbnailProvider::requestImageResponse(const QString &id,
+                                                                     const QSize &requestedSize) {
+    QSize size = requestedSize;
+    if (size.width() <= 0 || size.height() <= 0)
+        size = QSize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+    QString fileName = QUrl::fromPercentEncoding(id.toUtf8());
+
+    auto response = new DocumentThumbnailResponse;
+    auto renderer = new DocumentThumbnailRenderer(fileName, size, m_cacheDir, m_surface.get(),
+                                                  m_documentManager);
+    // the response may be deleted by the engine before the renderer is done, the connection
+    // goes with it
+    QObject::connect(renderer, &DocumentThumbnailRenderer::done, response,
+                     &DocumentThumbnailResponse::setResult, Qt::QueuedConnection);
+    m_renderPool.start(renderer);
+    return response;
+}
+
+QQuickTextureFactory *DocumentThumbnailResponse::textureFactory() const {
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+void DocumentThumbnailResponse::setResult(const QImage &image, const QString &errorString) {
+    m_image = image;
+    m_errorString = errorString;
+    emit finished();
+}
+
+void DocumentThumbnailRenderer::run() {
+    QString error;
+    QImage image = getThumbnail(error);
+    emit done(image, error);
+}
+
+QImage DocumentThumbnailRenderer::getThumbnail(QString &error) {
+    QFileInfo fileInfo(m_fileName);
+    if (!fileInfo.isFile()) {
+        error = QString("No file %1").arg(m_fileName);
+        return QImage();
+    }
+    QString key = getCacheKey(fileInfo);
+    if (key.isEmpty()) {
+        error = QString("Could not read %1").arg(m_fileName);
+        return QImage();
+    }
+    QString cacheFile = m_cacheDir.filePath(
+        QString("%1-%2x%3.png").arg(key).arg(m_size.width()).arg(m_size.height()));
+    if (QFile::exists(cacheFile)) {
+        QImage cached(cacheFile);
+        if (!cached.isNull())
+            return cached;
+    }
+
+    // an open document that is unloaded has a picture of it kept instead, which is shown
+    // rather than reading the file back
+    QImage unloadedThumbnail = m_documentManager == nullptr
+                                   ? QImage()
+                                   : m_documentManager->getUnloadedThumbnail(
+                                         m_fileName.toStdString());
+    if (!unloadedThumbnail.isNull())
+        return unloadedThumbnail.scaled(m_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    if (!m_surface->isValid()) {
+        error = "Could not create an offscreen surface";
+        return QImage();
+    }
+    QOpenGLContext context;
+    context.setFormat(m_surface->format());
+    if (!context.create() || !context.makeCurrent(m_surface)) {
+        error = "No OpenGL context";
+        return QImage();
+    }
+    // written next to the cache file and moved over it once complete, so that a thumbnail
+    // being written is never read
+    QString partFile = cacheFile;
+    partFile.insert(partFile.size() - 4, ".part");
+    BatchRenderer::Job job;
+    job.graphFile = m_fileName;
+    job.size = m_size;
+    job.outFile = partFile;
+    // an open document is kept loaded until its thumbnail is done, rather than being read
+    // from the file a second time
+    std::shared_lock<std::shared_mutex> documentLock;
+    GraphModel *openDocument =
+        m_documentManager == nullptr
+            ? nullptr
+            : m_documentManager->lockLoadedDocument(m_fileName.toStdString(), documentLock);
+    bool rendered = openDocument != nullptr ? BatchRenderer::render(*openDocument, job, error)
+                                            : BatchRenderer::render(job, error);
+    if (documentLock.owns_lock())
+        documentLock.unlock();
+    context.doneCurrent();
+    if (!rendered)
+        return QImage();
+    QFile::remove(cacheFile);
+    if (!QFile::rename(partFile, cacheFile)) {
+        QFile::remove(partFile);
+        error = "The thumbnail could not be cached";
+        return QImage();
+    }
+    pruneCache();
+    return QImage(cacheFile);
+}
+
+QString DocumentThumbnailRenderer::getCacheKey(const QFileInfo &fileInfo) const {
+    // the start of the file, rather than its path, so that moved or copied files keep their
+    // thumbnail. The size and time tell apart files that start the same
+    QFile file(fileInfo.filePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(file.read(DocumentThumbnailProvider::HASHED_BYTES));
+    hash.addData(QByteArray::number(fileInfo.size()));
+    hash.addData(QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch()));
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+void DocumentThumbnailRenderer::pruneCache() {
+    QFileInfoList entries =
+        m_cacheDir.entryInfoList({"*.png"}, QDir::Files, QDir::Time | QDir::Reversed);
+    for (qsizetype i = 0; i < entries.size() - DocumentThumbnailProvider::MAX_CACHE_ENTRIES;
+         ++i) {
+        QFile::remove(entries[i].filePath());
+    }
+}
@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QQuickAsyncImageProvider>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <memory>
+
+class DocumentManager;
+
+/**
+ * @brief Small pictures of graph files for the interface, given to QML as
+ * image://thumbnail/<file path, percent-encoded>. A thumbnail is rendered off the GUI thread
+ * the first time a file is asked for, and kept on disk keyed by a hash of the file and its
+ * modification time, so that later requests (and later sessions) only read a small image
+ * instead of the whole graph. Documents that are open are rendered from the graph already
+ * in memory, or shown as last drawn while unloaded, only other files are read for it. Files
+ * that can not be read give an error, which the views show as no thumbnail.
+ */
+class DocumentThumbnailProvider : public QQuickAsyncImageProvider {
+  public:
+    static const int DEFAULT_WIDTH = 256;
+    static const int DEFAULT_HEIGHT = 160;
+    // thumbnails kept on disk, the ones not written for the longest are removed past this
+    static const int MAX_CACHE_ENTRIES = 256;
+    // bytes from the start of the file hashed into the key, along with its size and time
+    static const qint64 HASHED_BYTES = 1 << 16;
+
+    explicit DocumentThumbnailProvider(DocumentManager *documentManager);
+    ~DocumentThumbnailProvider();
+
+    QQuickImageResponse *requestImageResponse(const QString &id,
+                                              const QSize &requestedSize) override;
+
+  private:
+    DocumentManager *m_documentManager;
+    QDir m_cacheDir;
+    // renders one thumbnail at a time, on the one surface
+    QThreadPool m_renderPool;
+    std::unique_ptr<QOffscreenSurface> m_surface;
+};
+
+class DocumentThumbnailResponse : public QQuickImageResponse {
+    Q_OBJECT
+
+    QImage m_image;
+    QString m_errorString;
+
+  public:
+    QQuickTextureFactory *textureFactory() const override;
+    QString errorString() const override { return m_errorString; }
+
+  public slots:
+    void setResult(const QImage &image, const QString &errorString);
+};
+
+class DocumentThumbnailRenderer : public QObject, public QRunnable {
+    Q_OBJECT
+
+    QString m_fileName;
+    QSize m_size;
+    QDir m_cacheDir;
+    QOffscreenSurface *m_surface;
+    DocumentManager *m_documentManager;
+
+    /** @brief The thumbnail from the cache, rendered into it first if not there */
+    QImage getThumbnail(QString &error);
+    QString getCacheKey(const QFileInfo &fileInfo) const;
+    void pruneCache();
+
+  public:
+    DocumentThumbnailRenderer(const QString &fileName, const QSize &size, const QDir &cacheDir,
+                              QOffscreenSurface *surface, DocumentManager *documentManager)
+        : m_fileName(fileName), m_size(size), m_cacheDir(cacheDir), m_surface(surface),
+          m_documentManager(documentManager) {}
+
+    void run() override;
+
+  signals:
+    void done(const QImage &image, const QString &errorString);
+};
@@ -4,9 +4,102 @@
 
 #include "graphmodel.h"
 
+#include <QFileInfo>
 #include <QVariant>
 
 GraphModel::GraphModel(std::string filename) : m_filename(filename) {
-    m_metaGraph = std::unique_ptr<MetaGraph>(new MetaGraph(filename));
-    m_metaGraph->readFromFile(filename);
+    load();
+    // only documents that live on disk get a sidecar
+    if (QFileInfo::exists(QString::fromStdString(filename))) {
+        m_triangulationCache = std::unique_ptr<AGLTriangulationCache>(
+            new AGLTriangulationCache(AGLTriangulationCache::sidecarFilename(
+                QString::fromStdString(filename))));
+    }
+}
+
+GraphModel::~GraphModel() {
+    // let the views stop using (and computing on) the MetaGraph before it goes away
+    if (isLoaded())
+        emit aboutToUnload();
+    flushTriangulationCache();
+    // and wait for the work that is still reading it
+    std::unique_lock<std::shared_mutex> lock(m_metaGraphMutex);
+}
+
+void GraphModel::flushTriangulationCache() {
+    // kept off the render thread, and done once for all the views as each flush rewrites
+    // the whole file
+    if (m_triangulationCache != nullptr && m_triangulationCache->hasPendingEntries())
+        m_triangulationCache->flush();
+}
+
+void GraphModel::load() {
+    {
+        std::lock_guard<std::mutex> lock(m_unloadedThumbnailMutex);
+        m_unloadedThumbnail = QImage();
+    }
+    // read before the lock is taken, so that the work still on the graph is not held up
+    auto metaGraph = std::unique_ptr<MetaGraph>(new MetaGraph(m_filename));
+    auto readStatus = metaGraph->readFromFile(m_filename);
+    std::unique_lock<std::shared_mutex> lock(m_metaGraphMutex);
+    m_metaGraph = std::move(metaGraph);
+    // files from older versions are still read, with a warning
+    m_readFromFile = readStatus == MetaGraph::OK || readStatus == MetaGraph::WARN_BUGGY_VERSION ||
+                     readStatus == MetaGraph::WARN_CONVERTED;
+}
+
+bool GraphModel::canUnload() const {
+    return isLoaded() && QFileInfo::exists(QString::fromStdString(m_filename));
+}
+
+void GraphModel::unload() {
+    if (!canUnload())
+        return;
+    emit aboutToUnload();
+    // the cache has its own lock, no need to hold up the work still on the graph with it
+    flushTriangulationCache();
+    std::unique_lock<std::shared_mutex> lock(m_metaGraphMutex);
+    m_metaGraph.reset();
+    // the views have let go of the cache along with the layers
+    std::lock_guard<std::mutex> cacheLock(m_vertexBufferCacheMutex);
+    m_vertexBufferCache.reset();
+    m_vertexBufferCacheOpened = false;
+}
+
+void GraphModel::reload() {
+    if (isLoaded())
+        return;
+    load();
+    emit reloaded();
+}
+
+QImage GraphModel::getUnloadedThumbnail() const {
+    std::lock_guard<std::mutex> lock(m_unloadedThumbnailMutex);
+    return m_unloadedThumbnail;
+}
+
+void GraphModel::setUnloadedThumbnail(const QImage &thumbnail) {
+    std::lock_guard<std::mutex> lock(m_unloadedThumbnailMutex);
+    m_unloadedThumbnail = thumbnail;
+}
+
+qint64 GraphModel::getMemoryEstimate() const {
+    if (!isLoaded())
+        return 0;
+    // the file size is a proxy for the size of the structures read from it
+    return QFileInfo(QString::fromStdString(m_filename)).size();
+}
+
+AGLVertexBufferCache *GraphModel::getVertexBufferCache() {
+    std::lock_guard<std::mutex> lock(m_vertexBufferCacheMutex);
+    if (!m_vertexBufferCacheOpened) {
+        QString cacheFilename =
+            AGLVertexBufferCache::cacheFilename(QString::fromStdString(m_filename));
+        if (!cacheFilename.isEmpty()) {
+            m_vertexBufferCache =
+                std::unique_ptr<AGLVertexBufferCache>(new AGLVertexBufferCache(cacheFilename));
+        }
+        m_vertexBufferCacheOpened = true;
+    }
+    return m_vertexBufferCache.get();
 }
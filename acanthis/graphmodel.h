@@ -4,10 +4,17 @@
 
 #pragma once
 
+#include "agl/func/agltriangulationcache.h"
+#include "agl/func/aglvertexbuffercache.h"
+
 #include "salalib/mgraph.h"
 
+#include <QImage>
 #include <QObject>
 
+#include <mutex>
+#include <shared_mutex>
+
 // This is a representation of the MetaGraph (the file itself) meant
 // to be displayed over multiple views (viewports, lists etc.)
 class GraphViewModel;
@@ -18,13 +25,66 @@ class GraphModel : public QObject {
 
   public:
     GraphModel(std::string filename);
+    ~GraphModel();
 
     MetaGraph &getMetaGraph() const { return *m_metaGraph; }
     bool hasMetaGraph() const { return m_metaGraph.get() != nullptr; }
+    // Whether the file was read the last time the document was loaded. A new document,
+    // or one whose file is missing or damaged, is loaded as an empty MetaGraph
+    bool wasReadFromFile() const { return m_readFromFile; }
+
+    // A document may be unloaded down to its filename to save memory, and read back
+    // from the file when it is needed again. Only documents that live on disk can be
+    // unloaded.
+    bool isLoaded() const { return hasMetaGraph(); }
+    bool canUnload() const;
+    void unload();
+    void reload();
+    /**
+     * @brief The last frame a view drew of the document, kept while it is unloaded so that
+     * it can be shown without reading the file. Null once it is read again. Can be called
+     * from any thread
+     */
+    QImage getUnloadedThumbnail() const;
+    void setUnloadedThumbnail(const QImage &thumbnail);
+    /** @brief Rough number of bytes held while loaded, 0 if unknown */
+    qint64 getMemoryEstimate() const;
+    /**
+     * @brief Keeps the MetaGraph from being unloaded (or destroyed) while the lock is held,
+     * for work on it off the GUI thread. Check hasMetaGraph() once the lock is taken
+     */
+    std::shared_lock<std::shared_mutex> lockMetaGraph() {
+        return std::shared_lock<std::shared_mutex>(m_metaGraphMutex);
+    }
 
     std::string getFilenameStr() { return m_filename; }
     Q_INVOKABLE QString getFilename() { return QString::fromStdString(m_filename); }
 
+    AGLTriangulationCache *getTriangulationCache() { return m_triangulationCache.get(); }
+    AGLVertexBufferCache *getVertexBufferCache();
+
+  signals:
+    // emitted right before the MetaGraph is destroyed so that anything referring into it
+    // can let go, and after it has been read back
+    void aboutToUnload();
+    void reloaded();
+
   private:
+    void load();
+    void flushTriangulationCache();
+
     std::unique_ptr<MetaGraph> m_metaGraph = nullptr;
+    // held shared by anything reading the MetaGraph off the GUI thread, and exclusively
+    // to unload it
+    std::shared_mutex m_metaGraphMutex;
+    bool m_readFromFile = false;
+    QImage m_unloadedThumbnail;
+    mutable std::mutex m_unloadedThumbnailMutex;
+    // polygon triangulations kept in a sidecar file next to the graph
+    std::unique_ptr<AGLTriangulationCache> m_triangulationCache = nullptr;
+    // final vertex buffers, only opened when a view asks for them as it requires
+    // reading the file. Closed on unload, as the file may change before it is read back
+    std::unique_ptr<AGLVertexBufferCache> m_vertexBufferCache = nullptr;
+    bool m_vertexBufferCacheOpened = false;
+    std::mutex m_vertexBufferCacheMutex;
 };
@@ -14,6 +14,8 @@
 #include <QObject>
 #include <QtQmlIntegration/QtQmlIntegration>
 
+#include <vector>
+
 // This class is meant to hold display information about one view[port]
 // of the graph document, such as which items are displayed
 
@@ -30,38 +32,135 @@ class GraphViewModel : public QObject {
     // These are stored as QSharedPointers so that they can be used by the map view tree
     // which stores everything in QSharedPointers
     QList<QSharedPointer<MapLayer>> m_mapLayers;
+    // what the view showed of each layer while the document is unloaded
+    std::vector<MapLayer::ViewState> m_unloadedLayers;
+    unsigned int m_layersGeneration = 0;
+    // where the view was looking, kept by the viewport when the document is unloaded
+    bool m_hasCamera = false;
+    double m_cameraEyePosX = 0;
+    double m_cameraEyePosY = 0;
+    float m_cameraZoomFactor = 0;
 
   public:
     Q_INVOKABLE explicit GraphViewModel(QString id, QObject *) : m_id(id){};
     QList<QSharedPointer<MapLayer>> &getMapLayers() { return m_mapLayers; }
     const QList<QSharedPointer<MapLayer>> &getMapLayers() const { return m_mapLayers; }
     bool hasMetaGraph() const { return m_graphModel->hasMetaGraph(); }
-    const QtRegion getBoundingBox() const { return m_graphModel->getMetaGraph().getBoundingBox(); }
+    const QtRegion getBoundingBox() const {
+        if (!hasMetaGraph())
+            return QtRegion();
+        return m_graphModel->getMetaGraph().getBoundingBox();
+    }
+    AGLVertexBufferCache *getVertexBufferCache() const {
+        return m_graphModel->getVertexBufferCache();
+    }
+    AGLTriangulationCache *getTriangulationCache() const {
+        return m_graphModel->getTriangulationCache();
+    }
 
     void setGraphModel(GraphModel *graphModel) {
         if (graphModel == nullptr)
             return;
         m_graphModel = graphModel;
+        connect(m_graphModel, &GraphModel::aboutToUnload, this, &GraphViewModel::unloadMapLayers);
+        connect(m_graphModel, &GraphModel::reloaded, this, &GraphViewModel::loadMapLayers);
+
+        loadMapLayers();
+
+        emit graphModelChanged();
+    }
+
+    // Increased every time the layers are recreated, so that anything holding on to
+    // data derived from the old layers (i.e. the renderers) knows to rebuild it
+    unsigned int getLayersGeneration() const { return m_layersGeneration; }
 
-        for (ShapeMap &shapeMap : graphModel->getMetaGraph().getDataMaps()) {
-            m_mapLayers.append(QSharedPointer<ShapeMapLayer>(new ShapeMapLayer(shapeMap)));
+    void setCamera(double eyePosX, double eyePosY, float zoomFactor) {
+        m_hasCamera = true;
+        m_cameraEyePosX = eyePosX;
+        m_cameraEyePosY = eyePosY;
+        m_cameraZoomFactor = zoomFactor;
+    }
+    /** @brief false if the view has not been moved by a viewport yet */
+    bool getCamera(double &eyePosX, double &eyePosY, float &zoomFactor) const {
+        if (!m_hasCamera)
+            return false;
+        eyePosX = m_cameraEyePosX;
+        eyePosY = m_cameraEyePosY;
+        zoomFactor = m_cameraZoomFactor;
+        return true;
+    }
+    /** @brief Shown for the document while it is unloaded, see GraphModel */
+    void setUnloadedThumbnail(const QImage &thumbnail) {
+        m_graphModel->setUnloadedThumbnail(thumbnail);
+    }
+
+    void addMapLayer(QSharedPointer<MapLayer> mapLayer) {
+        m_mapLayers.append(mapLayer);
+        ++m_layersGeneration;
+        int row = static_cast<int>(m_mapLayers.size() - 1);
+        emit mapLayersInserted(row, row);
+    }
+
+  private:
+    void loadMapLayers() {
+        if (!m_graphModel->hasMetaGraph() || !m_mapLayers.isEmpty())
+            return;
+        QList<QSharedPointer<MapLayer>> mapLayers;
+        MetaGraph &metaGraph = m_graphModel->getMetaGraph();
+        for (ShapeMap &shapeMap : metaGraph.getDataMaps()) {
+            mapLayers.append(QSharedPointer<ShapeMapLayer>(
+                new ShapeMapLayer(shapeMap, m_graphModel->getTriangulationCache())));
         }
-        for (auto &drawingFile : graphModel->getMetaGraph().m_drawingFiles) {
+        for (auto &drawingFile : metaGraph.m_drawingFiles) {
             for (ShapeMap &shapeMap : drawingFile.m_spacePixels) {
-                m_mapLayers.append(QSharedPointer<ShapeMapLayer>(new ShapeMapLayer(shapeMap)));
+                mapLayers.append(QSharedPointer<ShapeMapLayer>(
+                    new ShapeMapLayer(shapeMap, m_graphModel->getTriangulationCache())));
             }
         }
-        for (auto &shapeGraph : graphModel->getMetaGraph().getShapeGraphs()) {
-            m_mapLayers.append(QSharedPointer<ShapeGraphLayer>(new ShapeGraphLayer(*shapeGraph)));
+        for (auto &shapeGraph : metaGraph.getShapeGraphs()) {
+            mapLayers.append(QSharedPointer<ShapeGraphLayer>(new ShapeGraphLayer(*shapeGraph)));
+        }
+        for (PointMap &pointMap : metaGraph.getPointMaps()) {
+            mapLayers.append(QSharedPointer<PixelMapLayer>(new PixelMapLayer(pointMap)));
         }
-        for (PointMap &pointMap : graphModel->getMetaGraph().getPointMaps()) {
-            m_mapLayers.append(QSharedPointer<PixelMapLayer>(new PixelMapLayer(pointMap)));
+        // the file is the same one so the layers come back in the same order
+        for (size_t i = 0; i < static_cast<size_t>(mapLayers.size()) && i < m_unloadedLayers.size();
+             ++i) {
+            mapLayers[static_cast<qsizetype>(i)]->setViewState(m_unloadedLayers[i]);
         }
+        m_unloadedLayers.clear();
+        if (mapLayers.isEmpty())
+            return;
+        m_mapLayers = mapLayers;
+        ++m_layersGeneration;
+        emit mapLayersInserted(0, static_cast<int>(m_mapLayers.size() - 1));
+    }
 
-        emit graphModelChanged();
+    void unloadMapLayers() {
+        // the viewports let go of the layers (and keep where they were looking) first, then
+        // what the view shows of each layer is kept. The data itself is read back from the
+        // file, the views do not edit it
+        emit mapLayersAboutToBeReleased();
+        m_unloadedLayers.clear();
+        for (auto &mapLayer : m_mapLayers) {
+            m_unloadedLayers.push_back(mapLayer->getViewState());
+            mapLayer->getAttributeStatistics().cancelPending();
+        }
+        if (m_mapLayers.isEmpty())
+            return;
+        emit mapLayersAboutToBeRemoved(0, static_cast<int>(m_mapLayers.size() - 1));
+        m_mapLayers.clear();
+        ++m_layersGeneration;
     }
 
+  public:
   signals:
     void graphModelChanged();
     void idChanged();
+    // the range is inclusive, as in QAbstractItemModel
+    void mapLayersInserted(int first, int last);
+    void mapLayersAboutToBeRemoved(int first, int last);
+    // the document is about to be unloaded, anything drawing the layers has to stop before
+    // this returns
+    void mapLayersAboutToBeReleased();
 };
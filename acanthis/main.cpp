@@ -2,12 +2,17 @@
 //
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include "batchrenderer.h"
 #include "coreapplication.h"
 
 int main(int argc, char *argv[]) {
     Q_INIT_RESOURCE(resource);
     Q_INIT_RESOURCE(settingsdialog);
 
+    // batch renders run on servers without a display, unless another platform is asked for
+    if (BatchRenderer::isRequested(argc, argv) && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
     CoreApplication app(argc, argv);
 
     return app.exec();
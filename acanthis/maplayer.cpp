@@ -0,0 +1,155 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "maplayer.h"
+
+#include "agl/func/aglcolourmapper.h"
+
+#include "salalib/shapemap.h"
+
+#include <algorithm>
+#include <cmath>
+
+void MapLayer::indexItemKeys() {
+    if (m_itemKeys.size() == m_attributes.getNumRows() && m_selection.size() == m_itemKeys.size())
+        return;
+    m_itemKeys.clear();
+    m_itemKeys.reserve(m_attributes.getNumRows());
+    for (auto iter = m_attributes.begin(); iter != m_attributes.end(); ++iter) {
+        m_itemKeys.push_back(iter->getKey().value);
+    }
+    std::sort(m_itemKeys.begin(), m_itemKeys.end());
+    // the rows have changed under the selection, it can not be carried over
+    m_selection = SelectionSet(m_itemKeys.size());
+}
+
+void MapLayer::select(const QtRegion &region, SelectionSet::Operation operation) {
+    indexItemKeys();
+    SelectionSet regionSelection(m_itemKeys.size());
+    for (int key : getKeysInRegion(region)) {
+        auto itemKey = std::lower_bound(m_itemKeys.begin(), m_itemKeys.end(), key);
+        if (itemKey != m_itemKeys.end() && *itemKey == key)
+            regionSelection.set(static_cast<size_t>(itemKey - m_itemKeys.begin()));
+    }
+    m_selection.combine(regionSelection, operation);
+    ++m_selectionGeneration;
+    emit selectionChanged();
+}
+
+void MapLayer::clearSelection() {
+    if (m_selection.isEmpty())
+        return;
+    m_selection.clear();
+    ++m_selectionGeneration;
+    emit selectionChanged();
+}
+
+std::vector<int> MapLayer::getSelectedKeys() const {
+    std::vector<int> keys;
+    keys.reserve(m_selection.count());
+    m_selection.forEach([this, &keys](size_t position) { keys.push_back(m_itemKeys[position]); });
+    return keys;
+}
+
+MapLayer::ViewState MapLayer::getViewState() const {
+    ViewState viewState;
+    viewState.visible = m_visible;
+    viewState.displayedColumn = getDisplayedColumn();
+    viewState.filterMinimum = m_filterMinimum;
+    viewState.filterMaximum = m_filterMaximum;
+    viewState.selectedKeys = getSelectedKeys();
+    return viewState;
+}
+
+void MapLayer::setViewState(const ViewState &viewState) {
+    m_visible = viewState.visible;
+    if (viewState.displayedColumn < 0 ||
+        static_cast<size_t>(viewState.displayedColumn) < m_attributes.getNumColumns())
+        setDisplayedColumn(viewState.displayedColumn);
+    setFilterRange(viewState.filterMinimum, viewState.filterMaximum);
+    indexItemKeys();
+    m_selection.clear();
+    for (int key : viewState.selectedKeys) {
+        auto itemKey = std::lower_bound(m_itemKeys.begin(), m_itemKeys.end(), key);
+        if (itemKey != m_itemKeys.end() && *itemKey == key)
+            m_selection.set(static_cast<size_t>(itemKey - m_itemKeys.begin()));
+    }
+    ++m_selectionGeneration;
+    emit visibilityChanged();
+    emit selectionChanged();
+}
+
+bool MapLayer::setDisplayedAttribute(const QString &name) {
+    std::string columnName = name.toStdString();
+    if (!m_attributes.hasColumn(columnName))
+        return false;
+    setDisplayedColumn(static_cast<int>(m_attributes.getColumnIndex(columnName)));
+    return true;
+}
+
+uint64_t MapLayer::getColouringHash() const {
+    // FNV-1a, as over the polygons of the triangulation cache
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto addBytes = [&hash](const void *data, size_t size) {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+    };
+    int column = getDisplayedColumn();
+    addBytes(&column, sizeof(column));
+    if (column < 0)
+        return hash;
+    size_t columnIndex = static_cast<size_t>(column);
+    const DisplayParams &displayParams = m_attributes.getColumn(columnIndex).getDisplayParams();
+    addBytes(&displayParams.blue, sizeof(displayParams.blue));
+    addBytes(&displayParams.red, sizeof(displayParams.red));
+    addBytes(&displayParams.colorscale, sizeof(displayParams.colorscale));
+    // the values rather than a count of edits, so that the hash also holds across sessions
+    for (auto iter = m_attributes.begin(); iter != m_attributes.end(); ++iter) {
+        int key = iter->getKey().value;
+        float value = iter->getRow().getValue(columnIndex);
+        addBytes(&key, sizeof(key));
+        addBytes(&value, sizeof(value));
+    }
+    return hash;
+}
+
+void MapLayer::writeShapeVectors(AGLVectorWriter &writer, ShapeMap &shapeMap,
+                                 std::vector<int> keys, unsigned int pointSides,
+                                 float pointRadius) {
+    std::sort(keys.begin(), keys.end());
+    std::vector<float> values;
+    std::vector<PafColor> colours = AGLColourMapper::getDisplayColours(
+        shapeMap.getAttributeTable(), shapeMap.getAttributeTableHandle(), keys, &values);
+    const auto &shapes = shapeMap.getAllShapes();
+    // one pass for each kind of shape, in the order AGLShapeMap draws them
+    enum class Kind { LINE, POLYLINE, POLYGON, POINT };
+    std::vector<Point2f> pointPolygon(pointSides);
+    for (Kind kind : {Kind::LINE, Kind::POLYLINE, Kind::POLYGON, Kind::POINT}) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!passesFilter(values[i]))
+                continue;
+            const SalaShape &shape = shapes.at(keys[i]);
+            QRgb colour = qRgb(colours[i].redb(), colours[i].greenb(), colours[i].blueb());
+            if (kind == Kind::LINE && shape.isLine()) {
+                const Line &line = shape.getLine();
+                writer.addLine(line.start(), line.end(), colour);
+            } else if (kind == Kind::POLYLINE && shape.isPolyLine()) {
+                writer.addPolyline(shape.m_points, colour);
+            } else if (kind == Kind::POLYGON && shape.isPolygon()) {
+                writer.addPolygon(shape.m_points, colour);
+            } else if (kind == Kind::POINT && shape.isPoint()) {
+                Point2f centre = shape.getCentroid();
+                for (unsigned int side = 0; side < pointSides; ++side) {
+                    double angle = 2.0 * M_PI * side / pointSides;
+                    pointPolygon[side] = Point2f(centre.x + pointRadius * std::cos(angle),
+                                                 centre.y + pointRadius * std::sin(angle));
+                }
+                writer.addPolygon(pointPolygon, colour);
+            }
+        }
+    }
+}
@@ -4,16 +4,23 @@
 
 #pragma once
 
+#include "attributeitem.h"
+#include "selectionset.h"
 #include "treeitem.h"
 
 #include "agl/composite/aglmap.h"
+#include "agl/func/aglvectorwriter.h"
 
 #include "salalib/attributetable.h"
 
 #include <QObject>
 #include <QString>
 
+#include <cstdint>
 #include <memory>
+#include <vector>
+
+class ShapeMap;
 
 class MapLayer : public QObject, public TreeItem {
     Q_OBJECT
@@ -22,20 +29,100 @@ class MapLayer : public QObject, public TreeItem {
 
   protected:
     AttributeTable &m_attributes;
+    AttributeStatistics m_attributeStatistics;
+    // range of the normalised display value that is shown, the full range shows everything
+    // including the items without a value
+    float m_filterMinimum = 0.0f;
+    float m_filterMaximum = 1.0f;
+    // the selection is over the positions of the item keys, sorted on first use
+    std::vector<int> m_itemKeys;
+    SelectionSet m_selection;
+    unsigned int m_selectionGeneration = 0;
 
   public:
+    /**
+     * @brief What a view shows of the layer beyond its data, kept while the document is
+     * unloaded and put back on the layer read again from the file
+     */
+    struct ViewState {
+        bool visible = true;
+        int displayedColumn = -1;
+        float filterMinimum = 0.0f;
+        float filterMaximum = 1.0f;
+        std::vector<int> selectedKeys;
+    };
+
     MapLayer(QString mapName, AttributeTable &attributes)
-        : TreeItem(mapName), m_attributes(attributes){};
+        : TreeItem(mapName), m_attributes(attributes), m_attributeStatistics(attributes){};
 
     bool isVisible() { return m_visible; }
     QString getName() { return m_name; }
     AttributeTable &getAttributes() { return m_attributes; }
+    AttributeStatistics &getAttributeStatistics() { return m_attributeStatistics; }
+    float getFilterMinimum() const { return m_filterMinimum; }
+    float getFilterMaximum() const { return m_filterMaximum; }
+    bool isFiltered() const { return m_filterMinimum > 0.0f || m_filterMaximum < 1.0f; }
+    void setFilterRange(float minimum, float maximum) {
+        m_filterMinimum = minimum;
+        m_filterMaximum = maximum;
+    }
 
     virtual std::unique_ptr<AGLMap> constructGLMap() = 0;
 
+    /** @brief Keys of the items that touch the region, in any order */
+    virtual std::vector<int> getKeysInRegion(const QtRegion &) { return std::vector<int>(); }
+    /** @brief Combines the items in the region with the current selection */
+    void select(const QtRegion &region, SelectionSet::Operation operation);
+    void clearSelection();
+    size_t getSelectedCount() const { return m_selection.count(); }
+    /** @brief Keys of the selected items, in ascending order */
+    std::vector<int> getSelectedKeys() const;
+    // Increased on every change of the selection, for anything that mirrors it
+    unsigned int getSelectionGeneration() const { return m_selectionGeneration; }
+
+    ViewState getViewState() const;
+    /** @brief Keys (and columns) the layer no longer has are left out */
+    void setViewState(const ViewState &viewState);
+
+    /** @brief Adds the items in the region that pass the filter, drawn as in the map view */
+    virtual void writeVectors(AGLVectorWriter &, const QtRegion &) {}
+
+    /** @brief Colours the items by the named column, false if the layer does not have it */
+    bool setDisplayedAttribute(const QString &name);
+    /**
+     * @brief Hash of everything the colours (and filter values) of the items come from: the
+     * displayed column, its display parameters and its values. Anything cached along with
+     * the colours is only valid for the same hash
+     */
+    uint64_t getColouringHash() const;
+    /** @brief -1 when the items are coloured by their reference number */
+    virtual int getDisplayedColumn() const { return -1; }
+
     virtual bool hasGraph() { return false; }
 
+    // the graph (if any) and the attribute list
+    size_t nChildrenAvailable() override { return hasGraph() ? 2 : 1; }
+    QSharedPointer<TreeItem> createChild(size_t idx) override {
+        if (hasGraph() && idx == 0)
+            return QSharedPointer<TreeItem>(new TreeItem("Graph"));
+        return QSharedPointer<AttributeListItem>(
+            new AttributeListItem(m_attributes, m_attributeStatistics));
+    }
+
   signals:
     void nameChanged();
     void visibilityChanged();
+    void selectionChanged();
+
+  protected:
+    virtual void setDisplayedColumn(int) {}
+    bool passesFilter(float value) const {
+        return !isFiltered() || (value >= m_filterMinimum && value <= m_filterMaximum);
+    }
+    /** @brief Adds the shapes with the given keys, points as polygons of pointSides sides */
+    void writeShapeVectors(AGLVectorWriter &writer, ShapeMap &shapeMap, std::vector<int> keys,
+                           unsigned int pointSides, float pointRadius);
+
+  private:
+    void indexItemKeys();
 };
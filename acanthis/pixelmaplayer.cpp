@@ -6,9 +6,81 @@
 
 #include "agl/composite/aglpixelmap.h"
 
+#include <algorithm>
+
 PixelMapLayer::PixelMapLayer(PointMap &map)
     : MapLayer(QString::fromStdString(map.getName()), map.getAttributeTable()), m_pointMap(map) {}
 
 std::unique_ptr<AGLMap> PixelMapLayer::constructGLMap() {
     return std::unique_ptr<AGLPixelMap>(std::unique_ptr<AGLPixelMap>(new AGLPixelMap(m_pointMap)));
 };
+
+std::vector<int> PixelMapLayer::getKeysInRegion(const QtRegion &region) {
+    // constrained, so that a region starting off the grid still takes the pixels on it
+    PixelRef bottomLeft = m_pointMap.pixelate(region.bottom_left, true);
+    PixelRef topRight = m_pointMap.pixelate(region.top_right, true);
+    std::vector<int> keys;
+    for (short x = bottomLeft.x; x <= topRight.x; x++) {
+        for (short y = bottomLeft.y; y <= topRight.y; y++) {
+            PixelRef ref(x, y);
+            if (m_pointMap.includes(ref) && m_pointMap.getPoint(ref).filled())
+                keys.push_back(ref);
+        }
+    }
+    return keys;
+}
+
+void PixelMapLayer::writeVectors(AGLVectorWriter &writer, const QtRegion &region) {
+    PixelRef bottomLeft = m_pointMap.pixelate(region.bottom_left, true);
+    PixelRef topRight = m_pointMap.pixelate(region.top_right, true);
+    QtRegion mapRegion = m_pointMap.getRegion();
+    double spacing = m_pointMap.getSpacing();
+
+    // the value filtered on, as in AGLPixelMap
+    AttributeTable &attributes = m_pointMap.getAttributeTable();
+    int displayColumn = m_pointMap.getAttributeTableHandle().getDisplayColIndex();
+    float maxRef = std::max(1.0f, static_cast<float>(static_cast<int>(
+                                      PixelRef(static_cast<short>(m_pointMap.getCols() - 1),
+                                               static_cast<short>(m_pointMap.getRows() - 1)))));
+    auto pixelValue = [&](PixelRef ref) -> float {
+        if (displayColumn < 0)
+            return static_cast<float>(static_cast<int>(ref)) / maxRef;
+        const AttributeRow *row = attributes.getRowPtr(AttributeKey(ref));
+        if (row == nullptr)
+            return -1.0f;
+        return static_cast<float>(row->getNormalisedValue(static_cast<size_t>(displayColumn)));
+    };
+
+    std::vector<Point2f> rectangle(4);
+    for (int y = topRight.y; y >= bottomLeft.y; --y) {
+        double bottom = mapRegion.bottom_left.y + y * spacing;
+        int runStart = -1;
+        QRgb runColour = 0;
+        // one past the end to close the last run
+        for (int x = bottomLeft.x; x <= topRight.x + 1; ++x) {
+            bool drawn = false;
+            QRgb colour = 0;
+            if (x <= topRight.x) {
+                PixelRef ref(static_cast<short>(x), static_cast<short>(y));
+                PafColor pixelColour = m_pointMap.getPointColor(ref);
+                // alpha == 0 is transparent
+                drawn = pixelColour.alphab() != 0 && passesFilter(pixelValue(ref));
+                colour = qRgb(pixelColour.redb(), pixelColour.greenb(), pixelColour.blueb());
+            }
+            if (runStart >= 0 && (!drawn || colour != runColour)) {
+                double left = mapRegion.bottom_left.x + runStart * spacing;
+                double right = mapRegion.bottom_left.x + x * spacing;
+                rectangle[0] = Point2f(left, bottom);
+                rectangle[1] = Point2f(right, bottom);
+                rectangle[2] = Point2f(right, bottom + spacing);
+                rectangle[3] = Point2f(left, bottom + spacing);
+                writer.addPolygon(rectangle, runColour);
+                runStart = -1;
+            }
+            if (drawn && runStart < 0) {
+                runStart = x;
+                runColour = colour;
+            }
+        }
+    }
+}
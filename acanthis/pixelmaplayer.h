@@ -16,6 +16,13 @@ class PixelMapLayer : public MapLayer {
     explicit PixelMapLayer(PointMap &map);
 
     std::unique_ptr<AGLMap> constructGLMap() override;
+    std::vector<int> getKeysInRegion(const QtRegion &region) override;
+    /** @brief Runs of pixels of the same colour along each row go out as one rectangle */
+    void writeVectors(AGLVectorWriter &writer, const QtRegion &region) override;
 
     bool hasGraph() override { return m_pointMap.isProcessed(); }
+
+  protected:
+    void setDisplayedColumn(int column) override { m_pointMap.setDisplayedAttribute(column); }
+    int getDisplayedColumn() const override { return m_pointMap.getDisplayedAttribute(); }
 };
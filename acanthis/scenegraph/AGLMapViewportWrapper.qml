@@ -20,6 +20,12 @@ Page {
     function update() {
         contentItem.children[0].update()
     }
+    function exportImage(file, width) {
+        contentItem.children[0].exportImage(file, width)
+    }
+    function exportVectors(file) {
+        contentItem.children[0].exportVectors(file)
+    }
 
     AGLMapViewport {
         anchors.fill: parent
@@ -30,6 +36,9 @@ Page {
         backgroundColour: settings.glViewBackgroundColour
         antialiasingSamples: settings.glViewAntialiasingSamples
         highlightOnHover: settings.glViewHighlightOnHover
+        vertexBufferCache: settings.glViewVertexBufferCache
+        rasterTiles: settings.glViewRasterTiles
+        basemapFile: settings.glViewBasemapFile
 
         // it is necessary to "flip" the FBO here because the default assumes
         // that y is already flipped. Instead this will be handled internally
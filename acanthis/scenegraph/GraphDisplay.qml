@@ -4,6 +4,8 @@ import QtQuick
 import QtQuick.Layouts
 import QtQuick.Controls
 
+import acanthis 1.0
+
 ListView {
     // Instead of displaying one item at a time we load every
     // file's View (GL, Layers etc.) and only display the one
@@ -25,6 +27,9 @@ ListView {
     }
 
     onCurrentIndexChanged: {
+        // the document of the tab may have been unloaded while it was not visible
+        if (currentIndex >= 0)
+            DocumentManager.setActiveDocument(currentIndex)
         // ideally this should not be necessary, but doing this
         // in the delegate (visible: currentIndex === index)
         // does not work
@@ -50,6 +55,10 @@ ListView {
             graphViews.splitActiveView(orientation)
         }
 
+        function exportActiveView(file, width) {
+            graphViews.exportActiveView(file, width)
+        }
+
         SplitView {
             id: graphViews
             SplitView.fillWidth: true
@@ -73,6 +82,18 @@ ListView {
                 mapViews[newAGLView.model.id] = newAGLView.view
             }
 
+            function exportActiveView(file, width) {
+                if (views.activeMapViewID < 0) {
+                    console.log("No active view selected")
+                    return
+                }
+                let fileName = file.toString().toLowerCase()
+                if (fileName.endsWith(".svg") || fileName.endsWith(".pdf"))
+                    mapViews[views.activeMapViewID].exportVectors(file)
+                else
+                    mapViews[views.activeMapViewID].exportImage(file, width)
+            }
+
             function makeActive(viewID) {
                 if (viewID < 0)
                     return
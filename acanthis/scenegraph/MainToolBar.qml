@@ -16,6 +16,15 @@ RowLayout {
         onAccepted: window.openDocument(openDialog.selectedFile)
     }
 
+    FileDialog {
+        id: exportDialog
+        fileMode: FileDialog.SaveFile
+        nameFilters: ["PNG image (*.png)", "TIFF image (*.tif *.tiff)",
+            "SVG drawing (*.svg)", "PDF document (*.pdf)"]
+        onAccepted: graphFileView.currentItem.exportActiveView(
+                        exportDialog.selectedFile, settings.glViewExportWidth)
+    }
+
     ToolButton {
         id: newButton
         onClicked: window.newDocument()
@@ -71,6 +80,23 @@ RowLayout {
         }
     }
 
+    ToolButton {
+        id: exportButton
+        onClicked: exportDialog.open()
+        Layout.fillHeight: true
+        contentItem: Text {
+            text: "🖼"
+            horizontalAlignment: Text.AlignHCenter
+            color: Theme.toolbarButtonTextColour
+        }
+        background: Rectangle {
+            Layout.fillHeight: true
+            implicitWidth: parent.height
+            radius: Theme.tabButtonHoverRadius
+            color: parent.hovered ? Theme.toolbarButtonHoverColour : Theme.toolbarButtonColour
+        }
+    }
+
     ToolButton {
         id: rightButton
         contentItem: Text {
@@ -95,6 +95,10 @@ ApplicationWindow {
         property color glViewBackgroundColour: Qt.rgba(255, 255, 255, 255)
         property int glViewAntialiasingSamples: 0
         property bool glViewHighlightOnHover: true
+        property bool glViewVertexBufferCache: false
+        property bool glViewRasterTiles: false
+        property string glViewBasemapFile: ""
+        property int glViewExportWidth: 8000
     }
 
     // list of graph documents
@@ -185,5 +189,10 @@ ApplicationWindow {
                 registerDisplayModelView(this.getModelView())
             }
         }
+
+        RecentFiles {
+            anchors.fill: parent
+            visible: graphDisplayModel.count === 0
+        }
     }
 }
@@ -35,7 +35,9 @@ TreeView {
             default:
                 return padding + visibilityCheckbox.implicitWidth
             case nbuttons:
-                // label
+                // label, and the filter of the layers
+                if (filterSlider.visible)
+                    return label.x + label.implicitWidth + padding + filterSlider.width + padding
                 return label.implicitWidth + padding
             }
         }
@@ -121,5 +123,51 @@ TreeView {
             color: Theme.toolbarButtonTextColour
             horizontalAlignment: Text.AlignLeft
         }
+        RangeSlider {
+            id: filterSlider
+            // shows only the items of the layer with their normalised
+            // display value in the range, applied on the GPU. The slider
+            // is in the units of the displayed column once its statistics
+            // are known
+            readonly property bool hasValueRange: model.minimum !== undefined
+                                                  && model.maximum !== undefined
+                                                  && model.maximum > model.minimum
+            readonly property real valueMinimum: hasValueRange ? model.minimum : 0
+            readonly property real valueSpan: hasValueRange ///
+                                              ? model.maximum - model.minimum : 1
+
+            function normalised(value, unfiltered) {
+                // the ends stand for everything, including the items
+                // without a value
+                if (value <= from || value >= to)
+                    return unfiltered
+                return (value - valueMinimum) / valueSpan
+            }
+            function applyFilter() {
+                memodl.setItemFilterRange(getModelIndex(),
+                                          normalised(first.value, 0),
+                                          normalised(second.value, 1))
+                graphViews.redraw()
+            }
+
+            x: label.x + label.implicitWidth + padding
+            anchors.verticalCenter: parent.verticalCenter
+            width: 80
+            height: visibilityCheckbox.implicitHeight
+            visible: model.column === nbuttons && root.depth === 0
+            from: valueMinimum
+            to: valueMinimum + valueSpan
+            first.value: valueMinimum + valueSpan * (model.filterMinimum
+                                                     !== undefined ? model.filterMinimum : 0)
+            second.value: valueMinimum + valueSpan * (model.filterMaximum
+                                                      !== undefined ? model.filterMaximum : 1)
+            first.onMoved: applyFilter()
+            second.onMoved: applyFilter()
+            ToolTip.visible: hovered || first.pressed || second.pressed
+            ToolTip.delay: Theme.tooltipDelay
+            ToolTip.text: hasValueRange ///
+                          ? first.value.toPrecision(4) + " – " + second.value.toPrecision(4)
+                          : "Normalised display value"
+        }
     }
 }
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+// SPDX-License-Identifier: GPL-3.0-or-later
+import QtQuick
+import QtQuick.Controls
+
+import acanthis 1.0
+
+// The files opened last, shown by their thumbnails (read from the cache
+// on disk) when no document is open, so the graphs themselves are not read
+// until one is picked
+GridView {
+    id: recentFilesView
+    model: DocumentManager.recentFiles
+    clip: true
+    cellWidth: 272
+    cellHeight: 200
+    anchors.margins: 20
+
+    delegate: ItemDelegate {
+        width: recentFilesView.cellWidth - 16
+        height: recentFilesView.cellHeight - 16
+        padding: 8
+        onClicked: window.openDocument(modelData)
+        ToolTip.visible: hovered
+        ToolTip.delay: Theme.tooltipDelay
+        ToolTip.text: modelData
+        background: Rectangle {
+            color: parent.hovered ? Theme.recentFileHoverColour : Theme.recentFileColour
+            radius: Theme.tabButtonHoverRadius
+        }
+        contentItem: Column {
+            spacing: 4
+            Image {
+                width: parent.width
+                height: parent.height - nameText.height - parent.spacing
+                source: "image://thumbnail/" + encodeURIComponent(modelData)
+                sourceSize.width: 256
+                sourceSize.height: 160
+                fillMode: Image.PreserveAspectFit
+            }
+            Text {
+                id: nameText
+                width: parent.width
+                text: modelData.replace(/^.*[\\/]/, "")
+                elide: Text.ElideMiddle
+                horizontalAlignment: Text.AlignHCenter
+                color: Theme.toolbarButtonTextColour
+            }
+        }
+    }
+}
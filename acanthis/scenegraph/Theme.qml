@@ -19,6 +19,8 @@ QtObject {
     property color tabCloseButtonColour: "transparent"
     property color tabCloseButtonHoverColour: "#828282"
     property color appNameColour: "#dddddd"
+    property color recentFileColour: "#444444"
+    property color recentFileHoverColour: toolbarButtonHoverColour
     property int tooltipDelay: Qt.styleHints.mousePressAndHoldInterval
     property int tabButtonHoverRadius: 5
 }
@@ -77,6 +77,22 @@ RowLayout {
                     }
                     contentItem: RowLayout {
                         spacing: 0
+                        Image {
+                            // rendered in the background, documents not
+                            // saved to a file have none
+                            Layout.fillHeight: true
+                            Layout.preferredWidth: height * 1.6
+                            Layout.leftMargin: 2
+                            visible: status === Image.Ready
+                            source: "image://thumbnail/" + encodeURIComponent(
+                                        graphModelFile.getFilename())
+                            sourceSize.width: 256
+                            sourceSize.height: 160
+                            fillMode: Image.PreserveAspectFit
+                            // the file may have been saved since, the
+                            // thumbnail cache is on disk anyway
+                            cache: false
+                        }
                         Text {
                             Layout.fillWidth: true
                             Layout.fillHeight: true
@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "selectionset.h"
+
+size_t SelectionSet::count() const {
+    size_t total = 0;
+    for (uint64_t bits : m_words) {
+        // population count without intrinsics, the compiler recognises it
+        bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+        bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+        bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        total += static_cast<size_t>((bits * 0x0101010101010101ULL) >> 56);
+    }
+    return total;
+}
+
+bool SelectionSet::isEmpty() const {
+    return std::all_of(m_words.begin(), m_words.end(), [](uint64_t bits) { return bits == 0; });
+}
+
+void SelectionSet::combine(const SelectionSet &other, Operation operation) {
+    if (other.m_size != m_size)
+        return;
+    switch (operation) {
+    case Operation::REPLACE:
+        m_words = other.m_words;
+        break;
+    case Operation::UNITE:
+        for (size_t word = 0; word < m_words.size(); ++word)
+            m_words[word] |= other.m_words[word];
+        break;
+    case Operation::INTERSECT:
+        for (size_t word = 0; word < m_words.size(); ++word)
+            m_words[word] &= other.m_words[word];
+        break;
+    case Operation::SUBTRACT:
+        for (size_t word = 0; word < m_words.size(); ++word)
+            m_words[word] &= ~other.m_words[word];
+        break;
+    }
+}
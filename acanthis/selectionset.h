@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// The selected items of a layer as a bitset over the positions of the items (their order in
+// the attribute table). At one bit per item a selection of a million items takes 125KB and
+// is combined with another a word at a time.
+
+class SelectionSet {
+  public:
+    enum class Operation { REPLACE, UNITE, INTERSECT, SUBTRACT };
+
+    SelectionSet() {}
+    explicit SelectionSet(size_t size) : m_words((size + 63) / 64, 0), m_size(size) {}
+
+    size_t size() const { return m_size; }
+    bool test(size_t position) const {
+        return (m_words[position / 64] >> (position % 64)) & uint64_t(1);
+    }
+    void set(size_t position) { m_words[position / 64] |= uint64_t(1) << (position % 64); }
+    void reset(size_t position) { m_words[position / 64] &= ~(uint64_t(1) << (position % 64)); }
+    void clear() { std::fill(m_words.begin(), m_words.end(), 0); }
+    size_t count() const;
+    bool isEmpty() const;
+
+    /** @brief Combines the other set into this one, both must be of the same size */
+    void combine(const SelectionSet &other, Operation operation);
+
+    /** @brief Calls f with the position of each selected item, in increasing order */
+    template <typename F> void forEach(F f) const {
+        for (size_t word = 0; word < m_words.size(); ++word) {
+            uint64_t bits = m_words[word];
+            while (bits != 0) {
+                f(word * 64 + static_cast<size_t>(countTrailingZeros(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+  private:
+    static int countTrailingZeros(uint64_t bits) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+
+    std::vector<uint64_t> m_words;
+    size_t m_size = 0;
+};
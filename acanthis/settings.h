@@ -26,6 +26,7 @@ namespace SettingTag {
     const QString windowViewSize = "windowViewSize";
     const QString legacyMapWindow = "legacyMapWindow";
     const QString highlightOnHover = "highlightOnHover";
+    const QString documentMemoryBudget = "documentMemoryBudget";
 } // namespace SettingTag
 
 /**
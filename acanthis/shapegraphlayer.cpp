@@ -7,9 +7,15 @@
 #include "agl/composite/aglshapegraph.h"
 
 ShapeGraphLayer::ShapeGraphLayer(ShapeGraph &map)
-    : MapLayer(QString::fromStdString(map.getName()), map.getAttributeTable()), m_shapeGraph(map) {}
+    : MapLayer(QString::fromStdString(map.getName()), map.getAttributeTable()), m_shapeGraph(map),
+      m_shapeIndex(map) {}
 
 std::unique_ptr<AGLMap> ShapeGraphLayer::constructGLMap() {
     return std::unique_ptr<AGLShapeGraph>(
-        new AGLShapeGraph(m_shapeGraph, 8, static_cast<float>(m_shapeGraph.getSpacing()) * 0.1f));
+        new AGLShapeGraph(m_shapeGraph, m_shapeIndex, POINT_SIDES, getPointRadius()));
 };
+
+void ShapeGraphLayer::writeVectors(AGLVectorWriter &writer, const QtRegion &region) {
+    writeShapeVectors(writer, m_shapeGraph, m_shapeIndex.getShapeKeysInRegion(region),
+                      POINT_SIDES, getPointRadius());
+}
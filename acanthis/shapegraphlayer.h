@@ -6,15 +6,35 @@
 
 #include "maplayer.h"
 
+#include "agl/func/aglshapeindex.h"
+
 #include "salalib/shapegraph.h"
 
 class ShapeGraphLayer : public MapLayer {
+    // points are drawn as polygons of this many sides
+    static const unsigned int POINT_SIDES = 8;
+
     ShapeGraph &m_shapeGraph;
+    AGLShapeIndex m_shapeIndex;
 
   public:
     explicit ShapeGraphLayer(ShapeGraph &map);
 
     std::unique_ptr<AGLMap> constructGLMap() override;
+    std::vector<int> getKeysInRegion(const QtRegion &region) override {
+        return m_shapeIndex.getShapeKeysInRegion(region);
+    }
+    /** @brief Only the shapes, the connections of the graph are left out */
+    void writeVectors(AGLVectorWriter &writer, const QtRegion &region) override;
 
     bool hasGraph() override { return true; }
+
+  protected:
+    void setDisplayedColumn(int column) override { m_shapeGraph.setDisplayedAttribute(column); }
+    int getDisplayedColumn() const override { return m_shapeGraph.getDisplayedAttribute(); }
+
+  private:
+    float getPointRadius() const {
+        return static_cast<float>(m_shapeGraph.getSpacing()) * 0.1f;
+    }
 };
@@ -6,10 +6,17 @@
 
 #include "agl/composite/aglshapemap.h"
 
-ShapeMapLayer::ShapeMapLayer(ShapeMap &map)
-    : MapLayer(QString::fromStdString(map.getName()), map.getAttributeTable()), m_shapeMap(map) {}
+ShapeMapLayer::ShapeMapLayer(ShapeMap &map, AGLTriangulationCache *triangulationCache)
+    : MapLayer(QString::fromStdString(map.getName()), map.getAttributeTable()), m_shapeMap(map),
+      m_triangulationCache(triangulationCache), m_shapeIndex(map) {}
 
 std::unique_ptr<AGLMap> ShapeMapLayer::constructGLMap() {
     return std::unique_ptr<AGLShapeMap>(std::unique_ptr<AGLShapeMap>(
-        new AGLShapeMap(m_shapeMap, 8, static_cast<float>(m_shapeMap.getSpacing()) * 0.1f)));
+        new AGLShapeMap(m_shapeMap, m_shapeIndex, POINT_SIDES, getPointRadius(),
+                        m_triangulationCache)));
 };
+
+void ShapeMapLayer::writeVectors(AGLVectorWriter &writer, const QtRegion &region) {
+    writeShapeVectors(writer, m_shapeMap, m_shapeIndex.getShapeKeysInRegion(region), POINT_SIDES,
+                      getPointRadius());
+}
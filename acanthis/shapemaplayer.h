@@ -6,13 +6,32 @@
 
 #include "maplayer.h"
 
+#include "agl/func/aglshapeindex.h"
+#include "agl/func/agltriangulationcache.h"
+
 #include "salalib/shapemap.h"
 
 class ShapeMapLayer : public MapLayer {
+    // points are drawn as polygons of this many sides
+    static const unsigned int POINT_SIDES = 8;
+
     ShapeMap &m_shapeMap;
+    AGLTriangulationCache *m_triangulationCache;
+    AGLShapeIndex m_shapeIndex;
 
   public:
-    explicit ShapeMapLayer(ShapeMap &map);
+    explicit ShapeMapLayer(ShapeMap &map, AGLTriangulationCache *triangulationCache = nullptr);
 
     std::unique_ptr<AGLMap> constructGLMap() override;
+    std::vector<int> getKeysInRegion(const QtRegion &region) override {
+        return m_shapeIndex.getShapeKeysInRegion(region);
+    }
+    void writeVectors(AGLVectorWriter &writer, const QtRegion &region) override;
+
+  protected:
+    void setDisplayedColumn(int column) override { m_shapeMap.setDisplayedAttribute(column); }
+    int getDisplayedColumn() const override { return m_shapeMap.getDisplayedAttribute(); }
+
+  private:
+    float getPointRadius() const { return static_cast<float>(m_shapeMap.getSpacing()) * 0.1f; }
 };
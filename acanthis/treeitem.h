@@ -4,12 +4,16 @@
 
 #pragma once
 
+#include <QEnableSharedFromThis>
 #include <QVariant>
 
 #include <memory>
 #include <vector>
 
-class TreeItem {
+// Children may either be added up front or created on demand, in which case
+// nChildrenAvailable() and createChild() are overridden to describe them and
+// the model only creates them when the item is expanded
+class TreeItem : public QEnableSharedFromThis<TreeItem> {
     int m_row;
     QWeakPointer<TreeItem> m_parentItem;
     QList<QSharedPointer<TreeItem>> m_children;
@@ -21,11 +25,25 @@ class TreeItem {
 
   public:
     TreeItem(QString name) : m_name(name) {}
+    virtual ~TreeItem() {}
     const QSharedPointer<TreeItem> addChildItem(QSharedPointer<TreeItem> treeItem, int row) {
         m_children.push_back(treeItem);
         m_children.back()->setRow(row);
         return m_children.back();
     }
+    const QSharedPointer<TreeItem> insertChildItem(QSharedPointer<TreeItem> treeItem, int row) {
+        m_children.insert(row, treeItem);
+        renumberChildren(row);
+        return treeItem;
+    }
+    void removeChildItems(int row, int count) {
+        m_children.remove(row, count);
+        renumberChildren(row);
+    }
+
+    virtual size_t nChildrenAvailable() { return static_cast<size_t>(m_children.size()); }
+    virtual QSharedPointer<TreeItem> createChild(size_t) { return QSharedPointer<TreeItem>(); }
+    bool canFetchMore() { return static_cast<size_t>(m_children.size()) < nChildrenAvailable(); }
 
     const QSharedPointer<TreeItem> getParent() const { return m_parentItem; };
     int getRow() const { return m_row; }
@@ -41,4 +59,11 @@ class TreeItem {
     void setRow(int row) { m_row = row; }
     void setVisible(bool visible) { m_visible = visible; }
     void setEditable(bool editable) { m_editable = editable; }
+
+  private:
+    void renumberChildren(int fromRow) {
+        for (int row = fromRow; row < m_children.size(); ++row) {
+            m_children[row]->setRow(row);
+        }
+    }
 };